@@ -0,0 +1,80 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "util/uvframe.hpp"
+
+/**
+ * @note: CUVFrameBuf push/pop 吞吐. 一个生产者像解码线程那样 waitWritable -> alloc -> push,
+ * 一个消费者像渲染线程那样 pop, 空时让出 CPU. 帧只有 64 字节, 测的是队列和内存池本身的开销.
+ * 用法: uvframebench [frames]
+ */
+
+// bytes per frame, small so the memory traffic does not hide the queue
+#define BENCH_FRAME_LEN     64
+// producer wait in waitWritable, like the decoder thread
+#define BENCH_WAIT_MS       10
+
+typedef struct result_s {
+	double ms;
+	int popped;
+	int wait_timeouts; // waitWritable gave up, a lost wakeup shows up here
+} Result;
+
+static Result run(const int frames, const int cache, const CUVFrameBuf::CacheFullPolicy policy) {
+	CUVFrameBuf frame_buf;
+	frame_buf.setCache(cache);
+	frame_buf.setPolicy(policy);
+
+	std::atomic<bool> done{ false };
+	Result result{};
+	const auto begin = std::chrono::steady_clock::now();
+
+	std::thread consumer([&] {
+		CUVFrame frame;
+		for (;;) {
+			if (frame_buf.pop(&frame) == 0) {
+				++result.popped;
+				continue;
+			}
+			if (done && frame_buf.size() == 0) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+	});
+
+	CUVFrame frame;
+	for (int i = 0; i < frames; ++i) {
+		if (policy == CUVFrameBuf::DISCARD && !frame_buf.waitWritable(BENCH_WAIT_MS)) {
+			++result.wait_timeouts;
+		}
+		frame_buf.alloc(&frame, BENCH_FRAME_LEN);
+		frame.w = 8;
+		frame.h = 8;
+		frame.ts = static_cast<uint64_t>(i);
+		frame_buf.push(&frame);
+	}
+	done = true;
+	consumer.join();
+
+	result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+	const int frames = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int caches[] = { 1, 3, 10 };
+
+	std::printf("%-8s %5s %10s %10s %12s %9s\n", "policy", "cache", "ms", "popped", "Mframes/s", "timeouts");
+	for (const auto policy: { CUVFrameBuf::DISCARD, CUVFrameBuf::SQUEEZE }) {
+		for (const int cache: caches) {
+			const Result r = run(frames, cache, policy);
+			std::printf("%-8s %5d %10.1f %10d %12.2f %9d\n", policy == CUVFrameBuf::DISCARD ? "wait" : "squeeze", cache,
+			            r.ms, r.popped, frames / r.ms / 1000, r.wait_timeouts);
+		}
+	}
+	return 0;
+}
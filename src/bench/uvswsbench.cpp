@@ -0,0 +1,102 @@
+﻿#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "video/uvswsconverter.hpp"
+
+/**
+ * @note: CUVSwsConverter::convert 在 1080p/4K/8K 下按切片线程数的耗时.
+ * 源是解码器常见的 yuv420p 与硬解下载的 nv12, 目标是播放器实际使用的 yuv420p 与 bgr24, 尺寸不变.
+ * 用法: uvswsbench [frames]
+ */
+
+typedef struct size_s {
+	const char* name;
+	int w;
+	int h;
+} BenchSize;
+
+typedef struct conv_s {
+	AVPixelFormat src;
+	AVPixelFormat dst;
+} BenchConv;
+
+static double bench(const BenchSize& size, const BenchConv& conv, const int threads, const int frames, int* used_threads) {
+	AVFrame* src = av_frame_alloc();
+	src->width = size.w;
+	src->height = size.h;
+	src->format = conv.src;
+	if (av_frame_get_buffer(src, 0) < 0) {
+		av_frame_free(&src);
+		return -1;
+	}
+	// NOTE: not a flat color, swscale has no shortcut for real content either
+	for (int i = 0; i < 4 && src->data[i]; ++i) {
+		const int rows = i == 0 ? size.h : (size.h + 1) / 2;
+		for (int y = 0; y < rows; ++y) {
+			for (int x = 0; x < src->linesize[i]; ++x) {
+				src->data[i][y * src->linesize[i] + x] = static_cast<uint8_t>(x * 7 + y * 13 + i * 31);
+			}
+		}
+	}
+
+	uint8_t* data[4]{};
+	int linesize[4]{};
+	if (av_image_alloc(data, linesize, size.w, size.h, conv.dst, 64) < 0) {
+		av_frame_free(&src);
+		return -1;
+	}
+
+	double ms = -1;
+	CUVSwsConverter converter;
+	if (converter.init(size.w, size.h, conv.src, size.w, size.h, conv.dst, SWS_BICUBIC, threads)) {
+		*used_threads = converter.threads();
+		// warm up, the slice threads start on the first frame
+		converter.convert(src, data, linesize);
+		const auto begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; ++i) {
+			converter.convert(src, data, linesize);
+		}
+		ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / frames;
+	}
+	converter.reset();
+	av_freep(&data[0]);
+	av_frame_free(&src);
+	return ms;
+}
+
+int main(int argc, char* argv[]) {
+	const int frames = argc > 1 ? std::atoi(argv[1]) : 50;
+	const BenchSize sizes[] = {
+		{ "1080p", 1920, 1080 },
+		{ "4K", 3840, 2160 },
+		{ "8K", 7680, 4320 },
+	};
+	const BenchConv convs[] = {
+		{ AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P },
+		{ AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P },
+		{ AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGR24 },
+	};
+	// 0: autoThreads
+	const int thread_nums[] = { 1, 2, 4, 8, 0 };
+
+	av_log_set_level(AV_LOG_ERROR);
+	std::printf("%-6s %-22s %7s %10s %9s\n", "size", "conversion", "threads", "ms/frame", "fps");
+	for (const auto& size: sizes) {
+		for (const auto& conv: convs) {
+			char name[64];
+			std::snprintf(name, sizeof(name), "%s => %s", av_get_pix_fmt_name(conv.src), av_get_pix_fmt_name(conv.dst));
+			for (const int threads: thread_nums) {
+				int used = 0;
+				const double ms = bench(size, conv, threads, frames, &used);
+				if (ms < 0) {
+					std::printf("%-6s %-22s %7d %10s\n", size.name, name, threads, "failed");
+					continue;
+				}
+				std::printf("%-6s %-22s %4d%-3s %10.2f %9.1f\n", size.name, name, used, threads ? "" : "(a)", ms, 1000 / ms);
+			}
+		}
+	}
+	return 0;
+}
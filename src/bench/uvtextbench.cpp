@@ -0,0 +1,108 @@
+﻿// Must be included before any Qt header
+#include "GL/glew.h"
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLPaintDevice>
+#include <QPainter>
+#include <cstdio>
+#include <cstdlib>
+
+#include "gl/uvgltext.hpp"
+
+/**
+ * @note: OSD 文字两条路径的耗时: CUVGLTextAtlas 一次批量绘制, 与 CUVGLWidget::drawText 每个字符串一个 QPainter.
+ * 离屏上下文 + FBO, 每轮画 CUVVideoWnd 的三行叠加文字(时间, FPS, 分辨率), 每轮结束 glFinish 计入 GPU 时间.
+ * 用法: uvtextbench [rounds]
+ */
+
+// same as OSD_FONT_SIZE of CUVGLWidget
+#define BENCH_FONT_SIZE     14
+#define BENCH_WIDTH         1920
+#define BENCH_HEIGHT        1080
+
+static const char* s_texts[3] = { "01:23:45", "FPS:25 UP:1.2/3.4ms", "1920 X 1080" };
+static const int s_pos[3][2] = { { 10, 40 }, { BENCH_WIDTH - 200, 40 }, { 10, BENCH_HEIGHT - 10 } };
+
+static double benchAtlas(CUVGLTextAtlas& atlas, const int rounds) {
+	QElapsedTimer timer;
+	timer.start();
+	for (int i = 0; i < rounds; ++i) {
+		atlas.begin(BENCH_WIDTH, BENCH_HEIGHT);
+		for (int j = 0; j < 3; ++j) {
+			atlas.draw(s_pos[j][0], s_pos[j][1], s_texts[j], Qt::red);
+		}
+		atlas.end();
+		glFinish();
+	}
+	return static_cast<double>(timer.nsecsElapsed()) / 1e6 / rounds;
+}
+
+static double benchPainter(QOpenGLPaintDevice& device, const int rounds) {
+	QElapsedTimer timer;
+	timer.start();
+	for (int i = 0; i < rounds; ++i) {
+		// NOTE: like CUVGLWidget::drawText, a painter per string
+		for (int j = 0; j < 3; ++j) {
+			QPainter painter(&device);
+			QFont font = painter.font();
+			font.setPointSize(BENCH_FONT_SIZE);
+			painter.setFont(font);
+			painter.setPen(Qt::red);
+			painter.drawText(QPoint(s_pos[j][0], s_pos[j][1]), s_texts[j]);
+		}
+		glFinish();
+	}
+	return static_cast<double>(timer.nsecsElapsed()) / 1e6 / rounds;
+}
+
+int main(int argc, char* argv[]) {
+	QGuiApplication app(argc, argv);
+	const int rounds = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+	// NOTE: the atlas uses client side vertex arrays like the rest of the renderer
+	QSurfaceFormat format;
+	format.setProfile(QSurfaceFormat::CompatibilityProfile);
+	QOpenGLContext context;
+	context.setFormat(format);
+	QOffscreenSurface surface;
+	surface.setFormat(format);
+	surface.create();
+	if (!context.create() || !context.makeCurrent(&surface)) {
+		std::fprintf(stderr, "no OpenGL context\n");
+		return 1;
+	}
+	if (glewInit() != GLEW_OK) {
+		std::fprintf(stderr, "glewInit failed\n");
+		return 1;
+	}
+
+	QOpenGLFramebufferObject fbo(BENCH_WIDTH, BENCH_HEIGHT);
+	fbo.bind();
+	glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+
+	CUVGLTextAtlas atlas;
+	atlas.init(BENCH_FONT_SIZE, 1.0);
+	if (!atlas.valid()) {
+		std::fprintf(stderr, "text atlas unavailable\n");
+		return 1;
+	}
+	QOpenGLPaintDevice device(BENCH_WIDTH, BENCH_HEIGHT);
+
+	// warm up both, QPainter caches its glyphs on first use
+	benchAtlas(atlas, 10);
+	benchPainter(device, 10);
+	const double atlas_ms = benchAtlas(atlas, rounds);
+	const double painter_ms = benchPainter(device, rounds);
+	std::printf("%s, %d rounds of 3 strings\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)), rounds);
+	std::printf("atlas    %8.3f ms/round\n", atlas_ms);
+	std::printf("QPainter %8.3f ms/round\n", painter_ms);
+
+	atlas.release();
+	fbo.release();
+	context.doneCurrent();
+	return 0;
+}
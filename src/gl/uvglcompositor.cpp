@@ -0,0 +1,305 @@
+﻿#include "uvglcompositor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+/**
+ * class CUVGLTileWnd
+ */
+CUVGLTileWnd::CUVGLTileWnd(CUVGLCompositor* compositor, QWidget* parent) : QWidget(parent), CUVVideoWnd(parent), compositor(compositor) {
+	if (compositor) {
+		compositor->addTile(this);
+	}
+}
+
+CUVGLTileWnd::~CUVGLTileWnd() {
+	if (compositor) {
+		compositor->removeTile(this);
+	}
+}
+
+void CUVGLTileWnd::setgeometry(const QRect& rc) {
+	setGeometry(rc);
+}
+
+void CUVGLTileWnd::Update() {
+	if (compositor) {
+		compositor->markDirty(this);
+	}
+}
+
+void CUVGLTileWnd::composited(const double upload_ms) {
+	calcFPS();
+	addUploadTime(upload_ms);
+}
+
+void CUVGLTileWnd::moveEvent(QMoveEvent* event) {
+	if (compositor) {
+		compositor->invalidate();
+	}
+	QWidget::moveEvent(event);
+}
+
+void CUVGLTileWnd::resizeEvent(QResizeEvent* event) {
+	if (compositor) {
+		compositor->invalidate();
+	}
+	QWidget::resizeEvent(event);
+}
+
+void CUVGLTileWnd::showEvent(QShowEvent* event) {
+	if (compositor) {
+		compositor->invalidate();
+	}
+	QWidget::showEvent(event);
+}
+
+void CUVGLTileWnd::hideEvent(QHideEvent* event) {
+	if (compositor) {
+		compositor->invalidate();
+	}
+	QWidget::hideEvent(event);
+}
+
+/**
+ * class CUVGLCompositor
+ * @param parent
+ */
+CUVGLCompositor::CUVGLCompositor(QWidget* parent) : CUVGLWidget(parent) {
+	// NOTE: keep the framebuffer between passes, tiles without a new frame are not redrawn
+	setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+	// clicks go to the multiview below the video widgets
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	stats_tick = std::chrono::steady_clock::now();
+}
+
+CUVGLCompositor::~CUVGLCompositor() {
+	makeCurrent();
+	for (auto& tile: tiles) {
+		if (tile.stream) {
+			tile.stream->release();
+		}
+	}
+	if (use_timer) {
+		glDeleteQueries(GL_COMPOSITOR_QUERY_NUM, queries);
+	}
+	doneCurrent();
+}
+
+void CUVGLCompositor::addTile(CUVGLTileWnd* tile) {
+	tiles.push_back(Tile{ tile, nullptr, QRect(), true, false });
+	invalidate();
+}
+
+void CUVGLCompositor::removeTile(CUVGLTileWnd* tile) {
+	const auto iter = std::find_if(tiles.begin(), tiles.end(), [tile](const Tile& t) { return t.wnd == tile; });
+	if (iter == tiles.end()) {
+		return;
+	}
+	if (iter->stream) {
+		makeCurrent();
+		iter->stream->release();
+		doneCurrent();
+	}
+	tiles.erase(iter);
+	invalidate();
+}
+
+void CUVGLCompositor::markDirty(CUVGLTileWnd* tile) {
+	for (auto& t: tiles) {
+		if (t.wnd == tile) {
+			t.dirty = true;
+			break;
+		}
+	}
+	// NOTE: Qt merges the updates of all tiles into one paintGL
+	update();
+}
+
+void CUVGLCompositor::invalidate() {
+	full_redraw = true;
+	update();
+}
+
+QImage CUVGLCompositor::grabTile(const QWidget* wdg) {
+	const QRect rc = tileRect(wdg);
+	if (rc.isEmpty()) {
+		return {};
+	}
+	const QImage image = grabFramebuffer();
+	const qreal ratio = image.devicePixelRatio();
+	return image.copy(QRect(rc.topLeft() * ratio, rc.size() * ratio));
+}
+
+void CUVGLCompositor::initializeGL() {
+	CUVGLWidget::initializeGL();
+	use_timer = GLEW_ARB_timer_query;
+	if (use_timer) {
+		glGenQueries(GL_COMPOSITOR_QUERY_NUM, queries);
+	}
+	std::fill(std::begin(query_pending), std::end(query_pending), false);
+	// a new context, the textures of the old one are gone with it
+	for (auto& tile: tiles) {
+		tile.stream.reset();
+	}
+	full_redraw = true;
+}
+
+void CUVGLCompositor::resizeGL(const int w, const int h) {
+	CUVGLWidget::resizeGL(w, h);
+	full_redraw = true;
+}
+
+void CUVGLCompositor::paintGL() {
+	const auto start = std::chrono::steady_clock::now();
+	beginTimer();
+
+	const qreal ratio = devicePixelRatioF();
+	const auto fb_w = static_cast<GLsizei>(width() * ratio);
+	const auto fb_h = static_cast<GLsizei>(height() * ratio);
+
+	// widgets moved without telling us (exchange, stretch)
+	for (auto& tile: tiles) {
+		if (const QRect rc = tileRect(tile.wnd); rc != tile.rect) {
+			tile.rect = rc;
+			full_redraw = true;
+		}
+	}
+	if (full_redraw) {
+		glDisable(GL_SCISSOR_TEST);
+		glViewport(0, 0, fb_w, fb_h);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	int drawn = 0;
+	for (auto& tile: tiles) {
+		tile.drawn = false;
+		if (tile.rect.isEmpty() || (!tile.dirty && !full_redraw)) {
+			continue;
+		}
+		drawTile(tile, ratio, fb_h);
+		tile.dirty = false;
+		++drawn;
+	}
+	glDisable(GL_SCISSOR_TEST);
+	glViewport(0, 0, fb_w, fb_h);
+	full_redraw = false;
+
+	if (drawn > 0) {
+		drawOSD();
+	}
+
+	endTimer();
+	updateStats(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), drawn);
+}
+
+QRect CUVGLCompositor::tileRect(const QWidget* wdg) const {
+	if (!wdg->isVisible() || wdg->width() <= 0 || wdg->height() <= 0) {
+		return {};
+	}
+	const QPoint pos = wdg->mapTo(window(), QPoint(0, 0)) - mapTo(window(), QPoint(0, 0));
+	return QRect(pos, wdg->size()).intersected(rect());
+}
+
+void CUVGLCompositor::drawTile(Tile& tile, const qreal ratio, const int fb_h) {
+	const QRect& rc = tile.rect;
+	const auto x = static_cast<GLint>(rc.x() * ratio);
+	const auto w = static_cast<GLsizei>(rc.width() * ratio);
+	const auto h = static_cast<GLsizei>(rc.height() * ratio);
+	// NOTE: GL counts rows from the bottom
+	const auto y = static_cast<GLint>(fb_h - rc.y() * ratio - h);
+	glViewport(x, y, w, h);
+	glScissor(x, y, w, h);
+	glEnable(GL_SCISSOR_TEST);
+
+	const CUVFrame& frame = tile.wnd->last_frame;
+	if (frame.isNull()) {
+		// stopped, the last picture must not stay behind
+		glClear(GL_COLOR_BUFFER_BIT);
+		return;
+	}
+	if (!tile.stream) {
+		tile.stream = std::make_unique<CUVGLTextureStream>();
+		tile.stream->init();
+	}
+	tile.wnd->composited(drawFrame(&frame, tile.stream.get()));
+	tile.drawn = true;
+}
+
+void CUVGLCompositor::drawOSD() {
+	// NOTE: one batch for all tiles, text of tiles not redrawn stays in the framebuffer
+	char buf[64];
+	beginOSD();
+	for (const auto& tile: tiles) {
+		if (!tile.drawn) {
+			continue;
+		}
+		const CUVGLTileWnd* wnd = tile.wnd;
+		const int left = tile.rect.left();
+		// NOTE: text outside the tile lands on a neighbour that may not be redrawn and would stay there
+		const int right = std::max(left + 10, tile.rect.left() + tile.rect.width() - 220);
+		const int top = tile.rect.top();
+		if (wnd->draw_time) {
+			drawOSDText(left + 10, top + 40, wnd->osdTime(buf, sizeof(buf)), Qt::red);
+		}
+		if (wnd->draw_fps) {
+			drawOSDText(right, top + 40, wnd->osdFPS(buf, sizeof(buf)), Qt::red);
+			drawOSDText(right, top + 60, wnd->osdPresent(buf, sizeof(buf)), Qt::red);
+			snprintf(buf, sizeof(buf), "MV:%.1f/%.1fms GPU:%.1fms", cpu_ms, cpu_max_ms, gpu_ms);
+			drawOSDText(right, top + 80, buf, Qt::red);
+		}
+		if (wnd->draw_resolution) {
+			drawOSDText(left + 10, top + tile.rect.height() - 10, wnd->osdResolution(buf, sizeof(buf)), Qt::red);
+		}
+	}
+	endOSD();
+}
+
+void CUVGLCompositor::beginTimer() {
+	if (!use_timer) {
+		return;
+	}
+	// the query of GL_COMPOSITOR_QUERY_NUM passes ago, dropped if the GPU is still not done
+	const GLuint query = queries[query_index];
+	if (query_pending[query_index]) {
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+			gpu_sum += static_cast<double>(ns) / 1e6;
+			++gpu_cnt;
+		}
+		query_pending[query_index] = false;
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void CUVGLCompositor::endTimer() {
+	if (!use_timer) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	query_pending[query_index] = true;
+	query_index = (query_index + 1) % GL_COMPOSITOR_QUERY_NUM;
+}
+
+void CUVGLCompositor::updateStats(const double ms, const int drawn) {
+	cpu_sum += ms;
+	cpu_peak = std::max(cpu_peak, ms);
+	tile_cnt += drawn;
+	++frame_cnt;
+
+	const auto now = std::chrono::steady_clock::now();
+	if (now - stats_tick < std::chrono::seconds(1)) {
+		return;
+	}
+	cpu_ms = cpu_sum / frame_cnt;
+	cpu_max_ms = cpu_peak;
+	gpu_ms = gpu_cnt > 0 ? gpu_sum / gpu_cnt : 0;
+	tiles_drawn = static_cast<double>(tile_cnt) / frame_cnt;
+	cpu_sum = cpu_peak = gpu_sum = 0;
+	gpu_cnt = frame_cnt = tile_cnt = 0;
+	stats_tick = now;
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include "uvglwidget.hpp"
+#include "interface/uvvideownd.hpp"
+
+#include <QPointer>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// GPU timer queries in flight, results are read a few frames later without stalling
+#define GL_COMPOSITOR_QUERY_NUM 3
+
+class CUVGLCompositor;
+
+/**
+ * @note: 合成模式下的视频窗口. 本身不绘制也不持有 GL 上下文, 只保存最近一帧,
+ * 有新帧时通知 CUVGLCompositor 重绘自己所在的区域.
+ */
+class CUVGLTileWnd : public QWidget, public CUVVideoWnd {
+public:
+	explicit CUVGLTileWnd(CUVGLCompositor* compositor, QWidget* parent = nullptr);
+	~CUVGLTileWnd() override;
+
+	void setgeometry(const QRect& rc) override;
+	void Update() override;
+
+	// called by the compositor once the tile was drawn
+	void composited(double upload_ms);
+
+protected:
+	void moveEvent(QMoveEvent* event) override;
+	void resizeEvent(QResizeEvent* event) override;
+	void showEvent(QShowEvent* event) override;
+	void hideEvent(QHideEvent* event) override;
+
+private:
+	// NOTE: both are children of the multiview, the compositor may be destroyed first
+	QPointer<CUVGLCompositor> compositor;
+};
+
+/**
+ * @note: 多画面合成. 一个 GL 上下文覆盖整个 CUVMultiView, 放在所有 CUVVideoWidget 之下,
+ * 每个 CUVGLTileWnd 是其中的一个视口, 共用同一个着色器程序, 各自一组纹理.
+ * 使用 PartialUpdate, 帧缓冲在两次绘制之间保留, 只重绘有新帧的画面; 布局变化时全部重绘.
+ * 每秒发布一次每次合成的 CPU 时间和 GPU 时间(ARB_timer_query).
+ */
+class CUVGLCompositor : public CUVGLWidget {
+public:
+	explicit CUVGLCompositor(QWidget* parent = nullptr);
+	~CUVGLCompositor() override;
+
+	void addTile(CUVGLTileWnd* tile);
+	void removeTile(CUVGLTileWnd* tile);
+	// the tile has a new frame
+	void markDirty(CUVGLTileWnd* tile);
+	// layout changed, everything is redrawn on the next pass
+	void invalidate();
+
+	// what is currently shown in the area of a widget, for drag previews
+	QImage grabTile(const QWidget* wdg);
+
+	// per composited frame, published once per second
+	double cpu_ms{};
+	double cpu_max_ms{};
+	double gpu_ms{};      // 0 without ARB_timer_query
+	double tiles_drawn{}; // average tiles redrawn per pass
+
+protected:
+	void initializeGL() override;
+	void resizeGL(int w, int h) override;
+	void paintGL() override;
+
+private:
+	typedef struct tile_s {
+		CUVGLTileWnd* wnd;
+		std::unique_ptr<CUVGLTextureStream> stream; // created on the first frame
+		QRect rect;                                 // in compositor coordinates, empty when hidden
+		bool dirty;
+		bool drawn; // in this pass
+	} Tile;
+
+	[[nodiscard]] QRect tileRect(const QWidget* wdg) const;
+	void drawTile(Tile& tile, qreal ratio, int fb_h);
+	void drawOSD();
+	void beginTimer();
+	void endTimer();
+	void updateStats(double ms, int drawn);
+
+	std::vector<Tile> tiles;
+	bool full_redraw{ true };
+
+	bool use_timer{};
+	GLuint queries[GL_COMPOSITOR_QUERY_NUM]{};
+	bool query_pending[GL_COMPOSITOR_QUERY_NUM]{};
+	int query_index{};
+
+	std::chrono::steady_clock::time_point stats_tick{};
+	double cpu_sum{};
+	double cpu_peak{};
+	double gpu_sum{};
+	int gpu_cnt{};
+	int frame_cnt{};
+	int tile_cnt{};
+};
@@ -0,0 +1,254 @@
+﻿#include "uvgltext.hpp"
+
+#include <QDebug>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <cmath>
+
+static GLuint compileShader(const GLenum type, const char* source) {
+	const GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+	GLint status = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		char log[512]{};
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		qWarning("text shader: %s", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+/**
+ * class CUVGLTextAtlas
+ */
+void CUVGLTextAtlas::init(const int point_size, const qreal ratio) {
+	if (tex && this->point_size == point_size && std::fabs(this->ratio - ratio) < 1e-3) {
+		return;
+	}
+	if (tex) {
+		glDeleteTextures(1, &tex);
+		tex = 0;
+	}
+	if (!prog && !loadProgram()) {
+		return;
+	}
+	this->point_size = point_size;
+	this->ratio = ratio;
+
+	QFont font;
+	font.setPointSize(point_size);
+	const QFontMetrics fm(font);
+	const int cell_h = fm.height() + 2;
+
+	// shelf layout, one cell per glyph with a pixel of padding against bleeding
+	int x = 0;
+	int y = 0;
+	int cell_w[GL_TEXT_GLYPH_NUM];
+	for (int i = 0; i < GL_TEXT_GLYPH_NUM; ++i) {
+		cell_w[i] = fm.horizontalAdvance(QChar(GL_TEXT_FIRST_CHAR + i)) + 2;
+		if (x + cell_w[i] > GL_TEXT_ATLAS_WIDTH) {
+			x = 0;
+			y += cell_h;
+		}
+		x += cell_w[i];
+	}
+	const int atlas_w = GL_TEXT_ATLAS_WIDTH;
+	const int atlas_h = y + cell_h;
+
+	QImage image(static_cast<int>(std::ceil(atlas_w * ratio)), static_cast<int>(std::ceil(atlas_h * ratio)), QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(ratio);
+	image.fill(Qt::transparent);
+	QPainter painter(&image);
+	painter.setFont(font);
+	painter.setPen(Qt::white);
+	const auto img_w = static_cast<GLfloat>(image.width());
+	const auto img_h = static_cast<GLfloat>(image.height());
+	x = y = 0;
+	for (int i = 0; i < GL_TEXT_GLYPH_NUM; ++i) {
+		if (x + cell_w[i] > GL_TEXT_ATLAS_WIDTH) {
+			x = 0;
+			y += cell_h;
+		}
+		painter.drawText(x + 1, y + 1 + fm.ascent(), QString(QChar(GL_TEXT_FIRST_CHAR + i)));
+		Glyph& glyph = glyphs[i];
+		glyph.u0 = static_cast<GLfloat>(x * ratio) / img_w;
+		glyph.v0 = static_cast<GLfloat>(y * ratio) / img_h;
+		glyph.u1 = static_cast<GLfloat>((x + cell_w[i]) * ratio) / img_w;
+		glyph.v1 = static_cast<GLfloat>((y + cell_h) * ratio) / img_h;
+		glyph.w = static_cast<GLfloat>(cell_w[i]);
+		glyph.h = static_cast<GLfloat>(cell_h);
+		glyph.top = static_cast<GLfloat>(1 + fm.ascent());
+		glyph.advance = static_cast<GLfloat>(cell_w[i] - 2);
+		x += cell_w[i];
+	}
+	painter.end();
+
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, image.constBits());
+}
+
+void CUVGLTextAtlas::release() {
+	if (tex) {
+		glDeleteTextures(1, &tex);
+		tex = 0;
+	}
+	if (prog) {
+		glDeleteProgram(prog);
+		prog = 0;
+	}
+}
+
+bool CUVGLTextAtlas::loadProgram() {
+	const auto szVS = R"(
+    attribute vec2 posIn;
+    attribute vec2 uvIn;
+    attribute vec4 clrIn;
+    uniform vec2 screen;
+    varying vec2 uv;
+    varying vec4 clr;
+
+    void main(){
+        gl_Position = vec4(posIn.x * 2.0 / screen.x - 1.0, 1.0 - posIn.y * 2.0 / screen.y, 0.0, 1.0);
+        uv = uvIn;
+        clr = clrIn;
+    }
+    )";
+	const auto szFS = R"(
+    uniform sampler2D atlas;
+    varying vec2 uv;
+    varying vec4 clr;
+
+    void main(){
+        gl_FragColor = vec4(clr.rgb, clr.a * texture2D(atlas, uv).a);
+    }
+    )";
+	const GLuint vs = compileShader(GL_VERTEX_SHADER, szVS);
+	const GLuint fs = compileShader(GL_FRAGMENT_SHADER, szFS);
+	if (vs && fs) {
+		prog = glCreateProgram();
+		glAttachShader(prog, vs);
+		glAttachShader(prog, fs);
+		glBindAttribLocation(prog, TEXT_ATTR_POS, "posIn");
+		glBindAttribLocation(prog, TEXT_ATTR_UV, "uvIn");
+		glBindAttribLocation(prog, TEXT_ATTR_CLR, "clrIn");
+		glLinkProgram(prog);
+		GLint status = 0;
+		glGetProgramiv(prog, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			qWarning("text program link failed");
+			glDeleteProgram(prog);
+			prog = 0;
+		}
+	}
+	// NOTE: flagged for deletion, freed with the program
+	if (vs) {
+		glDeleteShader(vs);
+	}
+	if (fs) {
+		glDeleteShader(fs);
+	}
+	if (prog) {
+		screen_uniform = glGetUniformLocation(prog, "screen");
+		atlas_uniform = glGetUniformLocation(prog, "atlas");
+	}
+	return prog != 0;
+}
+
+void CUVGLTextAtlas::begin(const int w, const int h) {
+	glyph_cnt = 0;
+	screen_w = w;
+	screen_h = h;
+}
+
+void CUVGLTextAtlas::draw(const int x, const int y, const char* text, const QColor& clr) {
+	const auto r = static_cast<GLfloat>(clr.redF());
+	const auto g = static_cast<GLfloat>(clr.greenF());
+	const auto b = static_cast<GLfloat>(clr.blueF());
+	const auto a = static_cast<GLfloat>(clr.alphaF());
+	auto pen_x = static_cast<GLfloat>(x);
+	const auto base_y = static_cast<GLfloat>(y);
+	for (const char* p = text; *p; ++p) {
+		const int c = static_cast<unsigned char>(*p);
+		if (c < GL_TEXT_FIRST_CHAR || c > GL_TEXT_LAST_CHAR) {
+			continue;
+		}
+		const Glyph& glyph = glyphs[c - GL_TEXT_FIRST_CHAR];
+		if (c != ' ') {
+			if (glyph_cnt == GL_TEXT_MAX_GLYPHS) {
+				flush();
+			}
+			// the cell starts a pixel left of the pen, see the padding in init
+			const GLfloat x0 = pen_x - 1;
+			const GLfloat y0 = base_y - glyph.top;
+			const GLfloat x1 = x0 + glyph.w;
+			const GLfloat y1 = y0 + glyph.h;
+			const GLfloat quad[6][4] = {
+				{ x0, y0, glyph.u0, glyph.v0 },
+				{ x1, y0, glyph.u1, glyph.v0 },
+				{ x0, y1, glyph.u0, glyph.v1 },
+				{ x1, y0, glyph.u1, glyph.v0 },
+				{ x1, y1, glyph.u1, glyph.v1 },
+				{ x0, y1, glyph.u0, glyph.v1 },
+			};
+			GLfloat* v = vertices + static_cast<ptrdiff_t>(glyph_cnt) * 6 * 8;
+			for (const auto& corner: quad) {
+				v[0] = corner[0];
+				v[1] = corner[1];
+				v[2] = corner[2];
+				v[3] = corner[3];
+				v[4] = r;
+				v[5] = g;
+				v[6] = b;
+				v[7] = a;
+				v += 8;
+			}
+			++glyph_cnt;
+		}
+		pen_x += glyph.advance;
+	}
+}
+
+void CUVGLTextAtlas::end() {
+	flush();
+}
+
+void CUVGLTextAtlas::flush() {
+	if (glyph_cnt == 0 || !valid() || screen_w <= 0 || screen_h <= 0) {
+		glyph_cnt = 0;
+		return;
+	}
+	glUseProgram(prog);
+	glUniform2f(screen_uniform, static_cast<GLfloat>(screen_w), static_cast<GLfloat>(screen_h));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glUniform1i(atlas_uniform, 0);
+
+	constexpr GLsizei stride = 8 * sizeof(GLfloat);
+	glVertexAttribPointer(TEXT_ATTR_POS, 2, GL_FLOAT, GL_FALSE, stride, vertices);
+	glVertexAttribPointer(TEXT_ATTR_UV, 2, GL_FLOAT, GL_FALSE, stride, vertices + 2);
+	glVertexAttribPointer(TEXT_ATTR_CLR, 4, GL_FLOAT, GL_FALSE, stride, vertices + 4);
+	glEnableVertexAttribArray(TEXT_ATTR_POS);
+	glEnableVertexAttribArray(TEXT_ATTR_UV);
+	glEnableVertexAttribArray(TEXT_ATTR_CLR);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLES, 0, glyph_cnt * 6);
+	glDisable(GL_BLEND);
+
+	glDisableVertexAttribArray(TEXT_ATTR_POS);
+	glDisableVertexAttribArray(TEXT_ATTR_UV);
+	glDisableVertexAttribArray(TEXT_ATTR_CLR);
+	glUseProgram(0);
+	glyph_cnt = 0;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+// Must be included before any Qt header
+#include "GL/glew.h"
+
+#include <QColor>
+
+// printable ASCII is all the OSD shows
+#define GL_TEXT_FIRST_CHAR  32
+#define GL_TEXT_LAST_CHAR   126
+#define GL_TEXT_GLYPH_NUM   (GL_TEXT_LAST_CHAR - GL_TEXT_FIRST_CHAR + 1)
+// glyphs per batch, a full batch is flushed and refilled
+#define GL_TEXT_MAX_GLYPHS  512
+#define GL_TEXT_ATLAS_WIDTH 512
+
+/**
+ * @note: OSD 文字的字形图集. 初始化时用 QPainter 把可打印 ASCII 字符一次性画进一张纹理,
+ * 之后每帧只把字符串展开成顶点(固定大小的数组, 无内存分配), 所有 OSD 文字一次 glDrawArrays 画完,
+ * 不再每帧创建 QPainter 做文字排版. 坐标为窗口逻辑像素, (x, y) 是基线左端, 与 QPainter::drawText 一致.
+ * NOTE: 只在 GL 线程, 上下文为当前时调用; 着色器编译失败时 valid() 为 false, 调用者退回 QPainter.
+ */
+class CUVGLTextAtlas {
+public:
+	CUVGLTextAtlas() = default;
+
+	CUVGLTextAtlas(const CUVGLTextAtlas&) = delete;
+	CUVGLTextAtlas& operator=(const CUVGLTextAtlas&) = delete;
+
+	// after glewInit, rebuilds only when the size or the device pixel ratio changed
+	void init(int point_size, qreal ratio);
+	void release();
+	[[nodiscard]] bool valid() const { return tex != 0 && prog != 0; }
+
+	// w, h: viewport in logical pixels
+	void begin(int w, int h);
+	void draw(int x, int y, const char* text, const QColor& clr);
+	void end();
+
+private:
+	typedef struct glyph_s {
+		GLfloat u0, v0, u1, v1; // in the atlas
+		GLfloat w, h;           // quad size, logical pixels
+		GLfloat top;            // quad top above the baseline
+		GLfloat advance;
+	} Glyph;
+
+	bool loadProgram();
+	void flush();
+
+	GLuint tex{};
+	GLuint prog{};
+	GLint screen_uniform{ -1 };
+	GLint atlas_uniform{ -1 };
+	int point_size{};
+	qreal ratio{};
+	Glyph glyphs[GL_TEXT_GLYPH_NUM]{};
+
+	// pos(2) uv(2) rgba(4) per vertex, 6 vertices per glyph
+	GLfloat vertices[GL_TEXT_MAX_GLYPHS * 6 * 8]{};
+	int glyph_cnt{};
+	int screen_w{};
+	int screen_h{};
+
+	// QPainter uses 0-2, the video quad 3-4
+	enum TEXT_ATTR {
+		TEXT_ATTR_POS = 5,
+		TEXT_ATTR_UV,
+		TEXT_ATTR_CLR,
+	};
+};
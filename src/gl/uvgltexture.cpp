@@ -0,0 +1,260 @@
+﻿#include "uvgltexture.hpp"
+
+#include <QDebug>
+#include <chrono>
+#include <cstring>
+
+// GL_UNPACK_ROW_LENGTH/ALIGNMENT describing rows pitch bytes apart, false if GL cannot express the pitch
+static bool glRowLayout(const int pitch, const int channels, const int w, GLint* row_length, GLint* align) {
+	const int length = pitch / channels;
+	if (length < w) {
+		return false;
+	}
+	for (int a = 8; a >= 1; a >>= 1) {
+		if ((length * channels + a - 1) / a * a == pitch) {
+			*row_length = length;
+			*align = a;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * class CUVGLTextureStream
+ */
+void CUVGLTextureStream::init() {
+	if (inited) {
+		return;
+	}
+	inited = true;
+	use_storage = GLEW_ARB_texture_storage && GLEW_ARB_texture_rg && GLEW_ARB_texture_swizzle;
+	use_pbo = (GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object) && (GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range);
+	use_persistent = use_pbo && GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+	qDebug("texture stream: immutable storage %d, pbo %d, persistent %d", use_storage, use_pbo, use_persistent);
+}
+
+void CUVGLTextureStream::release() {
+	for (auto& slot: slots) {
+		releaseSlot(slot);
+	}
+	for (auto& plane: planes) {
+		if (plane.id) {
+			glDeleteTextures(1, &plane.id);
+		}
+		plane = PlaneTex{};
+	}
+	for (bool& has: has_pending) {
+		has = false;
+	}
+	inited = false;
+}
+
+void CUVGLTextureStream::ensureTexture(const int plane, const int w, const int h, const int channels) {
+	PlaneTex& tex = planes[plane];
+	if (tex.id && tex.w == w && tex.h == h && tex.channels == channels) {
+		return;
+	}
+	// NOTE: immutable storage cannot be resized, a new resolution gets a new texture
+	if (tex.id && use_storage) {
+		glDeleteTextures(1, &tex.id);
+		tex.id = 0;
+	}
+	if (!tex.id) {
+		glGenTextures(1, &tex.id);
+	}
+	glBindTexture(GL_TEXTURE_2D, tex.id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (use_storage) {
+		static constexpr GLenum sized[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		glTexStorage2D(GL_TEXTURE_2D, 1, sized[channels - 1], w, h);
+		if (channels <= 2) {
+			// read like LUMINANCE(_ALPHA): .rgb is the first channel, .a the second
+			const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, channels == 2 ? GL_GREEN : GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+	} else {
+		static constexpr GLenum formats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+		glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(formats[channels - 1]), w, h, 0, formats[channels - 1], GL_UNSIGNED_BYTE, nullptr);
+	}
+	tex.w = w;
+	tex.h = h;
+	tex.channels = channels;
+}
+
+void CUVGLTextureStream::upload(const int plane, const uint8_t* src, const int stride, const int w, const int h, const int channels, const bool bgr) {
+	if (plane < 0 || plane >= GL_STREAM_MAX_PLANES || channels < 1 || channels > 4 || w <= 0 || h <= 0) {
+		return;
+	}
+	ensureTexture(plane, w, h, channels);
+	pending[plane] = PendingPlane{ src, stride, w, h, channels, bgr, 0, stride };
+	has_pending[plane] = true;
+}
+
+bool CUVGLTextureStream::ensureSlot(PBOSlot& slot, const size_t size) {
+	if (slot.id && slot.size >= size) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.id);
+		return true;
+	}
+	releaseSlot(slot);
+	// NOTE: a little headroom, a few more rows or a wider stride do not reallocate
+	const size_t bytes = size + size / 8;
+	glGenBuffers(1, &slot.id);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.id);
+	if (use_persistent) {
+		constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, flags);
+		slot.mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), flags));
+		if (!slot.mapped) {
+			// NOTE: advertised but not usable, orphan per frame from now on instead of reallocating every frame
+			qWarning("texture stream: persistent mapping failed, fall back to orphaning");
+			for (auto& other: slots) {
+				releaseSlot(other);
+			}
+			use_persistent = false;
+			return false;
+		}
+	} else {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+	}
+	slot.size = bytes;
+	return true;
+}
+
+void CUVGLTextureStream::waitSlot(PBOSlot& slot) {
+	if (!slot.fence) {
+		return;
+	}
+	if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+		// NOTE: the GPU is more than GL_STREAM_PBO_NUM frames behind
+		++fence_wait_cnt;
+		glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_STREAM_FENCE_TIMEOUT);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+}
+
+void CUVGLTextureStream::releaseSlot(PBOSlot& slot) {
+	if (slot.fence) {
+		glDeleteSync(slot.fence);
+	}
+	if (slot.id) {
+		if (slot.mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.id);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &slot.id);
+	}
+	slot = PBOSlot{};
+}
+
+void CUVGLTextureStream::copyPlane(uint8_t* dst, const PendingPlane& p) {
+	const size_t row_bytes = static_cast<size_t>(p.w) * p.channels;
+	if (p.pitch == p.stride) {
+		// one copy, the stride padding comes along
+		memcpy(dst, p.src, static_cast<size_t>(p.stride) * (p.h - 1) + row_bytes);
+		return;
+	}
+	for (int y = 0; y < p.h; ++y) {
+		memcpy(dst + static_cast<size_t>(y) * p.pitch, p.src + static_cast<ptrdiff_t>(y) * p.stride, row_bytes);
+	}
+}
+
+void CUVGLTextureStream::texSubImage(const PendingPlane& p, const void* pixels, const int pitch) const {
+	static constexpr GLenum formats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+	static constexpr GLenum rg_formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	GLenum format = use_storage ? rg_formats[p.channels - 1] : formats[p.channels - 1];
+	if (p.bgr) {
+		format = p.channels == 4 ? GL_BGRA : GL_BGR;
+	}
+	GLint row_length = 0;
+	GLint align = 1;
+	if (glRowLayout(pitch, p.channels, p.w, &row_length, &align)) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, align);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p.w, p.h, format, GL_UNSIGNED_BYTE, pixels);
+		return;
+	}
+	// NOTE: a pitch GL cannot describe (odd RGB strides), row by row
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	for (int y = 0; y < p.h; ++y) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, p.w, 1, format, GL_UNSIGNED_BYTE, static_cast<const uint8_t*>(pixels) + static_cast<ptrdiff_t>(y) * pitch);
+	}
+}
+
+double CUVGLTextureStream::commit() {
+	const auto start = std::chrono::steady_clock::now();
+
+	// layout inside the PBO: planes at aligned offsets, the source stride kept when GL can express it
+	size_t total = 0;
+	for (int i = 0; i < GL_STREAM_MAX_PLANES; ++i) {
+		if (!has_pending[i]) {
+			continue;
+		}
+		PendingPlane& p = pending[i];
+		GLint row_length = 0;
+		GLint align = 0;
+		p.pitch = glRowLayout(p.stride, p.channels, p.w, &row_length, &align) ? p.stride : p.w * p.channels;
+		p.offset = total;
+		total += (static_cast<size_t>(p.pitch) * p.h + GL_STREAM_PLANE_ALIGN - 1) / GL_STREAM_PLANE_ALIGN * GL_STREAM_PLANE_ALIGN;
+	}
+
+	uint8_t* dst = nullptr;
+	if (use_pbo && total > 0) {
+		PBOSlot& slot = slots[slot_index];
+		slot_index = (slot_index + 1) % GL_STREAM_PBO_NUM;
+		if (ensureSlot(slot, total)) {
+			if (use_persistent) {
+				waitSlot(slot);
+				dst = slot.mapped;
+			} else {
+				// orphan: the driver hands out fresh memory while the GPU still reads the old one
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(slot.size), nullptr, GL_STREAM_DRAW);
+				dst = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(total), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+			}
+		}
+		if (dst) {
+			for (int i = 0; i < GL_STREAM_MAX_PLANES; ++i) {
+				if (has_pending[i]) {
+					copyPlane(dst + pending[i].offset, pending[i]);
+				}
+			}
+			if (!use_persistent) {
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		} else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+	}
+
+	for (int i = 0; i < GL_STREAM_MAX_PLANES; ++i) {
+		if (!has_pending[i]) {
+			continue;
+		}
+		const PendingPlane& p = pending[i];
+		glBindTexture(GL_TEXTURE_2D, planes[i].id);
+		if (dst) {
+			// NOTE: an offset into the bound PBO, the driver copies asynchronously
+			texSubImage(p, reinterpret_cast<const void*>(p.offset), p.pitch);
+		} else {
+			texSubImage(p, p.src, p.stride);
+		}
+		has_pending[i] = false;
+	}
+
+	if (dst) {
+		if (use_persistent) {
+			slots[(slot_index + GL_STREAM_PBO_NUM - 1) % GL_STREAM_PBO_NUM].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
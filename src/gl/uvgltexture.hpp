@@ -0,0 +1,91 @@
+﻿#pragma once
+
+// Must be included before any Qt header
+#include "GL/glew.h"
+
+#include <cstdint>
+
+// pixel unpack buffers in flight, the CPU fills one while the GPU still reads the others
+#define GL_STREAM_PBO_NUM       3
+#define GL_STREAM_MAX_PLANES    3
+// plane offset inside a PBO, cache line and the widest GL_UNPACK_ALIGNMENT
+#define GL_STREAM_PLANE_ALIGN   64
+// longest wait for the GPU to release a persistently mapped PBO, ns
+#define GL_STREAM_FENCE_TIMEOUT 20000000
+
+/**
+ * @note: 视频帧纹理上传. 纹理存储按分辨率和格式分配一次(支持 ARB_texture_storage 时为不可变存储),
+ * 之后每帧只用 glTexSubImage2D 更新, 不再每帧 glTexImage2D 重新分配.
+ * 像素先拷入由 GL_STREAM_PBO_NUM 个像素缓冲对象(PBO)组成的环, 再由驱动从 PBO 异步传入纹理,
+ * GUI 线程不等待驱动同步拷贝, 本帧的传输与上一帧的绘制重叠. 支持 ARB_buffer_storage 时 PBO 持久映射,
+ * 每个槽用 fence 确认 GPU 读完后再覆写; 否则每帧 orphan 后重新映射. 不支持 PBO 时直接从内存上传.
+ * 不可变存储用 R8/RG8 并把 alpha 映射到 green, 着色器与 LUMINANCE/LUMINANCE_ALPHA 时一样读 .r/.a.
+ * NOTE: 只在 GL 线程, 上下文为当前时调用; release 必须在上下文销毁前调用.
+ */
+class CUVGLTextureStream {
+public:
+	CUVGLTextureStream() = default;
+
+	CUVGLTextureStream(const CUVGLTextureStream&) = delete;
+	CUVGLTextureStream& operator=(const CUVGLTextureStream&) = delete;
+
+	// after glewInit, picks the upload path the driver supports
+	void init();
+	void release();
+
+	// queue one plane of channels (1: R, 2: RG, 3: RGB, 4: RGBA) bytes per pixel, bgr swaps R and B
+	void upload(int plane, const uint8_t* src, int stride, int w, int h, int channels, bool bgr = false);
+	// copy the queued planes into the ring and update the textures, return the CPU time spent in ms
+	double commit();
+
+	[[nodiscard]] GLuint texture(const int plane) const { return planes[plane].id; }
+	[[nodiscard]] bool usesPBO() const { return use_pbo; }
+	[[nodiscard]] bool persistent() const { return use_persistent; }
+	// times the CPU had to wait for the GPU to release a PBO
+	[[nodiscard]] int fenceWaitCount() const { return fence_wait_cnt; }
+
+private:
+	typedef struct plane_tex_s {
+		GLuint id;
+		int w;
+		int h;
+		int channels;
+	} PlaneTex;
+
+	typedef struct pending_plane_s {
+		const uint8_t* src;
+		int stride;
+		int w;
+		int h;
+		int channels;
+		bool bgr;
+		size_t offset; // inside the PBO
+		int pitch;     // row pitch inside the PBO
+	} PendingPlane;
+
+	typedef struct pbo_slot_s {
+		GLuint id;
+		size_t size;
+		uint8_t* mapped; // persistent mapping
+		GLsync fence;
+	} PBOSlot;
+
+	void ensureTexture(int plane, int w, int h, int channels);
+	bool ensureSlot(PBOSlot& slot, size_t size);
+	void waitSlot(PBOSlot& slot);
+	void releaseSlot(PBOSlot& slot);
+	static void copyPlane(uint8_t* dst, const PendingPlane& p);
+	void texSubImage(const PendingPlane& p, const void* pixels, int pitch) const;
+
+	bool inited{};
+	bool use_pbo{};
+	bool use_persistent{};
+	bool use_storage{};
+
+	PlaneTex planes[GL_STREAM_MAX_PLANES]{};
+	PendingPlane pending[GL_STREAM_MAX_PLANES]{};
+	bool has_pending[GL_STREAM_MAX_PLANES]{};
+	PBOSlot slots[GL_STREAM_PBO_NUM]{};
+	int slot_index{};
+	int fence_wait_cnt{};
+};
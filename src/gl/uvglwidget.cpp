@@ -7,13 +7,29 @@
 #include <sstream>
 #include <iomanip>
 
-static int glPixFmt(const int type) {
+// pix_fmt uniform of the shader
+enum GL_PIX_FMT {
+	GL_PIX_FMT_PLANAR = 0, // I420/YV12
+	GL_PIX_FMT_NV12,
+	GL_PIX_FMT_NV21,
+	GL_PIX_FMT_RGB,        // .rgb of a packed texture
+	GL_PIX_FMT_ARGB,       // .gba
+	GL_PIX_FMT_ABGR,       // .abg
+};
+
+// texture channels, R/B swap and shader format of a packed frame, false if it cannot be drawn
+static bool glPackedFormat(const int type, int* channels, bool* bgr, int* pix_fmt) {
+	*bgr = type == PIX_FMT_BGR || type == PIX_FMT_BGRA;
+	*pix_fmt = GL_PIX_FMT_RGB;
 	switch (type) {
-		case PIX_FMT_BGR: return GL_BGR;
-		case PIX_FMT_RGB: return GL_RGB;
-		case PIX_FMT_BGRA: return GL_BGRA;
-		case PIX_FMT_RGBA: return GL_RGBA;
-		default: return -1;
+		case PIX_FMT_GRAY: *channels = 1; return true;
+		case PIX_FMT_RGB:
+		case PIX_FMT_BGR: *channels = 3; return true;
+		case PIX_FMT_RGBA:
+		case PIX_FMT_BGRA: *channels = 4; return true;
+		case PIX_FMT_ARGB: *channels = 4; *pix_fmt = GL_PIX_FMT_ARGB; return true;
+		case PIX_FMT_ABGR: *channels = 4; *pix_fmt = GL_PIX_FMT_ABGR; return true;
+		default: return false;
 	}
 }
 
@@ -44,6 +60,7 @@ GLuint CUVGLWidget::prog_yuv{};
 GLuint CUVGLWidget::texUniformY{};
 GLuint CUVGLWidget::texUniformU{};
 GLuint CUVGLWidget::texUniformV{};
+GLuint CUVGLWidget::pixFmtUniform{};
 
 /**
  * class CUVGLWidget
@@ -62,7 +79,13 @@ CUVGLWidget::CUVGLWidget(QWidget* parent) : QOpenGLWidget(parent) {
 	std::copy(tmp.begin(), tmp.end(), textures);
 }
 
-CUVGLWidget::~CUVGLWidget() = default;
+CUVGLWidget::~CUVGLWidget() {
+	// NOTE: textures and buffers belong to this widget's context
+	makeCurrent();
+	stream.release();
+	osd.release();
+	doneCurrent();
+}
 
 void CUVGLWidget::setAspectRatio(const double ratio) {
 	aspect_ratio = ratio;
@@ -74,15 +97,14 @@ void CUVGLWidget::setAspectRatio(const double ratio) {
 }
 
 void CUVGLWidget::drawFrame(const CUVFrame* pFrame) const {
-	if (pFrame->type == PIX_FMT_IYUV || pFrame->type == PIX_FMT_YV12) {
-		drawYUV(pFrame);
-	} else {
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		glRasterPos3f(-1.0f, 1.0f, 0);
-		glPixelZoom(static_cast<GLfloat>(width()) / static_cast<GLfloat>(pFrame->w), static_cast<GLfloat>(-height()) / static_cast<GLfloat>(pFrame->h));
-		glDrawPixels(pFrame->w, pFrame->h, glPixFmt(pFrame->type), GL_UNSIGNED_BYTE, pFrame->buf.base);
+	last_upload_ms = drawFrame(pFrame, &stream);
+}
+
+double CUVGLWidget::drawFrame(const CUVFrame* pFrame, CUVGLTextureStream* tex) const {
+	if (pix_fmt_is_planar_yuv(pFrame->type)) {
+		return drawYUV(pFrame, tex);
 	}
+	return drawPacked(pFrame, tex);
 }
 
 void CUVGLWidget::drawTexture(const CUVRect& rc, const GLTexture* tex) const {
@@ -141,6 +163,30 @@ void CUVGLWidget::drawText(const QPoint& lb, const char* text, const int fontsiz
 	painter.drawText(lb, text);
 }
 
+void CUVGLWidget::beginOSD() {
+	// NOTE: no-op unless the font size or the screen's pixel ratio changed
+	osd.init(OSD_FONT_SIZE, devicePixelRatioF());
+	glViewport(0, 0, static_cast<GLsizei>(width() * devicePixelRatioF()), static_cast<GLsizei>(height() * devicePixelRatioF()));
+	osd.begin(width(), height());
+	// NOTE: the video quad arrays hold 4 vertices, the text batch must not fetch from them
+	glDisableVertexAttribArray(VER_ATTR_VER);
+	glDisableVertexAttribArray(VER_ATTR_TEX);
+}
+
+void CUVGLWidget::drawOSDText(const int x, const int y, const char* text, const QColor& clr) {
+	if (osd.valid()) {
+		osd.draw(x, y, text, clr);
+	} else {
+		drawText(QPoint(x, y), text, OSD_FONT_SIZE, clr);
+	}
+}
+
+void CUVGLWidget::endOSD() {
+	osd.end();
+	glEnableVertexAttribArray(VER_ATTR_VER);
+	glEnableVertexAttribArray(VER_ATTR_TEX);
+}
+
 void CUVGLWidget::initializeGL() {
 	if (!s_glew_init.test_and_set()) {
 		if (glewInit() != GLEW_OK) {
@@ -151,7 +197,7 @@ void CUVGLWidget::initializeGL() {
 	}
 	initVAO();
 	loadYUVShader();
-	initYUV();
+	stream.init();
 }
 
 void CUVGLWidget::resizeGL(const int w, const int h) {
@@ -225,13 +271,36 @@ void CUVGLWidget::loadYUVShader() {
     uniform sampler2D tex_y;
     uniform sampler2D tex_u;
     uniform sampler2D tex_v;
+    // 0: planar(I420/YV12), 1: NV12, 2: NV21, interleaved chroma is uploaded as LUMINANCE_ALPHA
+    // 3: packed RGB/BGR/RGBA/BGRA/GRAY in tex_y, 4: ARGB, 5: ABGR uploaded as RGBA
+    uniform int pix_fmt;
 
     void main(){
         vec3 yuv;
         vec3 rgb;
+        if (pix_fmt >= 3) {
+            vec4 pixel = texture2D(tex_y, texOut);
+            if (pix_fmt == 4) {
+                rgb = pixel.gba;
+            } else if (pix_fmt == 5) {
+                rgb = pixel.abg;
+            } else {
+                rgb = pixel.rgb;
+            }
+            gl_FragColor = vec4(rgb, 1);
+            return;
+        }
         yuv.x = texture2D(tex_y, texOut).r;
-        yuv.y = texture2D(tex_u, texOut).r - 0.5;
-        yuv.z = texture2D(tex_v, texOut).r - 0.5;
+        if (pix_fmt == 1) {
+            yuv.y = texture2D(tex_u, texOut).r - 0.5;
+            yuv.z = texture2D(tex_u, texOut).a - 0.5;
+        } else if (pix_fmt == 2) {
+            yuv.y = texture2D(tex_u, texOut).a - 0.5;
+            yuv.z = texture2D(tex_u, texOut).r - 0.5;
+        } else {
+            yuv.y = texture2D(tex_u, texOut).r - 0.5;
+            yuv.z = texture2D(tex_v, texOut).r - 0.5;
+        }
         rgb = mat3(
 				1, 1, 1,
 				0, -0.39465, 2.03211,
@@ -274,6 +343,7 @@ void CUVGLWidget::loadYUVShader() {
 	texUniformY = glGetUniformLocation(prog_yuv, "tex_y");
 	texUniformU = glGetUniformLocation(prog_yuv, "tex_u");
 	texUniformV = glGetUniformLocation(prog_yuv, "tex_v");
+	pixFmtUniform = glGetUniformLocation(prog_yuv, "pix_fmt");
 
 	qDebug("loadYUVShader ok");
 }
@@ -286,17 +356,6 @@ void CUVGLWidget::initVAO() const {
 	glEnableVertexAttribArray(VER_ATTR_TEX);
 }
 
-void CUVGLWidget::initYUV() {
-	glGenTextures(3, tex_yuv);
-	for (const auto& tex: tex_yuv) {
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	}
-}
-
 void CUVGLWidget::checkShaderCompileStatus(const GLuint shader, const std::string& name) {
 	GLint status = 0;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
@@ -325,37 +384,72 @@ void CUVGLWidget::checkProgramLinkStatus(const GLuint program) {
 	}
 }
 
-void CUVGLWidget::drawYUV(const CUVFrame* pFrame) const {
-	assert(pFrame->type == PIX_FMT_IYUV || pFrame->type == PIX_FMT_YV12);
+double CUVGLWidget::drawYUV(const CUVFrame* pFrame, CUVGLTextureStream* tex) const {
+	assert(pix_fmt_is_planar_yuv(pFrame->type));
 
 	const int w = pFrame->w;
 	const int h = pFrame->h;
-	const int y_size = w * h;
-	const auto y = reinterpret_cast<GLubyte*>(pFrame->buf.base);
-	GLubyte* u = y + y_size;
-	GLubyte* v = u + (y_size >> 2);
-	if (pFrame->type == PIX_FMT_YV12) {
-		std::swap(u, v);
-	}
+	// NOTE: packed frames use the legacy w/2 x h/2 chroma, decoder planes round up for odd sizes
+	const int cw = pFrame->isStrided() ? (w + 1) >> 1 : w >> 1;
+	const int ch = pFrame->isStrided() ? (h + 1) >> 1 : h >> 1;
+	const bool semi_planar = pFrame->type == PIX_FMT_NV12 || pFrame->type == PIX_FMT_NV21;
+
+	uint8_t* planes[4]{};
+	int strides[4]{};
+	pFrame->planes(planes, strides);
 
 	glUseProgram(prog_yuv);
+	glUniform1i(static_cast<GLint>(pixFmtUniform), pFrame->type == PIX_FMT_NV12 ? GL_PIX_FMT_NV12 : pFrame->type == PIX_FMT_NV21 ? GL_PIX_FMT_NV21 : GL_PIX_FMT_PLANAR);
 
+	// textures keep their storage, only the pixels are streamed through the PBO ring
+	tex->upload(0, planes[0], strides[0], w, h, 1);
+	if (semi_planar) {
+		tex->upload(1, planes[1], strides[1], cw, ch, 2);
+	} else {
+		tex->upload(1, planes[1], strides[1], cw, ch, 1);
+		tex->upload(2, planes[2], strides[2], cw, ch, 1);
+	}
+	const double upload_ms = tex->commit();
+
+	for (int i = 0; i < (semi_planar ? 2 : 3); ++i) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, tex->texture(i));
+	}
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex_yuv[0]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, y);
 	glUniform1i(static_cast<GLint>(texUniformY), 0);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex_yuv[1]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w / 2, h / 2, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, u);
 	glUniform1i(static_cast<GLint>(texUniformU), 1);
-
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, tex_yuv[2]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w / 2, h / 2, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, v);
 	glUniform1i(static_cast<GLint>(texUniformV), 2);
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
 	glUseProgram(0);
+	return upload_ms;
+}
+
+double CUVGLWidget::drawPacked(const CUVFrame* pFrame, CUVGLTextureStream* tex) const {
+	int channels = 0;
+	bool bgr = false;
+	int pix_fmt = GL_PIX_FMT_RGB;
+	if (!glPackedFormat(pFrame->type, &channels, &bgr, &pix_fmt)) {
+		return 0;
+	}
+
+	uint8_t* planes[4]{};
+	int strides[4]{};
+	pFrame->planes(planes, strides);
+
+	// same quad and program as YUV, BGR is swapped by the upload format instead of the shader
+	tex->upload(0, planes[0], strides[0], pFrame->w, pFrame->h, channels, bgr);
+	const double upload_ms = tex->commit();
+
+	glUseProgram(prog_yuv);
+	glUniform1i(static_cast<GLint>(pixFmtUniform), pix_fmt);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tex->texture(0));
+	glUniform1i(static_cast<GLint>(texUniformY), 0);
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glUseProgram(0);
+	return upload_ms;
 }
@@ -6,10 +6,14 @@
 #include <atomic>
 #include <QOpenGLWidget>
 
+#include "uvgltext.hpp"
+#include "uvgltexture.hpp"
 #include "util/uvframe.hpp"
 #include "util/uvgl.hpp"
 #include "util/uvgui.hpp"
 
+#define OSD_FONT_SIZE 14
+
 void bindTexture(GLTexture* tex, QImage* img);
 
 class CUVGLWidget : public QOpenGLWidget {
@@ -25,6 +29,14 @@ public:
 	void drawRect(const CUVRect& rc, CUVColor clr, int line_width = 1, bool bFill = false) const;
 	void drawText(const QPoint& lb, const char* text, int fontsize, const QColor& clr);
 
+	// OSD text batch from the glyph atlas, falls back to drawText when the atlas is unavailable
+	void beginOSD();
+	void drawOSDText(int x, int y, const char* text, const QColor& clr);
+	void endOSD();
+
+	// CPU time of the last texture upload in ms
+	[[nodiscard]] double uploadMs() const { return last_upload_ms; }
+
 protected:
 	void initializeGL() override;
 	void resizeGL(int w, int h) override;
@@ -35,17 +47,23 @@ protected:
 
 	static void loadYUVShader();
 	void initVAO() const;
-	void initYUV();
 	static void checkShaderCompileStatus(GLuint shader, const std::string& name);
 	static void checkProgramLinkStatus(GLuint program);
-	void drawYUV(const CUVFrame* pFrame) const;
+	// draw with the textures of tex, return the upload time in ms
+	double drawFrame(const CUVFrame* pFrame, CUVGLTextureStream* tex) const;
+	double drawYUV(const CUVFrame* pFrame, CUVGLTextureStream* tex) const;
+	double drawPacked(const CUVFrame* pFrame, CUVGLTextureStream* tex) const;
 
 	static std::atomic_flag s_glew_init;
 	static GLuint prog_yuv;
 	static GLuint texUniformY;
 	static GLuint texUniformU;
 	static GLuint texUniformV;
-	GLuint tex_yuv[3]{};
+	static GLuint pixFmtUniform;
+	// NOTE: drawFrame is const, uploads only touch the texture cache
+	mutable CUVGLTextureStream stream;
+	mutable double last_upload_ms{};
+	CUVGLTextAtlas osd;
 
 	double aspect_ratio{};
 	GLfloat vertices[8]{};
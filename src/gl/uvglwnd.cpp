@@ -1,7 +1,5 @@
 ﻿#include "uvglwnd.hpp"
 
-#include <sstream>
-#include <iomanip>
 #include <QPainter>
 
 CUVGLWnd::CUVGLWnd(QWidget* parent) : CUVVideoWnd(parent), CUVGLWidget(parent) {
@@ -36,6 +34,8 @@ void CUVGLWnd::paintGL() {
 //		 painter.drawPixmap(rc, pixmap);
 	} else {
 		drawFrame(&last_frame);
+		addUploadTime(uploadMs());
+		beginOSD();
 		if (draw_time) {
 			drawTime();
 		}
@@ -45,39 +45,25 @@ void CUVGLWnd::paintGL() {
 		if (draw_resolution) {
 			drawResolution();
 		}
+		endOSD();
 	}
 }
 
 void CUVGLWnd::drawTime() {
-	std::ostringstream oss;
-	int sec = last_frame.ts / 1000; // NOLINT
-	int m = sec / 60;
-	const int s = sec % 60;
-	const int h = m / 60;
-	m = m % 60;
-	oss << std::setfill('0') << std::setw(2) << h << ":"
-			<< std::setfill('0') << std::setw(2) << m << ":"
-			<< std::setfill('0') << std::setw(2) << s;
-	const std::string szTime = oss.str();
+	char szTime[16];
 	// Left Top
-	constexpr QPoint pt(10, 40);
-	drawText(pt, szTime.c_str(), 14, Qt::red);
+	drawOSDText(10, 40, osdTime(szTime, sizeof(szTime)), Qt::red);
 }
 
 void CUVGLWnd::drawFPS() {
-	std::ostringstream oss;
-	oss << "FPS:" << fps;
-	const std::string szFPS = oss.str();
+	char szFPS[64];
 	// Right Top
-	const QPoint pt(width() - 100, 40);
-	drawText(pt, szFPS.c_str(), 14, Qt::red);
+	drawOSDText(width() - 220, 40, osdFPS(szFPS, sizeof(szFPS)), Qt::red);
+	drawOSDText(width() - 220, 60, osdPresent(szFPS, sizeof(szFPS)), Qt::red);
 }
 
 void CUVGLWnd::drawResolution() {
-	std::ostringstream oss;
-	oss << last_frame.w << " X " << last_frame.h;
-	const std::string szResolution = oss.str();
+	char szResolution[32];
 	// Left Bottom
-	const QPoint pt(10, height() - 10);
-	drawText(pt, szResolution.c_str(), 14, Qt::red);
+	drawOSDText(10, height() - 10, osdResolution(szResolution, sizeof(szResolution)), Qt::red);
 }
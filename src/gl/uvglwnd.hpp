@@ -11,6 +11,8 @@ public:
 
 	void setgeometry(const QRect& rc) override;
 	void Update() override;
+	// NOTE: CUVGLWidget is a private base, a cast from outside cannot reach it
+	QOpenGLWidget* glWidget() override { return this; }
 
 protected:
 	void paintGL() override;
@@ -9,9 +9,12 @@ typedef struct media_s {
 	std::string src;
 	std::string decscr{};
 	int index{};
+	// live sources: minimal buffering, newest frame only, latency over smoothness
+	bool low_latency{};
 
 	media_s() {
 		type = MEDIA_TYPE_NONE;
 		index = -1;
+		low_latency = false;
 	}
 } CUVMedia;
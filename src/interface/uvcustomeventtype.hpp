@@ -8,5 +8,6 @@ public:
 		OpenMediaFailed,
 		PlayerEOF,
 		PlayerError,
+		PlayerProbeStale,
 	};
 };
@@ -23,8 +23,11 @@ void CUVMultiViewPrivate::initUI() {
 
 	q->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+	if (g_confile->get<bool>("mv_compositor", "ui", false)) {
+		compositor = new CUVGLCompositor(q);
+	}
 	for (int i = 0; i < MV_STYLE_MAXNUM; ++i) {
-		const auto player = new CUVVideoWidget(q);
+		const auto player = new CUVVideoWidget(q, compositor);
 		player->playerid = i + 1;
 		views.push_back(player);
 	}
@@ -51,6 +54,11 @@ void CUVMultiViewPrivate::updateUI() {
 
 	const int row = table.row, col = table.col;
 	if (row == 0 || col == 0) return;
+	if (compositor) {
+		compositor->setGeometry(q->rect());
+		compositor->lower();
+		compositor->invalidate();
+	}
 	const int cell_w = q->width() / col, cell_h = q->height() / row;
 
 	const int margin_x = (q->width() - cell_w * col) / 2, margin_y = (q->height() - cell_h * row) / 2;
@@ -133,6 +141,9 @@ void CUVMultiViewPrivate::stretch(QWidget* wdg) {
 		wdg->show();
 		bStretch = true;
 	}
+	if (compositor) {
+		compositor->invalidate();
+	}
 }
 
 CUVVideoWidget* CUVMultiViewPrivate::getPlayerByID(const int playerid) {
@@ -214,6 +225,9 @@ void CUVMultiView::mouseReleaseEvent(QMouseEvent* event) {
 		CUVVideoWidget* player1 = d->getPlayerByPos(d->ptMousePress);
 		if (CUVVideoWidget* player2 = d->getPlayerByPos(event->pos()); player1 && player2 && player1 != player2) {
 			CUVMultiViewPrivate::exchangeCells(player1, player2);
+			if (d->compositor) {
+				d->compositor->invalidate();
+			}
 		}
 	} else if (d->action == MERGE) {
 		const QRect rc = adjustRect(d->ptMousePress, event->pos());
@@ -241,7 +255,9 @@ void CUVMultiView::mouseMoveEvent(QMouseEvent* event) {
 			if (gettick() - d->tsMousePress < 300) return;
 			d->action = EXCHANGE;
 			setCursor(Qt::OpenHandCursor);
-			d->labDrag->setPixmap(player->grab().scaled(d->labDrag->size()));
+			// NOTE: composited players are transparent, the picture is in the compositor
+			const QPixmap pixmap = d->compositor ? QPixmap::fromImage(d->compositor->grabTile(player)) : player->grab();
+			d->labDrag->setPixmap(pixmap.scaled(d->labDrag->size()));
 			d->labDrag->setVisible(true);
 		}
 		if (d->labDrag->isVisible()) {
@@ -4,6 +4,7 @@
 #include "uvmultiview.hpp"
 #include "uvtable.hpp"
 #include "uvvideowidget.hpp"
+#include "gl/uvglcompositor.hpp"
 
 class CUVMultiView;
 
@@ -37,6 +38,8 @@ public:
 	QVector<QWidget*> views{};
 	QLabel* labRect{ nullptr };
 	QLabel* labDrag{ nullptr };
+	// one GL surface under all players, null when every player has its own window
+	CUVGLCompositor* compositor{ nullptr };
 
 	QPoint ptMousePress{};
 	uint64_t tsMousePress{};
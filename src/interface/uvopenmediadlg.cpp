@@ -61,6 +61,10 @@ CUVNetWorkTab::CUVNetWorkTab(QWidget* parent) : QWidget(parent) {
 	}
 
 	vbox->addWidget(lineEdit);
+
+	chkLowLatency = new QCheckBox(tr("Low latency"), this);
+	chkLowLatency->setChecked(g_confile->get<bool>("last_network_low_latency", "media", g_confile->get<bool>("low_latency", "video", false)));
+	vbox->addWidget(chkLowLatency);
 	vbox->addStretch();
 
 	setLayout(vbox);
@@ -118,7 +122,9 @@ void CUVOpenMediaDlg::accept() {
 			if (const auto nettab = qobject_cast<CUVNetWorkTab*>(tab->currentWidget())) {
 				media.type = MEDIA_TYPE_NETWORK;
 				media.src = nettab->lineEdit->text().toUtf8().data();
+				media.low_latency = nettab->chkLowLatency->isChecked();
 				g_confile->setValue("last_network_source", media.src, "media");
+				g_confile->set<bool>("last_network_low_latency", media.low_latency, "media");
 				g_confile->save();
 			}
 			break;
@@ -128,6 +134,7 @@ void CUVOpenMediaDlg::accept() {
 				media.type = MEDIA_TYPE_CAPTURE;
 				media.src = qPrintable(captab->comboBox->currentText());
 				media.index = captab->comboBox->currentIndex();
+				media.low_latency = g_confile->get<bool>("low_latency", "video", false);
 			}
 			break;
 		}
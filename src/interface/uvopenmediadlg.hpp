@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <QCheckBox>
 #include <QDialog>
 #include <QLineEdit>
 #include <QPushButton>
@@ -26,6 +27,7 @@ public:
 	~CUVNetWorkTab() override;
 
 	QLineEdit* lineEdit{ nullptr };
+	QCheckBox* chkLowLatency{ nullptr };
 };
 
 class CUVCaptureTab final : public QWidget {
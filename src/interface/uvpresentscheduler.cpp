@@ -0,0 +1,159 @@
+﻿#include "uvpresentscheduler.hpp"
+
+#include <QOpenGLWidget>
+#include <QScreen>
+#include <QTimer>
+#include <QWindow>
+#include <algorithm>
+#include <cmath>
+
+#include "uvvideowidget.hpp"
+#include "video/uvclock.hpp"
+
+CUVPresentScheduler* CUVPresentScheduler::instance(QWidget* wdg) {
+	QWidget* top = wdg->window();
+	// NOTE: findChild casts with qobject_cast, the class needs its own meta object (Q_OBJECT)
+	if (auto scheduler = top->findChild<CUVPresentScheduler*>(QString(), Qt::FindDirectChildrenOnly)) {
+		return scheduler;
+	}
+	return new CUVPresentScheduler(top);
+}
+
+CUVPresentScheduler::CUVPresentScheduler(QWidget* window) : QObject(window), window(window) {
+	timer = new QTimer(this);
+	timer->setTimerType(Qt::PreciseTimer);
+	timer->setSingleShot(true);
+	connect(timer, &QTimer::timeout, this, [this] { onTick(); });
+	updatePeriod();
+	// until the first frameSwapped, any phase is as good as another
+	vsync_phase = stats_tick = CUVClock::now();
+}
+
+void CUVPresentScheduler::add(CUVVideoWidget* wdg) {
+	for (const auto& client: clients) {
+		if (client.wdg == wdg) {
+			return;
+		}
+	}
+	clients.push_back(Client{ wdg, false, 0, 0, 0, 0, 0, 0, 0, 0 });
+	if (!timer->isActive()) {
+		updatePeriod();
+		arm();
+	}
+}
+
+void CUVPresentScheduler::remove(CUVVideoWidget* wdg) {
+	clients.erase(std::remove_if(clients.begin(), clients.end(), [wdg](const Client& c) { return c.wdg == wdg; }), clients.end());
+	if (clients.empty()) {
+		timer->stop();
+	}
+}
+
+void CUVPresentScheduler::watch(QOpenGLWidget* gl) {
+	if (!gl) {
+		return;
+	}
+	watched.erase(std::remove_if(watched.begin(), watched.end(), [](const QPointer<QOpenGLWidget>& w) { return w.isNull(); }), watched.end());
+	if (std::find(watched.begin(), watched.end(), gl) != watched.end()) {
+		return;
+	}
+	watched.emplace_back(gl);
+	// NOTE: every GL widget of the window swaps at the same vsync, any of them gives the phase
+	connect(gl, &QOpenGLWidget::frameSwapped, this, [this] { vsync_phase = CUVClock::now(); });
+}
+
+void CUVPresentScheduler::onTick() {
+	const double now = CUVClock::now();
+	// picked now, on screen at the next vsync
+	const double display_time = lastVsync(now) + refresh_period;
+
+	for (size_t i = 0; i < clients.size();) {
+		CUVVideoWidget* wdg = clients[i].wdg;
+		if (!wdg) {
+			clients.erase(clients.begin() + static_cast<ptrdiff_t>(i));
+			continue;
+		}
+		if (wdg->window() != window) {
+			// the multiview went fullscreen or came back, follow it to its new window
+			clients.erase(clients.begin() + static_cast<ptrdiff_t>(i));
+			wdg->startPresent();
+			continue;
+		}
+		present(clients[i], display_time);
+		++i;
+	}
+
+	if (now - stats_tick >= 1000) {
+		publish();
+		updatePeriod();
+		stats_tick = now;
+	}
+	if (!clients.empty()) {
+		arm();
+	}
+}
+
+void CUVPresentScheduler::present(Client& client, const double display_time) const {
+	// NOTE: update() only marks the tile, Qt repaints all of them in one batch
+	if (!client.wdg->present(display_time)) {
+		++client.vsyncs;
+		return;
+	}
+	const double pts = static_cast<double>(client.wdg->videownd->last_frame.ts);
+	if (client.has_last) {
+		const double pts_step = pts - client.last_pts;
+		if (pts_step > 0 && pts_step < AV_MAX_FRAME_DURATION) {
+			if (client.frame_ms <= 0 || pts_step < client.frame_ms * PRESENT_DROP_FACTOR) {
+				// usual cadence, follow slow frame rate changes
+				client.frame_ms = client.frame_ms <= 0 ? pts_step : client.frame_ms * 0.9 + pts_step * 0.1;
+			} else {
+				client.drops += static_cast<int>(std::lround(pts_step / client.frame_ms)) - 1;
+			}
+			// judder: the frame stayed on screen longer or shorter than its pts step
+			const double error = display_time - client.last_display - pts_step;
+			client.judder_sum += error * error;
+			++client.judder_cnt;
+			// vsyncs beyond what the frame duration calls for
+			const int expected = std::max(1, static_cast<int>(std::lround(client.frame_ms / refresh_period)));
+			client.repeats += std::max(0, client.vsyncs - expected);
+		}
+	}
+	client.has_last = true;
+	client.last_pts = pts;
+	client.last_display = display_time;
+	client.vsyncs = 1;
+}
+
+void CUVPresentScheduler::publish() {
+	for (auto& client: clients) {
+		if (!client.wdg) {
+			continue;
+		}
+		CUVVideoWnd* wnd = client.wdg->videownd;
+		wnd->judder_ms = client.judder_cnt > 0 ? std::sqrt(client.judder_sum / client.judder_cnt) : 0;
+		wnd->present_drops = client.drops;
+		wnd->present_repeats = client.repeats;
+		client.judder_sum = 0;
+		client.judder_cnt = client.drops = client.repeats = 0;
+	}
+}
+
+void CUVPresentScheduler::arm() {
+	const double now = CUVClock::now();
+	double next = lastVsync(now) + PRESENT_TICK_DELAY_MS;
+	if (next <= now) {
+		next += refresh_period;
+	}
+	timer->start(static_cast<int>(std::lround(next - now)));
+}
+
+void CUVPresentScheduler::updatePeriod() {
+	const QWindow* handle = window->windowHandle();
+	const QScreen* screen = handle ? handle->screen() : nullptr;
+	const qreal rate = screen ? screen->refreshRate() : 0;
+	refresh_period = 1000.0 / (rate >= 10 ? rate : DEFAULT_REFRESH_RATE);
+}
+
+double CUVPresentScheduler::lastVsync(const double now) const {
+	return vsync_phase + std::floor((now - vsync_phase) / refresh_period) * refresh_period;
+}
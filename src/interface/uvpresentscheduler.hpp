@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <vector>
+
+class QOpenGLWidget;
+class QTimer;
+class QWidget;
+class CUVVideoWidget;
+
+// refresh rate when the screen does not report one, Hz
+#define DEFAULT_REFRESH_RATE        60
+// tick this long after the estimated vsync, the repaint then makes the next one, ms
+#define PRESENT_TICK_DELAY_MS       1
+// a frame whose pts step is this many times the usual one means frames were dropped before display
+#define PRESENT_DROP_FACTOR         1.5
+
+/**
+ * @note: 每个顶层窗口一个的显示调度器, 取代每个 CUVVideoWidget 各自的 PreciseTimer.
+ * 按屏幕刷新周期计时, 相位由 QOpenGLWidget::frameSwapped 校正, 每个 vsync 之后触发一次:
+ * 为所有播放中的画面按 pts 选出下一个 vsync 时应显示的帧, 有新帧的画面在同一轮事件循环里一起重绘.
+ * 每个画面统计抖动(显示间隔与 pts 间隔之差的均方根)、丢帧和重复帧, 每秒发布到 CUVVideoWnd.
+ * NOTE: 只在 GUI 线程使用.
+ */
+class CUVPresentScheduler final : public QObject {
+	Q_OBJECT
+
+public:
+	// the scheduler of the widget's current top-level window, created on first use
+	static CUVPresentScheduler* instance(QWidget* wdg);
+
+	void add(CUVVideoWidget* wdg);
+	void remove(CUVVideoWidget* wdg);
+	// a swap just happened, re-phase the vsync estimate
+	void watch(QOpenGLWidget* gl);
+
+	[[nodiscard]] double period() const { return refresh_period; }
+
+private:
+	explicit CUVPresentScheduler(QWidget* window);
+
+	typedef struct client_s {
+		QPointer<CUVVideoWidget> wdg;
+		bool has_last;
+		double last_pts;     // ms
+		double last_display; // ms
+		double frame_ms;     // usual pts step
+		int vsyncs;          // vsyncs the current frame has been on screen
+		// for the current second
+		double judder_sum;   // sum of squared cadence errors
+		int judder_cnt;
+		int drops;
+		int repeats;
+	} Client;
+
+	void onTick();
+	void present(Client& client, double display_time) const;
+	void publish();
+	void arm();
+	void updatePeriod();
+	[[nodiscard]] double lastVsync(double now) const;
+
+	QWidget* window;
+	QTimer* timer;
+	std::vector<Client> clients;
+	std::vector<QPointer<QOpenGLWidget>> watched;
+
+	double refresh_period{ 1000.0 / DEFAULT_REFRESH_RATE }; // ms
+	double vsync_phase{};                                   // time of a known vsync, ms
+	double stats_tick{};
+};
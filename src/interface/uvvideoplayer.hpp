@@ -1,10 +1,12 @@
 ﻿#pragma once
 
+#include <mutex>
 #include <QObject>
 
 #include "conf/uvconf.hpp"
 #include "util/uvframe.hpp"
 #include "global/uvmedia.hpp"
+#include "video/uvclock.hpp"
 
 #define DEFAULT_FPS         25
 #define DEFAULT_FRAME_CACHE 5
@@ -23,6 +25,7 @@ enum uvplayer_event_e {
 	UVPLAYER_EOF,
 	UVPLAYER_CLOSED,
 	UVPLAYER_ERROR,
+	UVPLAYER_PROBE_STALE, // stream differs from the cached probe, reopen
 };
 
 typedef int (*uvplayer_event_cb)(const uvplayer_event_e& event, void* userdata);
@@ -36,6 +39,19 @@ public:
 		set_frame_cache(g_confile->get<int>("frame_cache", "video", DEFAULT_FRAME_CACHE));
 		fps = g_confile->get<int>("fps", "video", DEFAULT_FPS);
 		decode_mode = g_confile->get<int>("decode_mode", "video", DEFAULT_DECODE_MODE);
+		convert_threads = g_confile->get<int>("sws_threads", "video", 0);
+
+		const std::string master = g_confile->getValue("sync_master", "video");
+		if (master == "audio") {
+			avsync.setMaster(UVSYNC_AUDIO_MASTER);
+		} else if (master == "external") {
+			avsync.setMaster(UVSYNC_EXTERNAL_MASTER);
+		} else if (master == "video") {
+			avsync.setMaster(UVSYNC_VIDEO_MASTER);
+		} else {
+			avsync.setMaster(DEFAULT_SYNC_MASTER);
+		}
+		avsync.setFrameDrop(g_confile->get<bool>("framedrop", "video", true));
 
 		width = 0;
 		height = 0;
@@ -57,6 +73,18 @@ public:
 		return 0;
 	}
 
+	// any thread: make blocking I/O and the player threads give up at once, stop() still joins them
+	virtual void interrupt() {
+	}
+
+	// scheduling priority of the decode work, UVTASK_PRIORITY_HIGH for the focused view
+	virtual void set_priority(int priority) {
+	}
+
+	// size and visibility of the view showing this player, for the decoder thread budget
+	virtual void set_view(int w, int h, bool visible) {
+	}
+
 	void set_media(const CUVMedia& media) {
 		this->media = media;
 	}
@@ -65,8 +93,15 @@ public:
 		decode_mode = mode;
 	}
 
-	[[nodiscard]] FrameStats get_frame_stats() const {
-		return frame_buf.frame_stats;
+	// pixel format conversion threads, 0 by resolution; takes effect at the next open
+	void set_convert_threads(const int threads) {
+		convert_threads = threads;
+	}
+
+	[[nodiscard]] virtual FrameStats get_frame_stats() const {
+		FrameStats stats = frame_buf.stats();
+		avsync.fillStats(&stats);
+		return stats;
 	}
 
 	[[nodiscard]] FrameInfo get_frame_info() const {
@@ -81,6 +116,11 @@ public:
 		frame_buf.clear();
 	}
 
+	// get refcounted memory for pFrame from the frame pool, released back to it by the last holder
+	int alloc_frame(CUVFrame* pFrame, const size_t len, const bool wait = true) const {
+		return frame_buf.alloc(pFrame, len, wait);
+	}
+
 	int push_frame(CUVFrame* pFrame) {
 		return frame_buf.push(pFrame);
 	}
@@ -89,12 +129,20 @@ public:
 		return frame_buf.pop(pFrame);
 	}
 
+	// render thread: pop the frame due at display_time (NAN: now) by pts, see CUVAVSync::refresh
+	int refresh_frame(CUVFrame* pFrame, int* remaining_ms, const double display_time = NAN) {
+		return avsync.refresh(&frame_buf, pFrame, remaining_ms, display_time);
+	}
+
+	// NOTE: a callback running on a player thread finishes before set_event_callback returns
 	void set_event_callback(const uvplayer_event_cb& cb, void* userdata) {
+		std::lock_guard<std::mutex> locker(event_mutex);
 		event_cb = cb;
 		event_cb_userdata = userdata;
 	}
 
 	void event_callback(const uvplayer_event_e& event) const {
+		std::lock_guard<std::mutex> locker(event_mutex);
 		if (event_cb) {
 			event_cb(event, event_cb_userdata);
 		}
@@ -103,6 +151,7 @@ public:
 	CUVMedia media{};
 	int fps{};
 	int decode_mode{};
+	int convert_threads{};
 	int real_decode_mode{};
 
 	int32_t width{};
@@ -118,6 +167,8 @@ signals:
 
 protected:
 	CUVFrameBuf frame_buf;
+	CUVAVSync avsync;
 	uvplayer_event_cb event_cb;
 	void* event_cb_userdata{};
+	mutable std::mutex event_mutex;
 };
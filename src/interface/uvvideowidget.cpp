@@ -8,8 +8,12 @@
 #include "uvopenmediadlg.hpp"
 #include "conf/uvconf.hpp"
 #include "framelessMessageBox/uvmessagebox.hpp"
+#include "gl/uvglcompositor.hpp"
 #include "global/uvfunctions.hpp"
+#include "uvpresentscheduler.hpp"
+#include "util/uvlagmonitor.hpp"
 #include "video/uvffplayer.hpp"
+#include "video/uvplayerreaper.hpp"
 
 #define DEFAULT_RETRY_INTERVAL  10000  // ms
 #define DEFAULT_RETRY_MAXCNT    6
@@ -46,6 +50,9 @@ static int uvplayer_event_callback(const uvplayer_event_e& event, void* userdata
 		case UVPLAYER_ERROR:
 			custom_event_type = CUVCustomEvent::PlayerError;
 			break;
+		case UVPLAYER_PROBE_STALE:
+			custom_event_type = CUVCustomEvent::PlayerProbeStale;
+			break;
 		default:
 			custom_event_type = CUVCustomEvent::User;
 			break;
@@ -64,11 +71,10 @@ static renderer_type_e renderer_type_enum(const std::string& str) {
 	return DEFAULT_RENDERER_TYPE;
 }
 
-CUVVideoWidget::CUVVideoWidget(QWidget* parent) : QFrame(parent) {
+CUVVideoWidget::CUVVideoWidget(QWidget* parent, CUVGLCompositor* compositor) : QFrame(parent), compositor(compositor) {
 	playerid = 0;
 	status = STOP;
 	pImpl_player = nullptr;
-	fps = g_confile->get<int>("fps", "video");
 
 	std::string str = g_confile->getValue("aspect_ratio", "video");
 	initAspectRatio(str);
@@ -79,6 +85,7 @@ CUVVideoWidget::CUVVideoWidget(QWidget* parent) : QFrame(parent) {
 	// retry
 	retry_interval = g_confile->get<int>("retry_interval", "video", DEFAULT_RETRY_INTERVAL);
 	retry_maxcnt = g_confile->get<int>("retry_maxcnt", "video", DEFAULT_RETRY_MAXCNT);
+	vsync_present = g_confile->get<bool>("vsync_present", "video", true);
 	last_retry_time = 0;
 	retry_cnt = 0;
 	init();
@@ -109,9 +116,12 @@ void CUVVideoWidget::start() { // NOLINT
 	}
 
 	if (!pImpl_player) {
+		CUVLagScope lag_scope("CUVVideoWidget::start");
 		pImpl_player = new CUVFFPlayer;
 		pImpl_player->set_media(media);
 		pImpl_player->set_event_callback(uvplayer_event_callback, this);
+		pImpl_player->set_priority(hasFocus() ? UVTASK_PRIORITY_HIGH : UVTASK_PRIORITY_NORMAL);
+		updateView();
 		title = media.src.c_str();
 		qRegisterMetaType<aspect_ratio_t>("aspect_ratio_t");
 		connect(pImpl_player, &CUVVideoPlayer::videoAspectRatio, this, &CUVVideoWidget::setAspectRatio);
@@ -129,14 +139,13 @@ void CUVVideoWidget::start() { // NOLINT
 }
 
 void CUVVideoWidget::stop() {
-	timer->stop();
+	stopPresent();
 
-	if (pImpl_player) {
-		pImpl_player->stop();
-		SAFE_DELETE(pImpl_player);
-	}
+	releasePlayer();
+	SAFE_DELETE(thumbnailer);
+	hidePreview();
 
-	videownd->last_frame.buf.cleanup();
+	videownd->last_frame.unref();
 	videownd->Update();
 	status = STOP;
 
@@ -150,7 +159,7 @@ void CUVVideoWidget::pause() {
 	if (pImpl_player) {
 		pImpl_player->pause();
 	}
-	timer->stop();
+	stopPresent();
 	status = PAUSE;
 
 	updateUI();
@@ -159,8 +168,8 @@ void CUVVideoWidget::pause() {
 void CUVVideoWidget::resume() {
 	if (status == PAUSE && pImpl_player) {
 		pImpl_player->resume();
-		timer->start(1000 / (fps ? fps : pImpl_player->fps));
 		status = PLAY;
+		startPresent();
 
 		updateUI();
 	}
@@ -168,11 +177,16 @@ void CUVVideoWidget::resume() {
 
 void CUVVideoWidget::restart() { // NOLINT
 	qDebug() << "restart...";
+	// NOTE: a fresh player, the old one may still be blocked in network I/O
+	releasePlayer();
+	start();
+}
+
+void CUVVideoWidget::releasePlayer() {
+	// NOTE: stop joins the player threads, up to block_timeout on a dead stream; never on the GUI thread
 	if (pImpl_player) {
-		pImpl_player->stop();
-		pImpl_player->start();
-	} else {
-		start();
+		CUVPlayerReaper::instance().reap(pImpl_player);
+		pImpl_player = nullptr;
 	}
 }
 
@@ -185,9 +199,7 @@ void CUVVideoWidget::retry() { // NOLINT
 			restart();
 		} else {
 			last_retry_time += retry_interval;
-			if (pImpl_player) {
-				pImpl_player->stop();
-			}
+			releasePlayer();
 			int retry_after = retry_interval - timespan; // NOLINT
 			QTimer::singleShot(retry_after, this, &CUVVideoWidget::restart);
 		}
@@ -199,7 +211,8 @@ void CUVVideoWidget::retry() { // NOLINT
 void CUVVideoWidget::onTimerUpdate() const {
 	if (!pImpl_player) return;
 
-	if (pImpl_player->pop_frame(&videownd->last_frame) == 0) {
+	int remaining_ms = AV_REFRESH_RATE;
+	if (pImpl_player->refresh_frame(&videownd->last_frame, &remaining_ms) == 0) {
 		// update progress bar
 		if (toolbar->sldProgress->isVisible()) {
 			int progress = (videownd->last_frame.ts - pImpl_player->start_time) / 1000; // NOLINT
@@ -210,11 +223,90 @@ void CUVVideoWidget::onTimerUpdate() const {
 		// update video frame
 		videownd->Update();
 	}
+	// NOTE: single shot, re-armed with the time left until the next frame is due
+	if (status == PLAY) {
+		timer->start(remaining_ms);
+	}
+}
+
+bool CUVVideoWidget::present(const double display_time) const {
+	if (!pImpl_player || status != PLAY) return false;
+
+	int remaining_ms = AV_REFRESH_RATE;
+	if (pImpl_player->refresh_frame(&videownd->last_frame, &remaining_ms, display_time) != 0) {
+		return false;
+	}
+	if (toolbar->sldProgress->isVisible()) {
+		int progress = (videownd->last_frame.ts - pImpl_player->start_time) / 1000; // NOLINT
+		if (toolbar->sldProgress->value() != progress && !toolbar->sldProgress->isSliderDown()) {
+			toolbar->sldProgress->setValue(progress);
+		}
+	}
+	videownd->Update();
+	return true;
+}
+
+void CUVVideoWidget::startPresent() {
+	if (!vsync_present) {
+		timer->start(0);
+		return;
+	}
+	if (CUVPresentScheduler* current = CUVPresentScheduler::instance(this); current != scheduler) {
+		if (scheduler) {
+			scheduler->remove(this);
+		}
+		scheduler = current;
+	}
+	// NOTE: the swaps of the GL surface showing this player give the vsync phase
+	scheduler->watch(compositor ? compositor : videownd->glWidget());
+	scheduler->add(this);
+}
+
+void CUVVideoWidget::stopPresent() {
+	timer->stop();
+	if (scheduler) {
+		scheduler->remove(this);
+	}
+}
+
+void CUVVideoWidget::showPreview(const int value, const QPoint& pos) {
+	if (!thumbnailer) return;
+
+	preview_ms = static_cast<int64_t>(value) * 1000;
+	preview_pos = toolbar->sldProgress->mapTo(this, pos);
+	QImage image;
+	if (!thumbnailer->thumbnail(preview_ms, &image)) {
+		// NOTE: not cached yet, shown by onThumbnailReady if still hovering
+		return;
+	}
+	lblPreview->setPixmap(QPixmap::fromImage(image));
+	lblPreview->adjustSize();
+	const int x = qBound(0, preview_pos.x() - lblPreview->width() / 2, width() - lblPreview->width());
+	const int y = toolbar->y() - lblPreview->height() - 4;
+	lblPreview->move(x, MAX(y, 0));
+	lblPreview->raise();
+	lblPreview->show();
+}
+
+void CUVVideoWidget::hidePreview() {
+	preview_ms = -1;
+	if (lblPreview) {
+		lblPreview->hide();
+	}
+}
+
+void CUVVideoWidget::onThumbnailReady(const qint64 ms) {
+	Q_UNUSED(ms)
+	if (preview_ms >= 0 && toolbar->sldProgress->isVisible()) {
+		// the bucket of the hovered position may just have been filled
+		const QPoint pos = toolbar->sldProgress->mapFrom(this, preview_pos);
+		showPreview(static_cast<int>(preview_ms / 1000), pos);
+	}
 }
 
 void CUVVideoWidget::onOpenSucceed() {
-	timer->start(1000 / (fps ? fps : pImpl_player->fps));
 	status = PLAY;
+	startPresent();
 	setAspectRatio(aspect_ratio);
 	if (pImpl_player->duration > 0) {
 		int duration_sec = pImpl_player->duration / 1000; // NOLINT
@@ -225,6 +317,12 @@ void CUVVideoWidget::onOpenSucceed() {
 		toolbar->lblDuration()->show();
 		toolbar->sldProgress->custom_show();
 		toolbar->lbCurDuration()->show();
+
+		if (media.type == MEDIA_TYPE_FILE && g_confile->get<bool>("thumbnail", "video", true) && !thumbnailer) {
+			thumbnailer = new CUVThumbnailer(this);
+			connect(thumbnailer, &CUVThumbnailer::thumbnailReady, this, &CUVVideoWidget::onThumbnailReady, Qt::QueuedConnection);
+			thumbnailer->start(media.src, pImpl_player->start_time, pImpl_player->duration);
+		}
 	}
 
 	if (retry_cnt != 0) {
@@ -337,10 +435,20 @@ void CUVVideoWidget::setAspectRatio(const aspect_ratio_t& aspect_ratio) {
 void CUVVideoWidget::init() {
 	setFocusPolicy(Qt::ClickFocus);
 
-	videownd = CUVVideoWndFactory::create(renderer_type, this);
+	if (compositor && renderer_type == RENDERER_TYPE_OPENGL) {
+		// NOTE: drawn by the compositor below, the background must let it through (see the qss)
+		videownd = new CUVGLTileWnd(compositor, this);
+		setProperty("composited", true);
+	} else {
+		videownd = CUVVideoWndFactory::create(renderer_type, this);
+	}
 	titlebar = new CUVVideoTitlebar(this);
 	toolbar = new CUVVideoToolbar(this);
 	btnMedia = getPushButton(QPixmap(":/image/media_bk.png"), tr("Open media"), {}, this);
+	lblPreview = new QLabel(this);
+	lblPreview->setAttribute(Qt::WA_TransparentForMouseEvents);
+	lblPreview->setStyleSheet("border: 1px solid #f4843c;");
+	lblPreview->hide();
 
 	const auto vbox = new QVBoxLayout;
 	vbox->setContentsMargins(1, 1, 1, 1);
@@ -372,6 +480,8 @@ void CUVVideoWidget::initConnect() {
 			pImpl_player->seek(toolbar->sldProgress->value() * 1000);
 		}
 	});
+	connect(toolbar->sldProgress, &CUVMaterialSlider::sigHoverValue, this, &CUVVideoWidget::showPreview);
+	connect(toolbar->sldProgress, &CUVMaterialSlider::sigHoverLeave, this, &CUVVideoWidget::hidePreview);
 	connect(toolbar->sldProgress, &CUVMaterialSlider::valueChanged, this, [=](const int value) {
 		// 使用格式化函数设置 lbCurDuration
 		QString formattedTime = formatTime(value);
@@ -380,6 +490,7 @@ void CUVVideoWidget::initConnect() {
 
 	timer = new QTimer(this);
 	timer->setTimerType(Qt::PreciseTimer);
+	timer->setSingleShot(true);
 	connect(timer, &QTimer::timeout, this, &CUVVideoWidget::onTimerUpdate);
 }
 
@@ -454,8 +565,27 @@ void CUVVideoWidget::initAspectRatio(const std::string& str) {
 	}
 }
 
+void CUVVideoWidget::updateView() const {
+	// NOTE: the decoder thread budget favours large visible tiles
+	if (pImpl_player) {
+		const qreal ratio = devicePixelRatioF();
+		pImpl_player->set_view(static_cast<int>(width() * ratio), static_cast<int>(height() * ratio), isVisible());
+	}
+}
+
 void CUVVideoWidget::resizeEvent(QResizeEvent* event) {
 	setAspectRatio(aspect_ratio);
+	updateView();
+}
+
+void CUVVideoWidget::showEvent(QShowEvent* event) {
+	updateView();
+	QFrame::showEvent(event);
+}
+
+void CUVVideoWidget::hideEvent(QHideEvent* event) {
+	updateView();
+	QFrame::hideEvent(event);
 }
 
 void CUVVideoWidget::enterEvent(QEvent* event) {
@@ -470,6 +600,21 @@ void CUVVideoWidget::leaveEvent(QEvent* event) {
 	toolbar->hide();
 }
 
+void CUVVideoWidget::focusInEvent(QFocusEvent* event) {
+	// NOTE: the focused view decodes ahead of the background views on the shared executor
+	if (pImpl_player) {
+		pImpl_player->set_priority(UVTASK_PRIORITY_HIGH);
+	}
+	QFrame::focusInEvent(event);
+}
+
+void CUVVideoWidget::focusOutEvent(QFocusEvent* event) {
+	if (pImpl_player) {
+		pImpl_player->set_priority(UVTASK_PRIORITY_NORMAL);
+	}
+	QFrame::focusOutEvent(event);
+}
+
 void CUVVideoWidget::mousePressEvent(QMouseEvent* event) {
 	ptMousePress = event->pos();
 	event->ignore();
@@ -497,6 +642,10 @@ void CUVVideoWidget::customEvent(QEvent* event) {
 		case CUVCustomEvent::PlayerError:
 			onPlayerError();
 			break;
+		case CUVCustomEvent::PlayerProbeStale:
+			// the cached entry is gone, the next open probes the stream in full
+			restart();
+			break;
 		default:
 			break;
 	}
@@ -1,11 +1,17 @@
 ﻿#pragma once
 
+#include <QPointer>
+
 #include "uvvideoplayer.hpp"
 #include "uvvideotitlebar.hpp"
 #include "uvvideotoolbar.hpp"
 #include "uvvideowndfactory.hpp"
 #include "def/avdef.hpp"
 #include "global/uvmedia.hpp"
+#include "video/uvthumbnailer.hpp"
+
+class CUVGLCompositor;
+class CUVPresentScheduler;
 
 class CUVVideoWidget final : public QFrame {
 	Q_OBJECT
@@ -17,7 +23,8 @@ public:
 		PLAY,
 	};
 
-	explicit CUVVideoWidget(QWidget* parent = nullptr);
+	// compositor: draw through the multiview's shared GL surface instead of an own window
+	explicit CUVVideoWidget(QWidget* parent = nullptr, CUVGLCompositor* compositor = nullptr);
 	~CUVVideoWidget() override;
 
 public slots:
@@ -32,6 +39,11 @@ public slots:
 	void retry();
 
 	void onTimerUpdate() const;
+	// vsync tick of the present scheduler, true if a new frame was picked for display_time
+	bool present(double display_time) const;
+	// frames are picked by the window's present scheduler, or by the own timer without vsync_present
+	void startPresent();
+	void stopPresent();
 	void onOpenSucceed();
 	void onOpenFailed();
 	void onPlayerEOF();
@@ -39,15 +51,26 @@ public slots:
 
 	void setAspectRatio(const aspect_ratio_t& aspect_ratio);
 
+	void showPreview(int value, const QPoint& pos);
+	void hidePreview();
+	void onThumbnailReady(qint64 ms);
+
 protected:
 	void init();
 	void initConnect();
 	void updateUI() const;
 	void initAspectRatio(const std::string& str);
+	void updateView() const;
+	// detach the player and tear it down on the reaper thread
+	void releasePlayer();
 
 	void resizeEvent(QResizeEvent* event) override;
+	void showEvent(QShowEvent* event) override;
+	void hideEvent(QHideEvent* event) override;
 	void enterEvent(QEvent* event) override;
 	void leaveEvent(QEvent* event) override;
+	void focusInEvent(QFocusEvent* event) override;
+	void focusOutEvent(QFocusEvent* event) override;
 	void mousePressEvent(QMouseEvent* event) override;
 	void mouseReleaseEvent(QMouseEvent* event) override;
 	void mouseMoveEvent(QMouseEvent* event) override;
@@ -58,7 +81,6 @@ public:
 	int playerid{};
 	int status{};
 	QString title{};
-	int fps{};
 	aspect_ratio_t aspect_ratio{};
 	renderer_type_e renderer_type{};
 
@@ -66,13 +88,21 @@ public:
 	CUVVideoTitlebar* titlebar{ nullptr };
 	CUVVideoToolbar* toolbar{ nullptr };
 	QPushButton* btnMedia{ nullptr };
+	QLabel* lblPreview{ nullptr };
 
 private:
 	QPoint ptMousePress{};
 	QTimer* timer{ nullptr };
+	CUVGLCompositor* compositor{ nullptr };
+	bool vsync_present{};
+	QPointer<CUVPresentScheduler> scheduler{};
 
 	CUVMedia media{};
 	CUVVideoPlayer* pImpl_player{ nullptr };
+	// progress slider hover preview, file sources only
+	CUVThumbnailer* thumbnailer{ nullptr };
+	int64_t preview_ms{ -1 };
+	QPoint preview_pos{};
 	// for retry when SIGNAL_END_OF_FILE
 	int retry_interval{};
 	int retry_maxcnt{};
@@ -2,6 +2,9 @@
 
 #include "conf/uvconf.hpp"
 
+#include <algorithm>
+#include <cstdio>
+
 #ifdef Q_OS_WIN
 #include <windows.h> // NOLINT
 #include <sysinfoapi.h>
@@ -20,8 +23,39 @@ void CUVVideoWnd::calcFPS() {
 	if (GetTickCount() - tick > 1000) {
 		fps = framecnt;
 		framecnt = 0;
+		upload_ms = upload_cnt > 0 ? upload_sum / upload_cnt : 0;
+		upload_max_ms = upload_peak;
+		upload_sum = upload_peak = 0;
+		upload_cnt = 0;
 		tick = GetTickCount();
 	} else {
 		++framecnt;
 	}
 }
+
+void CUVVideoWnd::addUploadTime(const double ms) {
+	upload_sum += ms;
+	upload_peak = std::max(upload_peak, ms);
+	++upload_cnt;
+}
+
+const char* CUVVideoWnd::osdTime(char* buf, const size_t len) const {
+	const int sec = static_cast<int>(last_frame.ts / 1000);
+	snprintf(buf, len, "%02d:%02d:%02d", sec / 3600, sec / 60 % 60, sec % 60);
+	return buf;
+}
+
+const char* CUVVideoWnd::osdFPS(char* buf, const size_t len) const {
+	snprintf(buf, len, "FPS:%d UP:%.1f/%.1fms", fps, upload_ms, upload_max_ms);
+	return buf;
+}
+
+const char* CUVVideoWnd::osdResolution(char* buf, const size_t len) const {
+	snprintf(buf, len, "%d X %d", last_frame.w, last_frame.h);
+	return buf;
+}
+
+const char* CUVVideoWnd::osdPresent(char* buf, const size_t len) const {
+	snprintf(buf, len, "J:%.1fms D:%d R:%d", judder_ms, present_drops, present_repeats);
+	return buf;
+}
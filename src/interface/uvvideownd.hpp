@@ -4,6 +4,8 @@
 
 #include "util/uvframe.hpp"
 
+class QOpenGLWidget;
+
 class CUVVideoWnd {
 public:
 	explicit CUVVideoWnd(QWidget* parent = nullptr);
@@ -11,13 +13,29 @@ public:
 
 	virtual void setgeometry(const QRect& rc) = 0;
 	virtual void Update() = 0;
+	// the GL surface that presents this window, nullptr when it is not drawn by its own QOpenGLWidget
+	virtual QOpenGLWidget* glWidget() { return nullptr; }
+
+	// OSD text of the last frame formatted into buf, no allocation, returns buf
+	const char* osdTime(char* buf, size_t len) const;
+	const char* osdFPS(char* buf, size_t len) const;
+	const char* osdResolution(char* buf, size_t len) const;
+	const char* osdPresent(char* buf, size_t len) const;
 
 protected:
 	void calcFPS();
+	// per frame texture upload time, published with fps
+	void addUploadTime(double ms);
 
 public:
 	CUVFrame last_frame{};
 	int fps{};
+	double upload_ms{};     // average over the last second
+	double upload_max_ms{};
+	// vsync presentation over the last second, see CUVPresentScheduler
+	double judder_ms{};
+	int present_drops{};
+	int present_repeats{};
 	bool draw_time{};
 	bool draw_fps{};
 	bool draw_resolution{};
@@ -26,4 +44,7 @@ protected:
 	// for calFPS
 	uint64_t tick;
 	int framecnt;
+	double upload_sum{};
+	double upload_peak{};
+	int upload_cnt{};
 };
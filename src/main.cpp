@@ -11,6 +11,11 @@
 #include "global/uvsingletonwindow.h"
 #include "interface/uvmainwindow.hpp"
 #include "logger/filelogger.hpp"
+#include "util/uvexecutor.hpp"
+#include "util/uvlagmonitor.hpp"
+#include "video/uvdecoderbudget.hpp"
+#include "video/uvplayerreaper.hpp"
+#include "util/uvmemorybudget.hpp"
 #include "uvstring/uvstring.hpp"
 
 CUVIniParser* g_confile = nullptr;   // Configuration parser
@@ -42,6 +47,8 @@ int main(int argc, char* argv[]) {
 	}
 
 	qInfo("-------------------app start----------------------------------");
+	// log GUI thread stalls with the event or section that caused them
+	CUVLagMonitor::instance().start(g_confile->get<int>("lag_monitor_ms", "ui", DEFAULT_LAG_THRESHOLD_MS));
 	const QFileInfo appFile = getExecutablePath();
 	const QDir dir(appFile.absolutePath());
 	const QString appParpath = dir.absolutePath();
@@ -60,6 +67,9 @@ int main(int argc, char* argv[]) {
 	QObject::connect(&window, &CUVMainWindow::destroyed, [&]() {
 		unloadResources(rcc_path);
 		unloadTranslate();
+		// the video widgets are gone, wait for their players to finish tearing down
+		CUVPlayerReaper::instance().shutdown();
+		CUVLagMonitor::instance().stop();
 		g_confile->set<int>("main_window_state", static_cast<int>(window.window_state), "ui");
 		const auto rect = uvstring::asprintf("rect(%d,%d,%d,%d)", window.x(), window.y(), window.width(), window.height());
 		g_confile->setValue("main_window_rect", rect, "ui");
@@ -136,6 +146,15 @@ int load_config(QApplication& app) {
 		return -1;
 	}
 
+	// memory budget of all players' frame/packet/decoder buffers
+	CUVMemoryBudget::instance().setLimits(static_cast<size_t>(g_confile->get<int>("total_mb", "memory", DEFAULT_MEMORY_BUDGET_TOTAL)) << 20,
+	                                      static_cast<size_t>(g_confile->get<int>("player_mb", "memory", DEFAULT_MEMORY_BUDGET_PLAYER)) << 20);
+
+	// shared decode executor of all players
+	CUVExecutor::setDefaultThreads(g_confile->get<int>("executor_threads", "video", 0));
+	// libavcodec threads shared by all software decoders
+	CUVDecoderBudget::instance().setTotal(g_confile->get<int>("decoder_threads", "video", 0));
+
 	// fontSize & fontFamily
 	const auto fontfamily = g_confile->getValue("fontfamily", "ui");
 	const auto fontsize = g_confile->get<int>("fontsize", "ui", DEFAULT_FONT_SIZE);
@@ -113,13 +113,55 @@ void CUVSDL2Wnd::paintEvent(QPaintEvent* event) {
 			m_tex_pitch = pitch;
 			qDebug("SDL_Texture: w = %d, h = %d, bpp = %d, pitch = %d, pix_fmt = %d", m_tex_w, m_tex_h, m_tex_bpp, m_tex_pitch, m_tex_pix_fmt);
 		}
-		SDL_UpdateTexture(m_sdl_texture, nullptr, last_frame.buf.base, m_tex_pitch);
+		if (last_frame.isStrided()) {
+			updateStrided();
+		} else {
+			SDL_UpdateTexture(m_sdl_texture, nullptr, last_frame.buf.base, m_tex_pitch);
+		}
 		SDL_RenderCopy(m_sdl_renderer, m_sdl_texture, nullptr, nullptr);
 	}
 
 	SDL_RenderPresent(m_sdl_renderer);
 }
 
+void CUVSDL2Wnd::updateStrided() const {
+	uint8_t* planes[4]{};
+	int strides[4]{};
+	last_frame.planes(planes, strides);
+
+	switch (last_frame.type) {
+		case PIX_FMT_IYUV:
+		case PIX_FMT_YV12:
+			// planes() always returns U before V
+			SDL_UpdateYUVTexture(m_sdl_texture, nullptr, planes[0], strides[0], planes[1], strides[1], planes[2], strides[2]);
+			break;
+		case PIX_FMT_NV12:
+		case PIX_FMT_NV21: {
+			// NOTE: SDL 2.0.12 has no SDL_UpdateNVTexture, copy the rows into the locked texture
+			void* pixels{};
+			int pitch{};
+			if (SDL_LockTexture(m_sdl_texture, nullptr, &pixels, &pitch) < 0) {
+				return;
+			}
+			auto dst = static_cast<uint8_t*>(pixels);
+			const int uv_h = (last_frame.h + 1) >> 1;
+			const int uv_w = ((last_frame.w + 1) >> 1) * 2;
+			for (int i = 0; i < last_frame.h; ++i) {
+				memcpy(dst + i * pitch, planes[0] + i * strides[0], last_frame.w);
+			}
+			dst += pitch * last_frame.h;
+			for (int i = 0; i < uv_h; ++i) {
+				memcpy(dst + i * pitch, planes[1] + i * strides[1], uv_w);
+			}
+			SDL_UnlockTexture(m_sdl_texture);
+			break;
+		}
+		default:
+			SDL_UpdateTexture(m_sdl_texture, nullptr, planes[0], strides[0]);
+			break;
+	}
+}
+
 void CUVSDL2Wnd::resizeEvent(QResizeEvent* event) {
 	QWidget::resizeEvent(event);
 }
@@ -14,6 +14,8 @@ public:
 protected:
 	void paintEvent(QPaintEvent* event) override;
 	void resizeEvent(QResizeEvent* event) override;
+	// upload a frame that references the decoder planes (linesize != width)
+	void updateStrided() const;
 
 	static std::atomic_flag s_sdl_init;
 	SDL_Window* m_sdl_window{ nullptr };
@@ -0,0 +1,126 @@
+#include "uvsdlaudio.hpp"
+
+#include <QDebug>
+
+/**
+ * class CUVSDLAudio
+ */
+std::atomic_flag CUVSDLAudio::s_sdl_audio_init = ATOMIC_FLAG_INIT;
+
+CUVSDLAudio::CUVSDLAudio() {
+	if (!s_sdl_audio_init.test_and_set()) {
+		SDL_InitSubSystem(SDL_INIT_AUDIO);
+	}
+}
+
+CUVSDLAudio::~CUVSDLAudio() {
+	close();
+}
+
+int CUVSDLAudio::open(const int wanted_sample_rate, const int wanted_channels, CUVClock* clock) {
+	if (wanted_sample_rate <= 0 || wanted_channels <= 0) {
+		return -10;
+	}
+
+	SDL_AudioSpec wanted_spec{};
+	SDL_AudioSpec spec{};
+	wanted_spec.freq = wanted_sample_rate;
+	wanted_spec.format = AUDIO_S16SYS;
+	wanted_spec.channels = static_cast<Uint8>(MIN(wanted_channels, 2));
+	wanted_spec.silence = 0;
+	// buffer size: power of 2, about 1/30 s
+	int samples = SDL_AUDIO_MIN_BUFFER_SIZE;
+	while (samples < wanted_sample_rate / SDL_AUDIO_MAX_CALLBACKS_PER_SEC) samples <<= 1;
+	wanted_spec.samples = static_cast<Uint16>(samples);
+	wanted_spec.callback = audioCallback;
+	wanted_spec.userdata = this;
+
+	dev = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+	if (dev == 0) {
+		qWarning("SDL_OpenAudioDevice failed: %s", SDL_GetError());
+		return -20;
+	}
+	if (spec.format != AUDIO_S16SYS || spec.channels == 0) {
+		qWarning("SDL audio format not supported: format = %d, channels = %d", spec.format, spec.channels);
+		close();
+		return -30;
+	}
+
+	sample_rate = spec.freq;
+	channels = spec.channels;
+	frame_size = channels * 2;
+	bytes_per_sec = sample_rate * frame_size;
+	hw_buf_size = static_cast<int>(spec.size);
+	silence = spec.silence;
+	this->clock = clock;
+	end_pts = NAN;
+	end_serial = -1;
+
+	// NOTE: allocated once here, nothing on the audio path allocates after open
+	ring.init(static_cast<size_t>(bytes_per_sec) * DEFAULT_AUDIO_RING_SECONDS);
+
+	qDebug("SDL audio: freq = %d, channels = %d, samples = %d, size = %d", spec.freq, spec.channels, spec.samples, spec.size);
+	return 0;
+}
+
+void CUVSDLAudio::close() {
+	if (dev) {
+		SDL_CloseAudioDevice(dev);
+		dev = 0;
+	}
+	clock = nullptr;
+	cond_writable.notify_all();
+}
+
+void CUVSDLAudio::pause(const bool pause) const {
+	if (dev) {
+		SDL_PauseAudioDevice(dev, pause ? 1 : 0);
+	}
+}
+
+size_t CUVSDLAudio::write(const void* data, const size_t len, const double end_pts, const int serial) {
+	const size_t n = ring.write(data, len);
+	// pts of the last byte actually queued
+	this->end_pts = end_pts - static_cast<double>(len - n) * 1000 / bytes_per_sec;
+	end_serial = serial;
+	return n;
+}
+
+bool CUVSDLAudio::waitWritable(const size_t len, const int timeout_ms) {
+	if (ring.writable() >= len) {
+		return true;
+	}
+	// NOTE: the callback notifies without the lock, the timeout bounds a lost wakeup
+	std::unique_lock<std::mutex> locker(wait_mutex);
+	cond_writable.wait_for(locker, std::chrono::milliseconds(timeout_ms));
+	return ring.writable() >= len;
+}
+
+void CUVSDLAudio::flush() {
+	if (!dev) return;
+	// NOTE: stop the callback while resetting, the consumer side of the ring must not run concurrently
+	SDL_LockAudioDevice(dev);
+	ring.discard();
+	end_pts = NAN;
+	end_serial = -1;
+	SDL_UnlockAudioDevice(dev);
+}
+
+void SDLCALL CUVSDLAudio::audioCallback(void* userdata, Uint8* stream, const int len) {
+	const auto self = static_cast<CUVSDLAudio*>(userdata);
+	const double time = CUVClock::now();
+
+	const size_t n = self->ring.read(stream, len);
+	if (n < static_cast<size_t>(len)) {
+		// underrun, output silence
+		memset(stream + n, self->silence, len - n);
+	}
+
+	const double pts = self->end_pts;
+	if (self->clock && !std::isnan(pts)) {
+		// samples not played yet: the ring and about two hardware buffers
+		const double latency = static_cast<double>(self->ring.readable() + 2 * self->hw_buf_size) * 1000 / self->bytes_per_sec;
+		self->clock->setAt(pts - latency, self->end_serial, time);
+	}
+	self->cond_writable.notify_one();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "util/uvbuf.hpp"
+#include "util/uvsdl_util.hpp"
+#include "video/uvclock.hpp"
+
+// ring capacity in seconds of output
+#define DEFAULT_AUDIO_RING_SECONDS  1
+#define SDL_AUDIO_MIN_BUFFER_SIZE   512
+#define SDL_AUDIO_MAX_CALLBACKS_PER_SEC 30
+
+/**
+ * @note: SDL 音频输出, 输出格式固定为 S16 交错.
+ * 音频解码线程 write 到无锁环形缓冲区, SDL 回调线程读取, 不加锁也不分配内存.
+ * 回调中按 已写入数据的结束 pts - 未播放的字节数 更新音频时钟, 用作主时钟.
+ */
+class CUVSDLAudio {
+public:
+	CUVSDLAudio();
+	~CUVSDLAudio();
+
+	// wanted sample_rate/channels, the obtained ones are in sample_rate/channels after return
+	int open(int wanted_sample_rate, int wanted_channels, CUVClock* clock);
+	void close();
+	void pause(bool pause) const;
+	[[nodiscard]] bool isOpened() const { return dev != 0; }
+
+	// producer: append interleaved S16 samples whose last sample ends at end_pts(ms)
+	size_t write(const void* data, size_t len, double end_pts, int serial);
+	// producer: wait until at least len bytes can be written, false on timeout
+	bool waitWritable(size_t len, int timeout_ms);
+	// drop all queued samples, used on seek
+	void flush();
+
+	int sample_rate{};
+	int channels{};
+	int bytes_per_sec{};
+	int frame_size{}; // bytes per sample of all channels
+
+private:
+	static void SDLCALL audioCallback(void* userdata, Uint8* stream, int len);
+
+	static std::atomic_flag s_sdl_audio_init;
+	SDL_AudioDeviceID dev{};
+	int hw_buf_size{};
+	uint8_t silence{};
+	CUVSpscRingBuf ring;
+	CUVClock* clock{ nullptr };
+	std::atomic<double> end_pts{ NAN };
+	std::atomic<int> end_serial{ -1 };
+
+	std::mutex wait_mutex;
+	std::condition_variable cond_writable;
+};
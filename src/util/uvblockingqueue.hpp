@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+enum uvqueue_result_e {
+	UVQUEUE_OK      = 0,
+	UVQUEUE_CLOSED  = -1, // aborted, or closed (and drained for pop)
+	UVQUEUE_TIMEOUT = -2,
+};
+
+/**
+ * @note: 有界阻塞队列, 同时受元素个数和总字节数限制, 字节数由 size_of 计算(max_bytes 为 0 不限).
+ * push 在队列满时阻塞, pop 在队列空时阻塞, timeout_ms < 0 一直等待, 0 不等待.
+ * close 之后不再接受 push, pop 取完剩余元素后返回 UVQUEUE_CLOSED; abort 唤醒所有等待者并立即失败;
+ * reopen 恢复使用. 空队列总是接受一个元素, 单个超过字节上限的元素不会永远阻塞.
+ * NOTE: push 失败时元素仍归调用者所有(T 通常是 AVPacket* 或 AVFrame*), 需要调用者释放.
+ */
+template<typename T>
+class CUVBlockingQueue {
+public:
+	typedef std::function<size_t(const T&)> SizeFunc;
+
+	explicit CUVBlockingQueue(const size_t max_num, const size_t max_bytes = 0, SizeFunc size_of = nullptr)
+	: max_num(max_num > 0 ? max_num : 1), max_bytes(max_bytes), size_of(std::move(size_of)) {
+	}
+
+	CUVBlockingQueue(const CUVBlockingQueue&) = delete;
+	CUVBlockingQueue& operator=(const CUVBlockingQueue&) = delete;
+
+	void setLimits(const size_t max_num, const size_t max_bytes) {
+		std::lock_guard<std::mutex> locker(mutex);
+		this->max_num = max_num > 0 ? max_num : 1;
+		this->max_bytes = max_bytes;
+		cond_push.notify_all();
+	}
+
+	int push(T item, const int timeout_ms = -1) {
+		const size_t bytes = size_of ? size_of(item) : 0;
+		std::unique_lock<std::mutex> locker(mutex);
+		if (!wait(locker, cond_push, timeout_ms, [&] { return aborted || closed || hasRoom(bytes); })) {
+			return UVQUEUE_TIMEOUT;
+		}
+		if (aborted || closed) {
+			return UVQUEUE_CLOSED;
+		}
+		items.emplace_back(std::move(item), bytes);
+		total_bytes += bytes;
+		cond_pop.notify_one();
+		return UVQUEUE_OK;
+	}
+
+	int pop(T* item, const int timeout_ms = -1) {
+		std::unique_lock<std::mutex> locker(mutex);
+		if (!wait(locker, cond_pop, timeout_ms, [this] { return aborted || closed || !items.empty(); })) {
+			return UVQUEUE_TIMEOUT;
+		}
+		if (aborted || items.empty()) {
+			return UVQUEUE_CLOSED;
+		}
+		takeFront(item);
+		return UVQUEUE_OK;
+	}
+
+	// pop the front without waiting only if pred(front) holds
+	template<typename Pred>
+	bool popIf(T* item, Pred pred) {
+		std::lock_guard<std::mutex> locker(mutex);
+		if (aborted || items.empty() || !pred(static_cast<const T&>(items.front().first))) {
+			return false;
+		}
+		takeFront(item);
+		return true;
+	}
+
+	// remove all items, dispose is called outside the lock
+	template<typename Dispose>
+	void clear(Dispose dispose) {
+		std::deque<std::pair<T, size_t>> removed;
+		{
+			std::lock_guard<std::mutex> locker(mutex);
+			removed.swap(items);
+			total_bytes = 0;
+			cond_push.notify_all();
+		}
+		for (auto& node: removed) {
+			dispose(node.first);
+		}
+	}
+
+	// producer is done, consumers drain what is left
+	void close() {
+		std::lock_guard<std::mutex> locker(mutex);
+		closed = true;
+		cond_push.notify_all();
+		cond_pop.notify_all();
+	}
+
+	// shutdown, wake everyone, push and pop fail at once
+	void abort() {
+		std::lock_guard<std::mutex> locker(mutex);
+		aborted = true;
+		cond_push.notify_all();
+		cond_pop.notify_all();
+	}
+
+	void reopen() {
+		std::lock_guard<std::mutex> locker(mutex);
+		aborted = closed = false;
+	}
+
+	[[nodiscard]] size_t size() const {
+		std::lock_guard<std::mutex> locker(mutex);
+		return items.size();
+	}
+
+	[[nodiscard]] size_t bytes() const {
+		std::lock_guard<std::mutex> locker(mutex);
+		return total_bytes;
+	}
+
+	[[nodiscard]] bool empty() const {
+		std::lock_guard<std::mutex> locker(mutex);
+		return items.empty();
+	}
+
+private:
+	template<typename Pred>
+	static bool wait(std::unique_lock<std::mutex>& locker, std::condition_variable& cond, const int timeout_ms, Pred pred) {
+		if (timeout_ms < 0) {
+			cond.wait(locker, pred);
+			return true;
+		}
+		return cond.wait_for(locker, std::chrono::milliseconds(timeout_ms), pred);
+	}
+
+	[[nodiscard]] bool hasRoom(const size_t bytes) const {
+		return items.empty() || (items.size() < max_num && (max_bytes == 0 || total_bytes + bytes <= max_bytes));
+	}
+
+	void takeFront(T* item) {
+		auto& node = items.front();
+		*item = std::move(node.first);
+		total_bytes -= node.second;
+		items.pop_front();
+		cond_push.notify_one();
+	}
+
+	std::deque<std::pair<T, size_t>> items; // item, bytes counted at push
+	size_t max_num;
+	size_t max_bytes;
+	size_t total_bytes{};
+	SizeFunc size_of;
+	bool closed{};
+	bool aborted{};
+
+	mutable std::mutex mutex;
+	std::condition_variable cond_push;
+	std::condition_variable cond_pop;
+};
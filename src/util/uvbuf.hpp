@@ -7,7 +7,15 @@
 #include "def/uvdef.hpp"
 #ifdef Q_OS_WIN
 #include <Windows.h>
+#else
+#include <cstdlib>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
 #endif
+#endif
+
+// transparent huge page size on x86-64 linux
+#define UV_HUGE_PAGE_SIZE   (2 * 1024 * 1024)
 
 typedef struct uvbuf_s {
 	char* base{};
@@ -45,12 +53,7 @@ typedef struct offset_buf_s {
 #endif
 } offset_buf_t;
 
-static volatile long s_alloc_cnt = ATOMIC_VAR_INIT(0);
-static volatile long s_free_cnt = ATOMIC_VAR_INIT(0);
-
 inline void* safe_realloc(void* oldptr, const size_t newSize, const size_t oldSize) {
-	_InterlockedIncrement(&s_alloc_cnt);
-	_InterlockedIncrement(&s_free_cnt);
 	void* ptr = realloc(oldptr, newSize);
 	if (!ptr) {
 		std::cerr << "realloc failed" << std::endl;
@@ -63,7 +66,6 @@ inline void* safe_realloc(void* oldptr, const size_t newSize, const size_t oldSi
 }
 
 inline void* safe_zalloc(const size_t size) {
-	_InterlockedIncrement(&s_alloc_cnt);
 	void* ptr = malloc(size);
 	if (!ptr) {
 		std::cerr << "malloc failed" << std::endl;
@@ -76,7 +78,55 @@ inline void* safe_zalloc(const size_t size) {
 inline void safe_free(void* ptr) {
 	if (ptr) {
 		free(ptr);
-		_InterlockedIncrement(&s_free_cnt);
+	}
+}
+
+// NOTE: not zeroed, for memory that is fully overwritten (decoder planes, sws output), free with safe_aligned_free;
+// huge_pages asks for transparent huge pages on blocks of at least UV_HUGE_PAGE_SIZE (linux only);
+// nullptr on failure, for callers that can report it (decoder get_buffer2)
+inline void* try_aligned_alloc(size_t size, size_t align, const bool huge_pages = false) {
+	void* ptr = nullptr;
+#ifdef Q_OS_WIN
+	Q_UNUSED(huge_pages)
+	ptr = _aligned_malloc(size, align);
+#else
+#ifdef Q_OS_LINUX
+	const bool use_thp = huge_pages && size >= UV_HUGE_PAGE_SIZE;
+	if (use_thp) {
+		align = UV_HUGE_PAGE_SIZE;
+		size = (size + UV_HUGE_PAGE_SIZE - 1) / UV_HUGE_PAGE_SIZE * UV_HUGE_PAGE_SIZE;
+	}
+#else
+	Q_UNUSED(huge_pages)
+#endif
+	if (posix_memalign(&ptr, align, size) != 0) {
+		ptr = nullptr;
+	}
+#ifdef Q_OS_LINUX
+	if (ptr && use_thp) {
+		madvise(ptr, size, MADV_HUGEPAGE);
+	}
+#endif
+#endif
+	return ptr;
+}
+
+inline void* safe_aligned_alloc(const size_t size, const size_t align, const bool huge_pages = false) {
+	void* ptr = try_aligned_alloc(size, align, huge_pages);
+	if (!ptr) {
+		std::cerr << "aligned alloc failed" << std::endl;
+		exit(-1);
+	}
+	return ptr;
+}
+
+inline void safe_aligned_free(void* ptr) {
+	if (ptr) {
+#ifdef Q_OS_WIN
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
 	}
 }
 
@@ -140,6 +190,22 @@ private:
 	bool _cleanup{ false };
 };
 
+// fixed size, aligned and not zeroed, padding bytes after len are readable for SIMD
+class CUVAlignedBuf : public CUVBuf {
+public:
+	explicit CUVAlignedBuf(const size_t size, const size_t align, const size_t padding = 0)
+	: CUVBuf(safe_aligned_alloc(size + padding, align), size) {
+	}
+
+	~CUVAlignedBuf() override {
+		safe_aligned_free(base);
+		base = nullptr;
+	}
+
+	CUVAlignedBuf(const CUVAlignedBuf&) = delete;
+	CUVAlignedBuf& operator=(const CUVAlignedBuf&) = delete;
+};
+
 // VL: Variable Length
 class CUVVLBuf : public CUVBuf {
 public:
@@ -289,4 +355,75 @@ private:
 	size_t _tail{};
 	size_t _size{};
 };
+
+/**
+ * @note: 单生产者单消费者无锁环形缓冲区, 容量在 init 时一次分配(向上取 2 的幂), 之后 write/read 不再分配内存.
+ * 只有生产者调用 write, 只有消费者调用 read/discard, 读写位置单调递增, 取模得到下标.
+ */
+class CUVSpscRingBuf : public CUVBuf {
+public:
+	CUVSpscRingBuf() = default;
+
+	~CUVSpscRingBuf() override = default;
+
+	void init(const size_t cap) {
+		size_t n = 1;
+		while (n < cap) n <<= 1;
+		resize(n);
+		_mask = n - 1;
+		_read_pos = _write_pos = 0;
+	}
+
+	[[nodiscard]] size_t capacity() const { return _mask + 1; }
+
+	// consumer side
+	[[nodiscard]] size_t readable() const {
+		return _write_pos.load(std::memory_order_acquire) - _read_pos.load(std::memory_order_relaxed);
+	}
+
+	// producer side
+	[[nodiscard]] size_t writable() const {
+		return capacity() - (_write_pos.load(std::memory_order_relaxed) - _read_pos.load(std::memory_order_acquire));
+	}
+
+	[[nodiscard]] size_t size() const override {
+		return _write_pos.load(std::memory_order_acquire) - _read_pos.load(std::memory_order_acquire);
+	}
+
+	// return bytes written, less than len if full
+	size_t write(const void* ptr, size_t len) {
+		if (!base) return 0;
+		const size_t wpos = _write_pos.load(std::memory_order_relaxed);
+		len = MIN(len, writable());
+		const size_t off = wpos & _mask;
+		const size_t first = MIN(len, capacity() - off);
+		memcpy(base + off, ptr, first);
+		memcpy(base, static_cast<const char*>(ptr) + first, len - first);
+		_write_pos.store(wpos + len, std::memory_order_release);
+		return len;
+	}
+
+	// return bytes read, less than len if empty
+	size_t read(void* ptr, size_t len) {
+		if (!base) return 0;
+		const size_t rpos = _read_pos.load(std::memory_order_relaxed);
+		len = MIN(len, readable());
+		const size_t off = rpos & _mask;
+		const size_t first = MIN(len, capacity() - off);
+		memcpy(ptr, base + off, first);
+		memcpy(static_cast<char*>(ptr) + first, base, len - first);
+		_read_pos.store(rpos + len, std::memory_order_release);
+		return len;
+	}
+
+	// consumer side, drop everything written so far
+	void discard() {
+		_read_pos.store(_write_pos.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+private:
+	size_t _mask{};
+	std::atomic<size_t> _read_pos{ 0 };
+	std::atomic<size_t> _write_pos{ 0 };
+};
 #endif
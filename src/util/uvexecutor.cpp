@@ -0,0 +1,184 @@
+﻿#include "uvexecutor.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+static std::atomic<unsigned> s_default_threads{ 0 };
+// index of the executor worker running on this thread, -1 elsewhere
+static thread_local int t_worker_index = -1;
+
+/**
+ * class CUVExecutorTask
+ */
+CUVExecutorTask::CUVExecutorTask(StepFunc step, const int priority)
+: step(std::move(step)), task_priority(std::clamp(priority, 0, UVTASK_PRIORITY_NUM - 1)) {
+}
+
+void CUVExecutorTask::wake() {
+	int expected = state;
+	for (;;) {
+		if (closing || expected == QUEUED || expected == RUNNING_WOKEN || expected == CLOSED) {
+			return;
+		}
+		const int desired = expected == IDLE ? QUEUED : RUNNING_WOKEN;
+		if (state.compare_exchange_weak(expected, desired)) {
+			if (desired == QUEUED) {
+				if (auto task = self.lock()) {
+					CUVExecutor::instance().submit(std::move(task));
+				}
+			}
+			return;
+		}
+	}
+}
+
+void CUVExecutorTask::setPriority(const int priority) {
+	// NOTE: takes effect the next time the task is queued
+	task_priority = std::clamp(priority, 0, UVTASK_PRIORITY_NUM - 1);
+}
+
+void CUVExecutorTask::close() {
+	closing = true;
+	int expected = IDLE;
+	if (state.compare_exchange_strong(expected, CLOSED)) {
+		return;
+	}
+	// NOTE: queued or running, the worker marks it closed; the timeout only guards a lost notify
+	std::unique_lock<std::mutex> locker(close_mutex);
+	while (state != CLOSED) {
+		close_cond.wait_for(locker, std::chrono::milliseconds(10));
+	}
+}
+
+bool CUVExecutorTask::run() {
+	if (closing) {
+		setClosed();
+		return true;
+	}
+	state = RUNNING;
+	const bool more = step();
+	if (closing) {
+		setClosed();
+		return true;
+	}
+	if (!more) {
+		int expected = RUNNING;
+		if (state.compare_exchange_strong(expected, IDLE)) {
+			if (closing) {
+				// NOTE: close saw RUNNING and is waiting, make sure it is released
+				expected = IDLE;
+				if (state.compare_exchange_strong(expected, CLOSED)) {
+					std::lock_guard<std::mutex> locker(close_mutex);
+					close_cond.notify_all();
+				}
+			}
+			return true;
+		}
+	}
+	// more work, or woken while running
+	state = QUEUED;
+	return false;
+}
+
+void CUVExecutorTask::setClosed() {
+	std::lock_guard<std::mutex> locker(close_mutex);
+	state = CLOSED;
+	close_cond.notify_all();
+}
+
+/**
+ * class CUVExecutor
+ */
+void CUVExecutor::setDefaultThreads(const unsigned num) {
+	s_default_threads = num;
+}
+
+CUVExecutor& CUVExecutor::instance() {
+	static CUVExecutor executor(s_default_threads);
+	return executor;
+}
+
+CUVExecutor::CUVExecutor(unsigned num) {
+	if (num == 0) {
+		num = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned i = 0; i < num; ++i) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+	for (unsigned i = 0; i < num; ++i) {
+		worker_threads.emplace_back([this, i] { workerLoop(i); });
+	}
+}
+
+CUVExecutor::~CUVExecutor() {
+	{
+		std::lock_guard<std::mutex> locker(sleep_mutex);
+		quit = true;
+	}
+	sleep_cond.notify_all();
+	for (auto& thread: worker_threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+}
+
+std::shared_ptr<CUVExecutorTask> CUVExecutor::create(CUVExecutorTask::StepFunc step, const int priority) {
+	auto task = std::make_shared<CUVExecutorTask>(std::move(step), priority);
+	task->self = task;
+	return task;
+}
+
+void CUVExecutor::submit(std::shared_ptr<CUVExecutorTask> task) {
+	// NOTE: a worker keeps what it schedules (queue readiness from its own step), others spread round robin
+	const size_t index = t_worker_index >= 0 ? static_cast<size_t>(t_worker_index) : next_worker++ % workers.size();
+	Worker& worker = *workers[index];
+	{
+		std::lock_guard<std::mutex> locker(worker.mutex);
+		worker.queues[task->priority()].push_back(std::move(task));
+		++pending;
+	}
+	std::lock_guard<std::mutex> locker(sleep_mutex);
+	sleep_cond.notify_one();
+}
+
+bool CUVExecutor::take(const size_t index, std::shared_ptr<CUVExecutorTask>* task) {
+	const size_t num = workers.size();
+	for (int priority = 0; priority < UVTASK_PRIORITY_NUM; ++priority) {
+		for (size_t i = 0; i < num; ++i) {
+			Worker& worker = *workers[(index + i) % num];
+			std::lock_guard<std::mutex> locker(worker.mutex);
+			auto& queue = worker.queues[priority];
+			if (queue.empty()) {
+				continue;
+			}
+			// own queue from the front (round robin between streams), steal from the back
+			if (i == 0) {
+				*task = std::move(queue.front());
+				queue.pop_front();
+			} else {
+				*task = std::move(queue.back());
+				queue.pop_back();
+			}
+			--pending;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CUVExecutor::workerLoop(const size_t index) {
+	t_worker_index = static_cast<int>(index);
+	std::shared_ptr<CUVExecutorTask> task;
+	while (!quit) {
+		if (!take(index, &task)) {
+			std::unique_lock<std::mutex> locker(sleep_mutex);
+			sleep_cond.wait(locker, [this] { return quit || pending > 0; });
+			continue;
+		}
+		if (!task->run()) {
+			submit(std::move(task));
+		}
+		task.reset();
+	}
+}
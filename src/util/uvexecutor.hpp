@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum uvtask_priority_e {
+	UVTASK_PRIORITY_HIGH = 0, // focused tile
+	UVTASK_PRIORITY_NORMAL,
+	UVTASK_PRIORITY_LOW,
+	UVTASK_PRIORITY_NUM,
+};
+
+/**
+ * @note: 共享线程池中的一个协作式流水线阶段. step 每次只做有限的工作且不能阻塞,
+ * 返回 true 表示还有工作, 立即重新排队; 返回 false 则休眠, 直到生产者(队列可读/可写)调用 wake.
+ * 同一任务同一时刻只在一个线程上运行, 运行中被 wake 会在结束后再跑一次, 不会丢失唤醒.
+ * close 之后不再运行, 并等待正在运行的 step 返回.
+ */
+class CUVExecutorTask {
+public:
+	typedef std::function<bool()> StepFunc;
+
+	CUVExecutorTask(StepFunc step, int priority);
+
+	CUVExecutorTask(const CUVExecutorTask&) = delete;
+	CUVExecutorTask& operator=(const CUVExecutorTask&) = delete;
+
+	void wake();
+	void setPriority(int priority);
+	[[nodiscard]] int priority() const { return task_priority; }
+	void close();
+
+private:
+	friend class CUVExecutor;
+
+	enum State {
+		IDLE,
+		QUEUED,
+		RUNNING,
+		RUNNING_WOKEN, // woken while running, run again
+		CLOSED,
+	};
+
+	// worker side, false if the task has to be queued again
+	bool run();
+	void setClosed();
+
+	StepFunc step;
+	std::atomic<int> state{ IDLE };
+	std::atomic<int> task_priority;
+	std::atomic<bool> closing{ false };
+	std::mutex close_mutex;
+	std::condition_variable close_cond;
+	// NOTE: set by CUVExecutor::create, the task queues itself on wake
+	std::weak_ptr<CUVExecutorTask> self;
+};
+
+/**
+ * @note: 所有播放器共享的 work-stealing 线程池, 线程数默认等于 CPU 核数.
+ * 每个工作线程按优先级各有一个队列, 取任务时先按优先级从高到低, 同一优先级先取自己的队首,
+ * 再从其他线程的队尾窃取; 任务粒度是一次 step, 高优先级任务在下一个 step 边界抢占低优先级任务.
+ */
+class CUVExecutor {
+public:
+	// before the first instance(), 0: hardware concurrency
+	static void setDefaultThreads(unsigned num);
+	static CUVExecutor& instance();
+
+	~CUVExecutor();
+
+	CUVExecutor(const CUVExecutor&) = delete;
+	CUVExecutor& operator=(const CUVExecutor&) = delete;
+
+	// the task is idle until its first wake
+	std::shared_ptr<CUVExecutorTask> create(CUVExecutorTask::StepFunc step, int priority = UVTASK_PRIORITY_NORMAL);
+	[[nodiscard]] size_t threads() const { return workers.size(); }
+
+private:
+	friend class CUVExecutorTask;
+
+	explicit CUVExecutor(unsigned num);
+
+	void submit(std::shared_ptr<CUVExecutorTask> task);
+	bool take(size_t index, std::shared_ptr<CUVExecutorTask>* task);
+	void workerLoop(size_t index);
+
+	typedef struct worker_s {
+		std::mutex mutex;
+		std::deque<std::shared_ptr<CUVExecutorTask>> queues[UVTASK_PRIORITY_NUM];
+	} Worker;
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> worker_threads;
+	std::atomic<size_t> next_worker{ 0 };
+	std::atomic<size_t> pending{ 0 };
+	std::atomic<bool> quit{ false };
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cond;
+};
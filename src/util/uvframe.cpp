@@ -1,75 +1,401 @@
 ﻿#include "uvframe.hpp"
 
+#include <thread>
+
+#include "def/avdef.hpp"
+
+// bytes per row and rows of each plane, returns the plane count
+// NOTE: packed frames follow the legacy layout [Y w*h][U w*h/4][V w*h/4], strided ones round chroma up
+static int plane_geometry(const CUVFrame* pFrame, int bytes[4], int rows[4]) {
+	const int w = pFrame->w;
+	const int h = pFrame->h;
+	const int cw = pFrame->isStrided() ? (w + 1) >> 1 : w >> 1;
+	const int ch = pFrame->isStrided() ? (h + 1) >> 1 : h >> 1;
+	switch (pFrame->type) {
+		case PIX_FMT_IYUV:
+		case PIX_FMT_YV12:
+			bytes[0] = w;
+			rows[0] = h;
+			bytes[1] = bytes[2] = cw;
+			rows[1] = rows[2] = ch;
+			return 3;
+		case PIX_FMT_NV12:
+		case PIX_FMT_NV21:
+			bytes[0] = w;
+			rows[0] = h;
+			bytes[1] = cw * 2;
+			rows[1] = ch;
+			return 2;
+		default:
+			bytes[0] = w * (pFrame->bpp ? pFrame->bpp : pix_fmt_bpp(pFrame->type)) / 8;
+			rows[0] = h;
+			return 1;
+	}
+}
+
+/**
+ * class CUVFrame
+ */
+void CUVFrame::planes(uint8_t* dst_data[4], int dst_linesize[4]) const {
+	if (isStrided()) {
+		std::copy(std::begin(data), std::end(data), dst_data);
+		std::copy(std::begin(linesize), std::end(linesize), dst_linesize);
+		return;
+	}
+
+	int bytes[4]{};
+	int rows[4]{};
+	const int nb_planes = plane_geometry(this, bytes, rows);
+	auto ptr = reinterpret_cast<uint8_t*>(buf.base);
+	for (int i = 0; i < 4; ++i) {
+		dst_data[i] = i < nb_planes ? ptr : nullptr;
+		dst_linesize[i] = i < nb_planes ? bytes[i] : 0;
+		if (i < nb_planes) {
+			ptr += bytes[i] * rows[i];
+		}
+	}
+	if (type == PIX_FMT_YV12) {
+		std::swap(dst_data[1], dst_data[2]);
+	}
+}
+
+size_t CUVFrame::packedSize() const {
+	int bytes[4]{};
+	int rows[4]{};
+	const int nb_planes = plane_geometry(this, bytes, rows);
+	size_t size = 0;
+	for (int i = 0; i < nb_planes; ++i) {
+		size += static_cast<size_t>(bytes[i]) * rows[i];
+	}
+	return size;
+}
+
+void CUVFrame::pack(void* dst) const {
+	uint8_t* src_data[4]{};
+	int src_linesize[4]{};
+	planes(src_data, src_linesize);
+	if (type == PIX_FMT_YV12) {
+		// YV12 stores V before U
+		std::swap(src_data[1], src_data[2]);
+	}
+
+	int bytes[4]{};
+	int rows[4]{};
+	const int nb_planes = plane_geometry(this, bytes, rows);
+	auto ptr = static_cast<uint8_t*>(dst);
+	for (int i = 0; i < nb_planes; ++i) {
+		for (int r = 0; r < rows[i]; ++r) {
+			memcpy(ptr, src_data[i] + static_cast<ptrdiff_t>(r) * src_linesize[i], bytes[i]);
+			ptr += bytes[i];
+		}
+	}
+}
+
+/**
+ * class CUVFramePool
+ */
+CUVFramePool::CUVFramePool(const int max_free) : max_free(max_free) {
+	account = CUVMemoryBudget::instance().open("frame pool", [this] { clear(); });
+}
+
+CUVFramePool::~CUVFramePool() {
+	account->detach();
+	clear();
+}
+
+std::shared_ptr<CUVBuf> CUVFramePool::acquire(const size_t len, const bool wait) {
+	CUVBuf* pBuf = nullptr;
+	{
+		QMutexLocker locker(&mutex);
+		if (len != buf_len) {
+			// NOTE: frame size changed, idle buffers are useless now
+			for (const auto& buf: free_bufs) {
+				dispose(buf);
+			}
+			free_bufs.clear();
+			buf_len = len;
+		}
+		if (!free_bufs.empty()) {
+			pBuf = free_bufs.back();
+			free_bufs.pop_back();
+			++reuse_cnt;
+		}
+	}
+
+	if (!pBuf) {
+		const size_t bytes = len + FRAME_POOL_PADDING;
+		if (!account->reserve(bytes)) {
+			// NOTE: over budget, give the consumer a moment to hand a frame back (backpressure),
+			// then allocate anyway, the frame cache drops its oldest frames while over budget;
+			// a caller that must not block retries after the consumer took a frame
+			if (!wait) {
+				return nullptr;
+			}
+			QMutexLocker locker(&mutex);
+			cond_writable.wait(&mutex, FRAME_POOL_BUDGET_WAIT_MS);
+			if (!free_bufs.empty() && len == buf_len) {
+				pBuf = free_bufs.back();
+				free_bufs.pop_back();
+				++reuse_cnt;
+			} else {
+				account->charge(bytes);
+			}
+		}
+		if (!pBuf) {
+			// NOTE: sws_scale overwrites the whole frame, no zero fill; aligned and padded for its SIMD stores
+			pBuf = new CUVAlignedBuf(len, UV_CACHELINE_SIZE, FRAME_POOL_PADDING);
+			++alloc_cnt;
+		}
+	}
+
+	std::weak_ptr<CUVFramePool> weak_pool = shared_from_this();
+	return { pBuf, [weak_pool, account = account](CUVBuf* buf) {
+		if (const auto pool = weak_pool.lock()) {
+			pool->recycle(buf);
+		} else {
+			account->release(buf->len + FRAME_POOL_PADDING);
+			delete buf;
+		}
+	} };
+}
+
+void CUVFramePool::setMaxFree(const int num) {
+	QMutexLocker locker(&mutex);
+	max_free = num;
+	while (static_cast<int>(free_bufs.size()) > max_free) {
+		dispose(free_bufs.back());
+		free_bufs.pop_back();
+	}
+}
+
+void CUVFramePool::clear() {
+	QMutexLocker locker(&mutex);
+	for (const auto& buf: free_bufs) {
+		dispose(buf);
+	}
+	free_bufs.clear();
+}
+
+void CUVFramePool::recycle(CUVBuf* pBuf) {
+	{
+		QMutexLocker locker(&mutex);
+		cond_writable.wakeAll();
+		// NOTE: over budget, idle buffers go back to the system instead of the free list
+		if (pBuf->len == buf_len && static_cast<int>(free_bufs.size()) < max_free && !account->overBudget()) {
+			free_bufs.push_back(pBuf);
+			return;
+		}
+	}
+	dispose(pBuf);
+}
+
+void CUVFramePool::dispose(CUVBuf* pBuf) const {
+	account->release(pBuf->len + FRAME_POOL_PADDING);
+	delete pBuf;
+}
+
+/**
+ * class CUVFrameBuf
+ */
+int CUVFrameBuf::alloc(CUVFrame* pFrame, const size_t len, const bool wait) const {
+	pFrame->unref();
+	// NOTE: with nothing queued no frame comes back to wake the caller, never fail then
+	const auto ref = pool->acquire(len, wait || size() == 0);
+	if (!ref) {
+		return -1;
+	}
+	pFrame->buf.base = ref->base;
+	pFrame->buf.len = len;
+	pFrame->buf_ref = ref;
+	return 0;
+}
+
+void CUVFrameBuf::reserve(const int num) {
+	clear();
+	size_t n = 1;
+	while (n < static_cast<size_t>(num)) n <<= 1;
+	ring.reset(new FrameSlot[n]);
+	for (size_t i = 0; i < n; ++i) {
+		ring[i].seq.store(i, std::memory_order_relaxed);
+	}
+	capacity = n;
+	mask = n - 1;
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_release);
+}
+
+bool CUVFrameBuf::claim(CUVFrame* pFrame) {
+	if (!ring) {
+		return false;
+	}
+	size_t pos = head.load(std::memory_order_relaxed);
+	for (;;) {
+		FrameSlot& slot = ring[pos & mask];
+		const size_t seq = slot.seq.load(std::memory_order_acquire);
+		const auto dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+		if (dif < 0) {
+			return false; // empty
+		}
+		if (dif > 0) {
+			// the other side took it first
+			pos = head.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+			pFrame->ref(slot.frame);
+			slot.frame.unref();
+			slot.frame.userdata = nullptr;
+			slot.seq.store(pos + capacity, std::memory_order_release);
+			return true;
+		}
+	}
+}
+
 int CUVFrameBuf::push(CUVFrame* pFrame) {
 	if (pFrame->isNull())
 		return -10;
 
-	frame_stats.push_cnt++;
-
-	QMutexLocker locker(&mutex);
+	++push_cnt;
 
-	if (frames.size() >= (size_t) cache_num) {
+	for (;;) {
+		const size_t pos = tail.load(std::memory_order_relaxed);
+		if (hasRoom(pos - head.load(std::memory_order_acquire))) {
+			break;
+		}
 		if (policy == CUVFrameBuf::DISCARD) {
 			return -20; // note: cache full, discard frame
 		}
 
-		CUVFrame& frame = frames.front();
-		frames.pop_front();
-		free(frame.buf.len);
-		if (frame.userdata) {
-			::free(frame.userdata);
-			frame.userdata = nullptr;
+		// NOTE: squeeze out the oldest frame, the consumer may have taken it meanwhile
+		CUVFrame front;
+		if (claim(&front) && front.userdata) {
+			::free(front.userdata);
+		}
+	}
+
+	const size_t pos = tail.load(std::memory_order_relaxed);
+	FrameSlot& slot = ring[pos & mask];
+	// NOTE: the slot of the last round is claimed already, wait for the claimer to finish taking the reference
+	while (slot.seq.load(std::memory_order_acquire) != pos) {
+		std::this_thread::yield();
+	}
+
+	if (pFrame->buf_ref) {
+		slot.frame.ref(*pFrame);
+	} else {
+		// NOTE: caller owns the memory, copy once into pooled memory so the queue can share it
+		CUVFrame& frame = slot.frame;
+		if (pFrame->isStrided()) {
+			alloc(&frame, pFrame->packedSize());
+			pFrame->pack(frame.buf.base);
+		} else {
+			alloc(&frame, pFrame->buf.len);
+			memcpy(frame.buf.base, pFrame->buf.base, pFrame->buf.len);
 		}
+		frame.w = pFrame->w;
+		frame.h = pFrame->h;
+		frame.bpp = pFrame->bpp;
+		frame.type = pFrame->type;
+		frame.ts = pFrame->ts;
+		frame.serial = pFrame->serial;
+		frame.recv_time = pFrame->recv_time;
+		frame.useridx = pFrame->useridx;
+		frame.userdata = pFrame->userdata;
 	}
 
 	int ret = 0;
-	if (isNull()) {
-		resize(pFrame->buf.len * cache_num);
-		ret = 1; // note: first push
+	const CUVFrame& frame = slot.frame;
+	if (frame_info.w != frame.w || frame_info.h != frame.h || frame_info.type != frame.type) {
+		ret = 1; // note: first push or frame format changed
 
-		frame_info.w = pFrame->w;
-		frame_info.h = pFrame->h;
-		frame_info.type = pFrame->type;
-		frame_info.bpp = pFrame->bpp;
+		frame_info.w = frame.w;
+		frame_info.h = frame.h;
+		frame_info.type = frame.type;
+		frame_info.bpp = frame.bpp;
 	}
 
-	CUVFrame frame;
-	frame.buf.base = alloc(pFrame->buf.len);
-	frame.buf.len = pFrame->buf.len;
-	frame.copy(*pFrame);
-	frames.push_back(frame);
-	frame_stats.push_ok_cnt++;
+	// NOTE: tail before seq, a claim can never move head past tail
+	tail.store(pos + 1, std::memory_order_release);
+	slot.seq.store(pos + 1, std::memory_order_release);
+	++push_ok_cnt;
 
 	return ret;
 }
 
 int CUVFrameBuf::pop(CUVFrame* pFrame) {
-	frame_stats.pop_cnt++;
-
-	QMutexLocker locker(&mutex);
+	++pop_cnt;
 
-	if (isNull())
-		return -10;
-
-	if (frames.empty()) {
+	CUVFrame frame;
+	if (!claim(&frame)) {
 		return -20;
 	}
-
-	CUVFrame& frame = frames.front();
-	frames.pop_front();
-	free(frame.buf.len);
+	// NOTE: store(head) then load(writer_waiting) here, store(writer_waiting) then load(head) in waitWritable;
+	// the claim CAS is relaxed, only the fences on both sides order each store before the other load
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (writer_waiting.load(std::memory_order_relaxed)) {
+		QMutexLocker locker(&mutex);
+		cond_writable.wakeAll();
+	}
+	if (writable_cb) {
+		writable_cb();
+	}
 
 	if (frame.isNull())
 		return -30;
 
-	pFrame->copy(frame);
-	frame_stats.pop_ok_cnt++;
+	pFrame->ref(frame);
+	++pop_ok_cnt;
 
 	return 0;
 }
 
 void CUVFrameBuf::clear() {
+	CUVFrame frame;
+	while (claim(&frame)) {
+		frame.unref();
+	}
+	{
+		QMutexLocker locker(&mutex);
+		cond_writable.wakeAll();
+	}
+	if (writable_cb) {
+		writable_cb();
+	}
+}
+
+size_t CUVFrameBuf::size() const {
+	// NOTE: head first, tail read later is never behind it
+	const size_t h = head.load(std::memory_order_acquire);
+	const size_t t = tail.load(std::memory_order_acquire);
+	return t - h;
+}
+
+bool CUVFrameBuf::waitWritable(const int timeout_ms) {
+	if (hasRoom(size())) {
+		return true;
+	}
+	// NOTE: pop sees the flag after its claim, or the size below already sees the claim (see pop);
+	// the timeout stays as a bound should the consumer never come
 	QMutexLocker locker(&mutex);
-	frames.clear();
-	CUVRingBuf::clear();
+	writer_waiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!hasRoom(size())) {
+		cond_writable.wait(&mutex, timeout_ms);
+	}
+	writer_waiting.store(false, std::memory_order_relaxed);
+	return hasRoom(size());
+}
+
+bool CUVFrameBuf::hasRoom(const size_t queued) const {
+	// NOTE: while the owner is over its memory budget the cache shrinks to one frame, SQUEEZE drops the oldest
+	return queued < static_cast<size_t>(cache_num.load()) && (queued == 0 || !pool->overBudget());
+}
+
+FrameStats CUVFrameBuf::stats() const {
+	FrameStats stats;
+	stats.push_cnt = push_cnt;
+	stats.pop_cnt = pop_cnt;
+	stats.push_ok_cnt = push_ok_cnt;
+	stats.pop_ok_cnt = pop_ok_cnt;
+	return stats;
 }
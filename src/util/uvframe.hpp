@@ -1,16 +1,32 @@
 ﻿#pragma once
 
-#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <QMutexLocker>
+#include <QWaitCondition>
 
 #include "uvbuf.hpp"
+#include "uvmemorybudget.hpp"
 
 class CUVFrame {
 public:
 	CUVBuf buf{};
+	// NOTE: shared handle of the memory buf points to, set => buf is borrowed and released with the last reference
+	std::shared_ptr<void> buf_ref{};
+	// NOTE: strided planes (e.g. the decoder's own AVFrame), linesize[0] == 0 means planes are packed in buf
+	uint8_t* data[4]{};
+	int linesize[4]{};
 	int w{}, h{}, bpp{}, type{};
 	uint64_t ts{};
+	// packet queue serial the frame was decoded from, changes on seek
+	int serial{};
+	// CUVClock::now() when its packet was demuxed, 0 unknown
+	double recv_time{};
 	int64_t useridx{};
 	void* userdata{};
 
@@ -22,21 +38,113 @@ public:
 	}
 
 	[[nodiscard]] bool isNull() {
-		return w == 0 || h == 0 || buf.isNull();
+		return w == 0 || h == 0 || (buf.isNull() && !data[0]);
 	}
 
+	[[nodiscard]] bool isStrided() const {
+		return linesize[0] != 0;
+	}
+
+	// plane pointers and strides, U before V for planar yuv
+	void planes(uint8_t* dst_data[4], int dst_linesize[4]) const;
+	// size of the frame with all planes packed without padding
+	[[nodiscard]] size_t packedSize() const;
+	void pack(void* dst) const;
+
+	// deep copy, always owns packed memory afterwards
 	void copy(const CUVFrame& rhs) {
+		if (this == &rhs) return;
+		if (buf_ref) {
+			unref();
+		}
+		copyInfo(rhs);
+		if (rhs.isStrided()) {
+			buf.resize(rhs.packedSize());
+			rhs.pack(buf.base);
+		} else {
+			buf.copy(rhs.buf.base, rhs.buf.len);
+		}
+	}
+
+	// shallow copy, share the memory of rhs if it is refcounted, otherwise fallback to copy
+	void ref(const CUVFrame& rhs) {
+		if (this == &rhs) return;
+		if (!rhs.buf_ref) {
+			copy(rhs);
+			return;
+		}
+		unref();
+		copyInfo(rhs);
+		buf_ref = rhs.buf_ref;
+		buf.base = rhs.buf.base;
+		buf.len = rhs.buf.len;
+		std::copy(std::begin(rhs.data), std::end(rhs.data), data);
+		std::copy(std::begin(rhs.linesize), std::end(rhs.linesize), linesize);
+	}
+
+	// drop the memory, return it to the pool if this is the last reference
+	void unref() {
+		buf.cleanup();
+		buf.base = nullptr;
+		buf.len = 0;
+		buf_ref.reset();
+		std::fill(std::begin(data), std::end(data), nullptr);
+		std::fill(std::begin(linesize), std::end(linesize), 0);
+	}
+
+private:
+	void copyInfo(const CUVFrame& rhs) {
 		w = rhs.w;
 		h = rhs.h;
 		bpp = rhs.bpp;
 		type = rhs.type;
 		ts = rhs.ts;
+		serial = rhs.serial;
+		recv_time = rhs.recv_time;
 		useridx = rhs.useridx;
 		userdata = rhs.userdata;
-		buf.copy(rhs.buf.base, rhs.buf.len);
 	}
 };
 
+/**
+ * @note: 帧内存池, acquire 返回的 CUVBuf 在最后一个引用释放时回到空闲链表,
+ * 池已析构(播放器先于渲染窗口销毁)时直接释放.
+ */
+// readable bytes behind each frame for SIMD stores
+#define FRAME_POOL_PADDING          64
+// over the memory budget, how long a waiting acquire blocks for a frame to come back before allocating anyway
+#define FRAME_POOL_BUDGET_WAIT_MS   20
+
+class CUVFramePool : public std::enable_shared_from_this<CUVFramePool> {
+public:
+	explicit CUVFramePool(int max_free = 0);
+	~CUVFramePool();
+
+	// over budget without an idle buffer: wait, then allocate anyway; nullptr at once when wait is false
+	std::shared_ptr<CUVBuf> acquire(size_t len, bool wait = true);
+	void setMaxFree(int num);
+	void clear();
+
+	void setBudgetOwner(const void* owner) { account->setOwner(owner); }
+	// the owner (player) is over its memory budget
+	[[nodiscard]] bool overBudget() const { return account->overBudget(); }
+
+	int alloc_cnt{};
+	int reuse_cnt{};
+
+private:
+	void recycle(CUVBuf* pBuf);
+	void dispose(CUVBuf* pBuf) const;
+
+	// NOTE: outlives the pool while frames are out, their deleter releases into it
+	std::shared_ptr<CUVMemoryAccount> account;
+	int max_free;
+	size_t buf_len{};
+	std::vector<CUVBuf*> free_bufs;
+	QMutex mutex;
+	QWaitCondition cond_writable;
+};
+
 typedef struct frame_info_s {
 	int w;
 	int h;
@@ -51,37 +159,130 @@ typedef struct frame_stats_s {
 	int push_ok_cnt;
 	int pop_ok_cnt;
 
+	// packet queue depth between demux and decode
+	int packet_num;
+	size_t packet_bytes;
+
+	// decoder get_buffer2 pool: buffers reused / newly allocated
+	int pool_hit_cnt;
+	int pool_miss_cnt;
+	// frame, packet and decoder buffers charged to the player, see CUVMemoryBudget
+	size_t mem_bytes;
+	// decode thread doTask time, ms
+	double decode_avg_ms;
+	double decode_max_ms;
+	// libavcodec threads assigned by the decoder thread budget, 0 auto (hardware decode)
+	int decoder_threads;
+	// sws_scale slice threads and time per converted frame, 0 for pass-through
+	int convert_threads;
+	double convert_avg_ms;
+
+	// av sync: dropped before conversion / at display, repeated when starved
+	int drop_early_cnt;
+	int drop_late_cnt;
+	int repeat_cnt;
+	// video clock - master clock (video master: display lateness), ms
+	double drift_ms;
+	double drift_max_ms;
+	// demux => display latency of the last shown frame, ms
+	double latency_ms;
+
 	frame_stats_s() {
 		push_cnt = pop_cnt = push_ok_cnt = pop_ok_cnt = 0;
+		packet_num = 0;
+		packet_bytes = 0;
+		pool_hit_cnt = pool_miss_cnt = 0;
+		mem_bytes = 0;
+		decode_avg_ms = decode_max_ms = 0;
+		decoder_threads = 0;
+		convert_threads = 0;
+		convert_avg_ms = 0;
+		drop_early_cnt = drop_late_cnt = repeat_cnt = 0;
+		drift_ms = drift_max_ms = 0;
+		latency_ms = 0;
 	}
 } FrameStats;
 
 #define DEFAULT_FRAME_CACHENUM  10
+#define UV_CACHELINE_SIZE       64
 
-class CUVFrameBuf final : public CUVRingBuf {
+/**
+ * @note: 帧队列只保存帧的引用, push/pop 不再拷贝像素数据.
+ * 生产者通过 alloc 从 pool 取得缓冲区, 写入后 push; 消费者 pop 得到同一块内存.
+ * 队列为固定容量的无锁环(每个槽带序号), 只有一个生产者(解码线程)和一个消费者(渲染线程),
+ * SQUEEZE 时由生产者像消费者一样抢占最旧的槽丢弃, 因此 head 用 CAS 推进;
+ * 只有 waitWritable 在队列满时才用到 mutex.
+ */
+class CUVFrameBuf final {
 public:
 	enum CacheFullPolicy {
 		SQUEEZE,
 		DISCARD,
-	} policy;
+	};
 
 	CUVFrameBuf() {
-		cache_num = DEFAULT_FRAME_CACHENUM;
-		policy = SQUEEZE;
+		reserve(DEFAULT_FRAME_CACHENUM);
+		pool = std::make_shared<CUVFramePool>(DEFAULT_FRAME_CACHENUM + 2);
 	}
 
-	void setCache(const int num) { cache_num = num; }
+	// NOTE: growing beyond the ring capacity reallocates it, only before producer/consumer run
+	void setCache(const int num) {
+		const int cache = num > 0 ? num : 1;
+		if (static_cast<size_t>(cache) > capacity) {
+			reserve(cache);
+		}
+		cache_num = cache;
+		// cache_num queued + one being written by producer + one being displayed by consumer
+		pool->setMaxFree(cache + 2);
+	}
 
 	void setPolicy(const CacheFullPolicy& policy) { this->policy = policy; }
 
+	// -1 when wait is false, the pool is over budget and frames are still queued to come back
+	int alloc(CUVFrame* pFrame, size_t len, bool wait = true) const;
+	// producer
 	int push(CUVFrame* pFrame);
+	// consumer
 	int pop(CUVFrame* pFrame);
-	void clear() override;
+	void clear();
+	[[nodiscard]] size_t size() const;
+	// block the producer until the cache has room, false on timeout
+	bool waitWritable(int timeout_ms);
+	// called by the consumer after it took a frame, wakes a producer that does not block in waitWritable
+	// NOTE: set before the consumer starts
+	void setWritableCallback(std::function<void()> cb) { writable_cb = std::move(cb); }
+	[[nodiscard]] FrameStats stats() const;
 
-	int cache_num;
-	FrameStats frame_stats;
 	FrameInfo frame_info{};
-	std::deque<CUVFrame> frames;
+	std::shared_ptr<CUVFramePool> pool;
+
+private:
+	void reserve(int num);
+	[[nodiscard]] bool hasRoom(size_t queued) const;
+	// take the oldest frame, used by the consumer and by the producer squeezing
+	bool claim(CUVFrame* pFrame);
+
+	typedef struct frame_slot_s {
+		// pos + 1: filled for pos, pos + capacity: free for the next round
+		std::atomic<size_t> seq{};
+		CUVFrame frame;
+	} FrameSlot;
+
+	std::unique_ptr<FrameSlot[]> ring;
+	size_t capacity{};
+	size_t mask{};
+	std::atomic<int> cache_num{ DEFAULT_FRAME_CACHENUM };
+	std::atomic<CacheFullPolicy> policy{ SQUEEZE };
+
+	alignas(UV_CACHELINE_SIZE) std::atomic<size_t> head{ 0 };
+	std::atomic<int> pop_cnt{ 0 };
+	std::atomic<int> pop_ok_cnt{ 0 };
+	alignas(UV_CACHELINE_SIZE) std::atomic<size_t> tail{ 0 };
+	std::atomic<int> push_cnt{ 0 };
+	std::atomic<int> push_ok_cnt{ 0 };
+	alignas(UV_CACHELINE_SIZE) std::atomic<bool> writer_waiting{ false };
+	std::function<void()> writable_cb;
 
 	QMutex mutex;
+	QWaitCondition cond_writable;
 };
@@ -0,0 +1,101 @@
+﻿#include "uvlagmonitor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+
+/**
+ * class CUVLagMonitor
+ */
+CUVLagMonitor& CUVLagMonitor::instance() {
+	static CUVLagMonitor monitor;
+	return monitor;
+}
+
+CUVLagMonitor::~CUVLagMonitor() {
+	stop();
+}
+
+int64_t CUVLagMonitor::now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CUVLagMonitor::start(const int threshold_ms) {
+	if (threshold_ms <= 0 || thread.joinable()) {
+		return;
+	}
+	threshold = threshold_ms;
+	stopped = false;
+	QCoreApplication::instance()->installEventFilter(this);
+	if (const auto dispatcher = QAbstractEventDispatcher::instance()) {
+		connect(dispatcher, &QAbstractEventDispatcher::awake, this, &CUVLagMonitor::onAwake, Qt::DirectConnection);
+		connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &CUVLagMonitor::onAboutToBlock, Qt::DirectConnection);
+	}
+	thread = std::thread(&CUVLagMonitor::watch, this);
+}
+
+void CUVLagMonitor::stop() {
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		stopped = true;
+		cond.notify_one();
+	}
+	if (thread.joinable()) {
+		thread.join();
+	}
+	if (const auto app = QCoreApplication::instance()) {
+		app->removeEventFilter(this);
+	}
+	if (const auto dispatcher = QAbstractEventDispatcher::instance()) {
+		disconnect(dispatcher, nullptr, this, nullptr);
+	}
+}
+
+bool CUVLagMonitor::eventFilter(QObject* watched, QEvent* event) {
+	// NOTE: only remembers the event being dispatched, two relaxed stores per event
+	event_class.store(watched->metaObject()->className(), std::memory_order_relaxed);
+	event_type.store(event->type(), std::memory_order_relaxed);
+	return false;
+}
+
+void CUVLagMonitor::onAwake() {
+	if (busy_since == 0) {
+		busy_since = now();
+	}
+}
+
+void CUVLagMonitor::onAboutToBlock() {
+	const int64_t since = busy_since.exchange(0);
+	const int64_t elapsed = since ? now() - since : 0;
+	std::lock_guard<std::mutex> locker(mutex);
+	if (elapsed >= threshold) {
+		qWarning() << "GUI event loop blocked" << elapsed << "ms in" << (reported ? stall_cause : cause()).c_str();
+	}
+	reported = false;
+}
+
+std::string CUVLagMonitor::cause() const {
+	if (const char* what = scope.load()) {
+		return what;
+	}
+	const char* cls = event_class.load(std::memory_order_relaxed);
+	return std::string(cls ? cls : "?") + " event " + std::to_string(event_type.load(std::memory_order_relaxed));
+}
+
+void CUVLagMonitor::watch() {
+	// NOTE: sample twice per threshold, a stall is seen within 1.5 x threshold
+	const auto period = std::chrono::milliseconds(std::max(threshold / 2, 5));
+	std::unique_lock<std::mutex> locker(mutex);
+	while (!cond.wait_for(locker, period, [this] { return stopped; })) {
+		const int64_t since = busy_since;
+		if (reported || since == 0 || now() - since < threshold) {
+			continue;
+		}
+		reported = true;
+		stall_cause = cause();
+		qWarning() << "GUI event loop stalled for" << now() - since << "ms in" << stall_cause.c_str();
+	}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <QObject>
+
+// a GUI event loop iteration longer than this is logged, ms
+#define DEFAULT_LAG_THRESHOLD_MS 50
+
+/**
+ * @note: GUI 事件循环卡顿监视. 作为 qApp 的事件过滤器记录正在分发的事件(接收者类名与事件类型),
+ * 事件分发器的 awake/aboutToBlock 界定一轮循环. 监视线程发现一轮循环超过阈值时立即记录一次, 线程卡死也能看到;
+ * 循环结束后再记录总耗时. 已知的耗时操作用 CUVLagScope 标注, 日志优先显示标注作为原因.
+ */
+class CUVLagMonitor final : public QObject {
+public:
+	static CUVLagMonitor& instance();
+
+	// GUI thread after QApplication is created, threshold_ms <= 0 disables
+	void start(int threshold_ms);
+	void stop();
+
+	// label of what the GUI thread is doing, returns the previous one, see CUVLagScope
+	const char* setScope(const char* what) {
+		return scope.exchange(what);
+	}
+
+protected:
+	bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+	CUVLagMonitor() = default;
+	~CUVLagMonitor() override;
+
+	static int64_t now();
+	void onAwake();
+	void onAboutToBlock();
+	[[nodiscard]] std::string cause() const;
+	void watch();
+
+	int threshold{};
+	std::atomic<int64_t> busy_since{ 0 }; // ms, 0 waiting for events
+	std::atomic<const char*> scope{ nullptr };
+	std::atomic<const char*> event_class{ nullptr };
+	std::atomic<int> event_type{ 0 };
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::thread thread;
+	bool stopped{};
+	bool reported{};          // this iteration was already logged by the watcher
+	std::string stall_cause;  // what the watcher saw when it logged
+};
+
+/**
+ * @note: 标注一段可能阻塞 GUI 线程的代码, 卡顿日志以此为原因.
+ */
+class CUVLagScope {
+public:
+	explicit CUVLagScope(const char* what) : prev(CUVLagMonitor::instance().setScope(what)) {
+	}
+
+	~CUVLagScope() {
+		CUVLagMonitor::instance().setScope(prev);
+	}
+
+	CUVLagScope(const CUVLagScope&) = delete;
+	CUVLagScope& operator=(const CUVLagScope&) = delete;
+
+private:
+	const char* prev;
+};
@@ -0,0 +1,186 @@
+﻿#include "uvmemorybudget.hpp"
+
+#include <algorithm>
+
+/**
+ * class CUVMemoryAccount
+ */
+CUVMemoryAccount::CUVMemoryAccount(std::string name, TrimFunc trim)
+: account_name(std::move(name)), trim_func(std::move(trim)) {
+}
+
+CUVMemoryAccount::~CUVMemoryAccount() {
+	if (const size_t bytes = used_bytes) {
+		CUVMemoryBudget::instance().sub(this, bytes);
+	}
+	CUVMemoryBudget::instance().move(this, nullptr);
+}
+
+void CUVMemoryAccount::setOwner(const void* owner) {
+	CUVMemoryBudget::instance().move(this, owner);
+}
+
+bool CUVMemoryAccount::reserve(const size_t bytes) {
+	auto& budget = CUVMemoryBudget::instance();
+	if (budget.add(this, bytes, true)) {
+		return true;
+	}
+	budget.trim(this);
+	return budget.add(this, bytes, true);
+}
+
+void CUVMemoryAccount::charge(const size_t bytes) {
+	CUVMemoryBudget::instance().add(this, bytes, false);
+}
+
+void CUVMemoryAccount::release(const size_t bytes) {
+	CUVMemoryBudget::instance().sub(this, bytes);
+}
+
+bool CUVMemoryAccount::fits(const size_t bytes) const {
+	const auto& budget = CUVMemoryBudget::instance();
+	std::lock_guard<std::mutex> locker(budget.mutex);
+	return budget.fits(owner, bytes);
+}
+
+void CUVMemoryAccount::detach() {
+	std::lock_guard<std::mutex> locker(trim_mutex);
+	trim_func = nullptr;
+}
+
+void CUVMemoryAccount::trim() {
+	// NOTE: skip a pool that is trimming or detaching, never wait on another pool here
+	std::unique_lock<std::mutex> locker(trim_mutex, std::try_to_lock);
+	if (locker.owns_lock() && trim_func) {
+		trim_func();
+	}
+}
+
+/**
+ * class CUVMemoryBudget
+ */
+CUVMemoryBudget& CUVMemoryBudget::instance() {
+	static CUVMemoryBudget budget;
+	return budget;
+}
+
+void CUVMemoryBudget::setLimits(const size_t total_bytes, const size_t player_bytes) {
+	total_limit = total_bytes;
+	player_limit = player_bytes;
+}
+
+std::shared_ptr<CUVMemoryAccount> CUVMemoryBudget::open(const std::string& name, CUVMemoryAccount::TrimFunc trim) {
+	auto account = std::make_shared<CUVMemoryAccount>(name, std::move(trim));
+	std::lock_guard<std::mutex> locker(mutex);
+	accounts.erase(std::remove_if(accounts.begin(), accounts.end(), [](const std::weak_ptr<CUVMemoryAccount>& weak) {
+		return weak.expired();
+	}), accounts.end());
+	accounts.push_back(account);
+	return account;
+}
+
+void CUVMemoryBudget::trim(const CUVMemoryAccount* skip) {
+	std::vector<std::shared_ptr<CUVMemoryAccount>> alive;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		alive.reserve(accounts.size());
+		for (const auto& weak: accounts) {
+			if (auto account = weak.lock(); account && account.get() != skip) {
+				alive.push_back(std::move(account));
+			}
+		}
+	}
+	// NOTE: trim callbacks lock their pool and release into the budget, the budget mutex is not held
+	for (const auto& account: alive) {
+		account->trim();
+	}
+}
+
+void CUVMemoryBudget::trimOwner(const void* owner) {
+	std::vector<std::shared_ptr<CUVMemoryAccount>> owned;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		for (const auto& weak: accounts) {
+			if (auto account = weak.lock(); account && account->owner == owner) {
+				owned.push_back(std::move(account));
+			}
+		}
+	}
+	for (const auto& account: owned) {
+		account->trim();
+	}
+}
+
+size_t CUVMemoryBudget::ownerUsed(const void* owner) const {
+	std::lock_guard<std::mutex> locker(mutex);
+	const auto it = owner_used.find(owner);
+	return it != owner_used.end() ? it->second : 0;
+}
+
+std::vector<CUVMemoryBudget::Usage> CUVMemoryBudget::usage() const {
+	std::vector<Usage> result;
+	std::lock_guard<std::mutex> locker(mutex);
+	for (const auto& weak: accounts) {
+		if (const auto account = weak.lock()) {
+			result.push_back({ account->account_name, account->owner, account->used_bytes });
+		}
+	}
+	return result;
+}
+
+bool CUVMemoryBudget::add(CUVMemoryAccount* account, const size_t bytes, const bool check) {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (check && !fits(account->owner, bytes)) {
+		return false;
+	}
+	account->used_bytes += bytes;
+	total_used += bytes;
+	if (account->owner) {
+		owner_used[account->owner] += bytes;
+	}
+	return true;
+}
+
+void CUVMemoryBudget::sub(CUVMemoryAccount* account, size_t bytes) {
+	std::lock_guard<std::mutex> locker(mutex);
+	bytes = std::min<size_t>(bytes, account->used_bytes);
+	account->used_bytes -= bytes;
+	total_used -= bytes;
+	if (account->owner) {
+		const auto it = owner_used.find(account->owner);
+		if (it != owner_used.end() && (it->second -= std::min(bytes, it->second)) == 0) {
+			owner_used.erase(it);
+		}
+	}
+}
+
+void CUVMemoryBudget::move(CUVMemoryAccount* account, const void* owner) {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (account->owner == owner) {
+		return;
+	}
+	const size_t bytes = account->used_bytes;
+	if (account->owner && bytes > 0) {
+		const auto it = owner_used.find(account->owner);
+		if (it != owner_used.end() && (it->second -= std::min(bytes, it->second)) == 0) {
+			owner_used.erase(it);
+		}
+	}
+	account->owner = owner;
+	if (owner && bytes > 0) {
+		owner_used[owner] += bytes;
+	}
+}
+
+bool CUVMemoryBudget::fits(const void* owner, const size_t bytes) const {
+	if (const size_t limit = total_limit; limit > 0 && total_used + bytes > limit) {
+		return false;
+	}
+	if (const size_t limit = player_limit; limit > 0 && owner) {
+		const auto it = owner_used.find(owner);
+		if ((it != owner_used.end() ? it->second : 0) + bytes > limit) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// MB, 0: unlimited
+#define DEFAULT_MEMORY_BUDGET_TOTAL     0
+#define DEFAULT_MEMORY_BUDGET_PLAYER    0
+
+class CUVMemoryBudget;
+
+/**
+ * @note: 缓冲池在内存预算中的账户, 由 CUVMemoryBudget::open 创建, 池持有它直到最后一块内存释放.
+ * 池分配新内存前 reserve (超限时先让其他池裁剪空闲内存, 仍超限返回 false, 由池决定反压或丢最旧的),
+ * 必须分配时 charge, 释放时 release. owner 是所属播放器, 用于单播放器限额.
+ * trim 回调只释放空闲内存, 调用时不持有预算的锁; 池析构前必须 detach.
+ */
+class CUVMemoryAccount {
+public:
+	typedef std::function<void()> TrimFunc;
+
+	CUVMemoryAccount(std::string name, TrimFunc trim);
+	~CUVMemoryAccount();
+
+	CUVMemoryAccount(const CUVMemoryAccount&) = delete;
+	CUVMemoryAccount& operator=(const CUVMemoryAccount&) = delete;
+
+	// moves what is charged so far to the new owner
+	void setOwner(const void* owner);
+	// charge if it fits the global and owner limits, idle pools are trimmed once when it does not
+	bool reserve(size_t bytes);
+	void charge(size_t bytes);
+	void release(size_t bytes);
+	// would bytes more still fit, no trimming
+	[[nodiscard]] bool fits(size_t bytes) const;
+	[[nodiscard]] bool overBudget() const { return !fits(0); }
+	[[nodiscard]] size_t used() const { return used_bytes; }
+	[[nodiscard]] const std::string& name() const { return account_name; }
+	// no more trim callbacks, waits for a running one
+	void detach();
+
+private:
+	friend class CUVMemoryBudget;
+	void trim();
+
+	const std::string account_name;
+	const void* owner{}; // guarded by the budget mutex
+	std::atomic<size_t> used_bytes{ 0 };
+	std::mutex trim_mutex;
+	TrimFunc trim_func;
+};
+
+/**
+ * @note: 进程内的帧/包/解码缓冲内存预算, 所有缓冲池在此登记账户.
+ * 总限额与单播放器限额(0 不限), 超限时裁剪空闲池, 并给出各账户的实时用量.
+ */
+class CUVMemoryBudget {
+public:
+	typedef struct usage_s {
+		std::string name;
+		const void* owner;
+		size_t bytes;
+	} Usage;
+
+	static CUVMemoryBudget& instance();
+
+	void setLimits(size_t total_bytes, size_t player_bytes);
+	std::shared_ptr<CUVMemoryAccount> open(const std::string& name, CUVMemoryAccount::TrimFunc trim = nullptr);
+	// ask every pool except skip to drop its idle memory
+	void trim(const CUVMemoryAccount* skip = nullptr);
+	// drop the idle memory of one owner's pools, when it pauses, hides or stops, limits or not
+	void trimOwner(const void* owner);
+
+	[[nodiscard]] size_t used() const { return total_used; }
+	[[nodiscard]] size_t ownerUsed(const void* owner) const;
+	[[nodiscard]] std::vector<Usage> usage() const;
+
+private:
+	friend class CUVMemoryAccount;
+	CUVMemoryBudget() = default;
+
+	bool add(CUVMemoryAccount* account, size_t bytes, bool check);
+	void sub(CUVMemoryAccount* account, size_t bytes);
+	void move(CUVMemoryAccount* account, const void* owner);
+	[[nodiscard]] bool fits(const void* owner, size_t bytes) const;
+
+	mutable std::mutex mutex;
+	std::vector<std::weak_ptr<CUVMemoryAccount>> accounts;
+	std::unordered_map<const void*, size_t> owner_used;
+	std::atomic<size_t> total_used{ 0 };
+	std::atomic<size_t> total_limit{ DEFAULT_MEMORY_BUDGET_TOTAL };
+	std::atomic<size_t> player_limit{ DEFAULT_MEMORY_BUDGET_PLAYER };
+};
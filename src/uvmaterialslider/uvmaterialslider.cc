@@ -315,6 +315,11 @@ void CUVMaterialSlider::mouseMoveEvent(QMouseEvent* event) {
 		}
 
 		d->setHovered(d->hoverTrack || d->hoverThumb);
+		if (d->hoverTrack) {
+			emit sigHoverValue(d->valueFromPosition(event->pos()), event->pos());
+		} else {
+			emit sigHoverLeave();
+		}
 	}
 
 	QAbstractSlider::mouseMoveEvent(event);
@@ -375,6 +380,7 @@ void CUVMaterialSlider::leaveEvent(QEvent* event) {
 	}
 
 	d->setHovered(false);
+	emit sigHoverLeave();
 
 	QAbstractSlider::leaveEvent(event);
 }
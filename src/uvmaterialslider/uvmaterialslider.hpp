@@ -59,6 +59,11 @@ public:
 
 	void setvisible(bool visible);
 
+signals:
+	// mouse over the track while not dragging, value under the cursor
+	void sigHoverValue(int value, const QPoint& pos);
+	void sigHoverLeave();
+
 protected:
 	void sliderChange(SliderChange change) override;
 	void mouseMoveEvent(QMouseEvent* event) override;
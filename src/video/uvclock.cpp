@@ -0,0 +1,315 @@
+﻿#include "uvclock.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * class CUVClock
+ */
+double CUVClock::now() {
+	using namespace std::chrono;
+	return duration_cast<duration<double, std::milli>>(steady_clock::now().time_since_epoch()).count();
+}
+
+void CUVClock::set(const double pts, const int serial) {
+	setAt(pts, serial, now());
+}
+
+void CUVClock::setAt(const double pts, const int serial, const double time) {
+	std::lock_guard<std::mutex> locker(mutex);
+	this->pts = pts;
+	last_updated = time;
+	pts_drift = pts - time;
+	clock_serial = serial;
+}
+
+double CUVClock::get() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (paused) {
+		return pts;
+	}
+	return pts_drift + now();
+}
+
+void CUVClock::setPaused(const bool paused) {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (this->paused == paused) return;
+	const double time = now();
+	if (paused) {
+		// freeze at the current position
+		pts = pts_drift + time;
+	} else {
+		pts_drift = pts - time;
+	}
+	last_updated = time;
+	this->paused = paused;
+}
+
+void CUVClock::syncTo(const CUVClock& slave) {
+	const double clock = get();
+	const double slave_clock = slave.get();
+	if (!std::isnan(slave_clock) && (std::isnan(clock) || std::fabs(clock - slave_clock) > AV_NOSYNC_THRESHOLD)) {
+		set(slave_clock, slave.serial());
+	}
+}
+
+int CUVClock::serial() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return clock_serial;
+}
+
+double CUVClock::lastUpdated() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return last_updated;
+}
+
+/**
+ * class CUVAVSync
+ */
+CUVAVSync::CUVAVSync() = default;
+
+void CUVAVSync::setMaster(const int master) {
+	sync_master = master;
+}
+
+int CUVAVSync::master() const {
+	return sync_master;
+}
+
+void CUVAVSync::setHasAudio(const bool has_audio) {
+	this->has_audio = has_audio;
+}
+
+void CUVAVSync::setFrameDuration(const double ms) {
+	if (ms > 0 && ms < AV_MAX_FRAME_DURATION) {
+		frame_duration = ms;
+	}
+}
+
+void CUVAVSync::setSerial(const int serial) {
+	cur_serial = serial;
+}
+
+void CUVAVSync::setPaused(const bool paused) {
+	if (this->paused == paused) return;
+	if (!paused) {
+		// NOTE: shift the schedule by the paused time, or all queued frames would be late
+		const double paused_ms = CUVClock::now() - vidclk.lastUpdated();
+		frame_timer += paused_ms;
+		repeat_deadline += paused_ms;
+	}
+	vidclk.setPaused(paused);
+	audclk.setPaused(paused);
+	extclk.setPaused(paused);
+	this->paused = paused;
+}
+
+int CUVAVSync::effectiveMaster() const {
+	const int master = sync_master;
+	if (master == UVSYNC_AUDIO_MASTER && !has_audio) {
+		return UVSYNC_EXTERNAL_MASTER;
+	}
+	return master;
+}
+
+double CUVAVSync::masterClock() const {
+	const CUVClock* clock = &vidclk;
+	switch (effectiveMaster()) {
+		case UVSYNC_AUDIO_MASTER: clock = &audclk;
+			break;
+		case UVSYNC_EXTERNAL_MASTER: clock = &extclk;
+			break;
+		default: break;
+	}
+	// NOTE: a clock still running on the data before seek is not usable
+	if (clock->serial() != cur_serial) {
+		return NAN;
+	}
+	return clock->get();
+}
+
+double CUVAVSync::frameDuration(const double pts, const double next_pts) const {
+	const double duration = next_pts - pts;
+	if (std::isnan(duration) || duration <= 0 || duration > AV_MAX_FRAME_DURATION) {
+		return frame_duration;
+	}
+	return duration;
+}
+
+double CUVAVSync::targetDelay(double delay) {
+	if (effectiveMaster() == UVSYNC_VIDEO_MASTER) {
+		return delay;
+	}
+
+	// video is slave, speed up or slow down to follow the master clock
+	const double diff = vidclk.get() - masterClock();
+	const double sync_threshold = std::max<double>(AV_SYNC_THRESHOLD_MIN, std::min<double>(AV_SYNC_THRESHOLD_MAX, delay));
+	if (!std::isnan(diff) && std::fabs(diff) < AV_NOSYNC_THRESHOLD) {
+		if (diff <= -sync_threshold) {
+			delay = std::max<double>(0, delay + diff);
+		} else if (diff >= sync_threshold && delay > AV_SYNC_FRAMEDUP_THRESHOLD) {
+			delay = delay + diff;
+		} else if (diff >= sync_threshold) {
+			delay = 2 * delay;
+		}
+		updateDrift(diff);
+	}
+	return delay;
+}
+
+void CUVAVSync::updateDrift(const double diff) {
+	drift_ms = diff;
+	if (std::fabs(diff) > std::fabs(drift_max_ms.load())) {
+		drift_max_ms = diff;
+	}
+}
+
+int CUVAVSync::refresh(CUVFrameBuf* frame_buf, CUVFrame* pFrame, int* remaining_ms, const double display_time) {
+	*remaining_ms = AV_REFRESH_RATE;
+	if (paused) {
+		return has_last ? 1 : -1;
+	}
+
+	// NOTE: scheduled per vsync, pick the frame for the moment it is shown rather than now
+	const double time = std::isnan(display_time) ? CUVClock::now() : display_time;
+	if (low_latency) {
+		// NOTE: live source, the newest decoded frame is shown at once, older ones are skipped
+		bool got = has_pending;
+		while (frame_buf->size() > 0 || !got) {
+			if (has_pending && frame_buf->size() > 0) {
+				++drop_late_cnt;
+			}
+			if (frame_buf->pop(&pending) != 0) {
+				break;
+			}
+			has_pending = got = true;
+		}
+		if (!has_pending || pending.serial != cur_serial) {
+			pending.unref();
+			has_pending = false;
+			return has_last ? 1 : -1;
+		}
+		frame_timer = time;
+		last_duration = frame_duration;
+		last_pts = static_cast<double>(pending.ts);
+		last_serial = pending.serial;
+		vidclk.setAt(last_pts, last_serial, time);
+		has_last = true;
+		if (pending.recv_time > 0) {
+			latency_ms = time - pending.recv_time;
+		}
+		pFrame->ref(pending);
+		pending.unref();
+		has_pending = false;
+		*remaining_ms = AV_REFRESH_RATE / 2;
+		return 0;
+	}
+
+	for (;;) {
+		if (!has_pending) {
+			if (frame_buf->pop(&pending) != 0) {
+				// starved, keep the last frame on screen; refresh polls faster than frames,
+				// count one repeat per frame duration that passed
+				if (has_last && last_duration > 0 && time >= repeat_deadline) {
+					const int repeats = static_cast<int>((time - repeat_deadline) / last_duration) + 1;
+					repeat_cnt += repeats;
+					repeat_deadline += repeats * last_duration;
+				}
+				return has_last ? 1 : -1;
+			}
+			has_pending = true;
+		}
+
+		if (pending.serial != cur_serial) {
+			// decoded before seek
+			pending.unref();
+			has_pending = false;
+			continue;
+		}
+
+		if (!has_last || pending.serial != last_serial) {
+			// first frame after open or seek, restart the schedule from now
+			frame_timer = time;
+			last_duration = frame_duration;
+			extclk.set(static_cast<double>(pending.ts), pending.serial);
+			break;
+		}
+
+		const double duration = frameDuration(last_pts, static_cast<double>(pending.ts));
+		const double delay = targetDelay(duration);
+		if (time < frame_timer + delay) {
+			*remaining_ms = static_cast<int>(std::ceil(frame_timer + delay - time));
+			return 1;
+		}
+
+		frame_timer += delay;
+		if (delay > 0 && time - frame_timer > AV_SYNC_THRESHOLD_MAX) {
+			frame_timer = time;
+		}
+		last_duration = duration;
+		last_pts = static_cast<double>(pending.ts);
+
+		// NOTE: more than one frame behind and the next one is ready, skip this one
+		if (framedrop && frame_buf->size() > 0 && time > frame_timer + duration) {
+			// the next targetDelay compares against the skipped frame's position
+			vidclk.setAt(last_pts, pending.serial, time);
+			++drop_late_cnt;
+			pending.unref();
+			has_pending = false;
+			continue;
+		}
+		break;
+	}
+
+	if (effectiveMaster() == UVSYNC_VIDEO_MASTER) {
+		updateDrift(time - frame_timer);
+	}
+	if (effectiveMaster() != UVSYNC_EXTERNAL_MASTER) {
+		extclk.syncTo(effectiveMaster() == UVSYNC_AUDIO_MASTER ? audclk : vidclk);
+	}
+
+	last_pts = static_cast<double>(pending.ts);
+	last_serial = pending.serial;
+	vidclk.setAt(last_pts, last_serial, time);
+	has_last = true;
+	repeat_deadline = frame_timer + last_duration;
+	if (pending.recv_time > 0) {
+		latency_ms = time - pending.recv_time;
+	}
+
+	pFrame->ref(pending);
+	pending.unref();
+	has_pending = false;
+
+	*remaining_ms = std::max(0, static_cast<int>(std::ceil(frame_timer + last_duration - CUVClock::now())));
+	return 0;
+}
+
+bool CUVAVSync::shouldDrop(const double pts, const int serial, const size_t queued) {
+	if (!framedrop || queued == 0 || serial != cur_serial || vidclk.serial() != serial) {
+		return false;
+	}
+	const double diff = pts - masterClock();
+	if (std::isnan(diff) || std::fabs(diff) >= AV_NOSYNC_THRESHOLD || diff >= 0) {
+		return false;
+	}
+	++drop_early_cnt;
+	return true;
+}
+
+bool CUVAVSync::shouldDropAged(const double recv_time, const double max_age) {
+	if (recv_time <= 0 || max_age <= 0 || CUVClock::now() - recv_time <= max_age) {
+		return false;
+	}
+	++drop_early_cnt;
+	return true;
+}
+
+void CUVAVSync::fillStats(FrameStats* stats) const {
+	stats->drop_early_cnt = drop_early_cnt;
+	stats->drop_late_cnt = drop_late_cnt;
+	stats->repeat_cnt = repeat_cnt;
+	stats->drift_ms = drift_ms;
+	stats->drift_max_ms = drift_max_ms;
+	stats->latency_ms = latency_ms;
+}
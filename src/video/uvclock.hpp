@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+#include "util/uvframe.hpp"
+
+// 同步阈值, 单位 ms
+#define AV_SYNC_THRESHOLD_MIN       40
+#define AV_SYNC_THRESHOLD_MAX       100
+// 误差大于该值认为时钟无效(seek, 时间戳跳变), 不做同步
+#define AV_NOSYNC_THRESHOLD         10000
+// 帧间隔大于该值认为时间戳不连续
+#define AV_MAX_FRAME_DURATION       10000
+// 单帧时长超过该值时不再通过重复帧追赶
+#define AV_SYNC_FRAMEDUP_THRESHOLD  100
+// 没有可显示帧时的重试间隔
+#define AV_REFRESH_RATE             10
+
+/**
+ * @note: 播放时钟, 记录最近一次设置的 pts 与对应的系统时间,
+ * get 返回按真实时间外推的当前 pts, serial 与包队列的 serial 对应, 不一致时时钟无效.
+ */
+class CUVClock {
+public:
+	CUVClock() = default;
+
+	// monotonic time in ms
+	static double now();
+
+	void set(double pts, int serial);
+	void setAt(double pts, int serial, double time);
+	// NAN if never set or paused at an invalid pts
+	[[nodiscard]] double get() const;
+	void setPaused(bool paused);
+	void syncTo(const CUVClock& slave);
+
+	[[nodiscard]] int serial() const;
+	[[nodiscard]] double lastUpdated() const;
+
+private:
+	mutable std::mutex mutex;
+	double pts{ NAN };        // ms
+	double pts_drift{ NAN };  // pts - last_updated
+	double last_updated{};    // ms
+	int clock_serial{ -1 };
+	bool paused{};
+};
+
+enum uvsync_master_e {
+	UVSYNC_VIDEO_MASTER,
+	UVSYNC_AUDIO_MASTER,
+	UVSYNC_EXTERNAL_MASTER,
+};
+
+#define DEFAULT_SYNC_MASTER UVSYNC_AUDIO_MASTER
+
+/**
+ * @note: 按 pts 调度视频帧的显示, 取代固定帧率的 QTimer 轮询.
+ * 持有 video/audio/external 三个时钟, 以主时钟为准计算每帧的目标延时,
+ * 落后时丢帧, 没有新帧时重复上一帧, 同时统计漂移.
+ * refresh 与 setPaused 只在渲染线程调用, shouldDrop 在解码线程调用.
+ */
+class CUVAVSync {
+public:
+	CUVAVSync();
+
+	void setMaster(int master);
+	[[nodiscard]] int master() const;
+	void setHasAudio(bool has_audio);
+	// fallback frame duration when pts is missing or discontinuous
+	void setFrameDuration(double ms);
+	// called by the player when the packet queue is flushed, older frames are dropped
+	void setSerial(int serial);
+	void setFrameDrop(bool enable) { framedrop = enable; }
+	// show the newest frame as soon as it is decoded, no pts pacing
+	void setLowLatency(bool enable) { low_latency = enable; }
+	void setPaused(bool paused);
+
+	// return 0 a new frame in pFrame, 1 keep showing the last frame, -1 no frame yet
+	// remaining_ms: time until the next call should happen
+	// display_time: when the frame reaches the screen (next vsync), NAN for now
+	int refresh(CUVFrameBuf* frame_buf, CUVFrame* pFrame, int* remaining_ms, double display_time = NAN);
+	// decode thread: true if the frame is already late and should be dropped before conversion,
+	// only when frames are still queued so the display keeps moving
+	bool shouldDrop(double pts, int serial, size_t queued);
+	// decode thread: low latency mode drops frames older than max_age regardless of the clock
+	bool shouldDropAged(double recv_time, double max_age);
+
+	void fillStats(FrameStats* stats) const;
+
+	CUVClock vidclk;
+	CUVClock audclk;
+	CUVClock extclk;
+
+private:
+	[[nodiscard]] double masterClock() const;
+	[[nodiscard]] int effectiveMaster() const;
+	[[nodiscard]] double frameDuration(double pts, double next_pts) const;
+	[[nodiscard]] double targetDelay(double delay);
+	void updateDrift(double diff);
+
+	std::atomic<int> sync_master{ DEFAULT_SYNC_MASTER };
+	std::atomic<bool> has_audio{ false };
+	std::atomic<bool> framedrop{ true };
+	std::atomic<bool> low_latency{ false };
+	std::atomic<int> cur_serial{ 0 };
+	std::atomic<double> frame_duration{ 40 };
+
+	// render thread only
+	CUVFrame pending{};
+	bool has_pending{};
+	bool has_last{};
+	double last_pts{};
+	int last_serial{ -1 };
+	double last_duration{};
+	double frame_timer{};
+	// when starved, the time the last frame counts as repeated once more
+	double repeat_deadline{};
+	bool paused{};
+
+	// stats
+	std::atomic<int> drop_early_cnt{ 0 };
+	std::atomic<int> drop_late_cnt{ 0 };
+	std::atomic<int> repeat_cnt{ 0 };
+	std::atomic<double> drift_ms{ 0 };
+	std::atomic<double> drift_max_ms{ 0 };
+	std::atomic<double> latency_ms{ 0 };
+};
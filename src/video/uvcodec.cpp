@@ -2,6 +2,10 @@
 
 #include <QDateTime>
 
+#include "uvprobecache.hpp"
+#include "uvswsconverter.hpp"
+#include "global/uvscope.hpp"
+
 //CCalcPtsDur
 inline CCalcPtsDur::CCalcPtsDur() {
 	m_dTimeBase = 0.0;
@@ -124,9 +128,8 @@ void CLXCodecThread::open(QString strFile, QSize szPlay, LXPushStreamInfo stStre
 
 void CLXCodecThread::seek(const quint64& nDuration) {
 	if (m_pFormatCtx) {
-		// ʹ QMutexLocker ȷ̰߳ȫزƵƵԴ
-		QMutexLocker videoLocker(&m_videoMutex);
-		QMutexLocker audioLocker(&m_audioMutex);
+		// ⸴̵߳ av_read_frame , б̰߳ȫ
+		QMutexLocker demuxLocker(&m_demuxMutex);
 		// Ƶλ
 		if (m_pVideoThread) {
 			// λƵ
@@ -137,18 +140,8 @@ void CLXCodecThread::seek(const quint64& nDuration) {
 				// Ƶ̵߳ǰ PTS
 				m_pVideoThread->setCurrentPts(nDuration / av_q2d(m_pFormatCtx->streams[m_nVideoIndex]->time_base)); // NOLINT
 				// Ƶе
-				while (!m_videoPacketQueue.isEmpty()) {
-					AVPacket* pkt = m_videoPacketQueue.pop();
-					av_packet_unref(pkt);
-					av_packet_free(&pkt);
-				}
-				m_videoPacketQueue.clear();
-				while (!m_videoPushPacketQueue.isEmpty()) {
-					AVPacket* pkt = m_videoPushPacketQueue.pop();
-					av_packet_unref(pkt);
-					av_packet_free(&pkt);
-				}
-				m_videoPushPacketQueue.clear();
+				m_videoPacketQueue.clear(LXFreePacket);
+				m_videoPushPacketQueue.clear(LXFreePacket);
 			} else {
 				av_log(nullptr, AV_LOG_WARNING, "seek video fail, avformat_seek_file return %d\n", nRet);
 			}
@@ -162,36 +155,14 @@ void CLXCodecThread::seek(const quint64& nDuration) {
 				                              m_pFormatCtx->streams[m_nAudioIndex]->duration, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_FRAME);
 				if (nRet >= 0) {
 					m_pAudioThread->setCurrentPts(nDuration / av_q2d(m_pFormatCtx->streams[m_nAudioIndex]->time_base)); // NOLINT
-					while (!m_audioPacketQueue.isEmpty()) {
-						AVPacket* pkt = m_audioPacketQueue.pop();
-						av_packet_unref(pkt);
-						av_packet_free(&pkt);
-					}
-					m_audioPacketQueue.clear();
-					while (!m_audioPushPacketQueue.isEmpty()) {
-						AVPacket* pkt = m_audioPushPacketQueue.pop();
-						av_packet_unref(pkt);
-						av_packet_free(&pkt);
-					}
-					m_audioPushPacketQueue.clear();
+					m_audioPacketQueue.clear(LXFreePacket);
+					m_audioPushPacketQueue.clear(LXFreePacket);
 				} else {
 					av_log(nullptr, AV_LOG_WARNING, "seek audio fail, avformat_seek_file return %d\n", nRet);
 				}
 			} else if (m_pEncodeMuteThread) {
-				//while (!m_audioPacketQueue.isEmpty())
-				//{
-				//    AVPacket* pkt = m_audioPacketQueue.pop();
-				//    av_packet_unref(pkt);
-				//    av_packet_free(&pkt);
-				//}
-				//m_audioPacketQueue.clear();
-				//while (!m_audioPushPacketQueue.isEmpty())
-				//{
-				//    AVPacket* pkt = m_audioPushPacketQueue.pop();
-				//    av_packet_unref(pkt);
-				//    av_packet_free(&pkt);
-				//}
-				//m_audioPushPacketQueue.clear();
+				//m_audioPacketQueue.clear(LXFreePacket);
+				//m_audioPushPacketQueue.clear(LXFreePacket);
 			}
 		}
 	}
@@ -213,11 +184,12 @@ void CLXCodecThread::pause() {
 void CLXCodecThread::resume() {
 	// ִ̼߳
 	m_bRunning = true;
-	// ̲߳ͣ
-	m_bPause = false;
-	// Ƶ̺߳Ƶ̣߳ʹͣ״̬лָ
-	m_audioWaitCondition.wakeOne();
-	m_videoWaitCondition.wakeOne();
+	// ̲߳ͣͣеĽ⸴߳
+	{
+		QMutexLocker locker(&m_pauseMutex);
+		m_bPause = false;
+		m_pauseWaitCondition.wakeAll();
+	}
 	// ̴߳ڣ̵ִָ߳
 	if (m_pAudioThread) {
 		m_pAudioThread->resume();
@@ -233,8 +205,10 @@ void CLXCodecThread::resume() {
 void CLXCodecThread::stop() {
 	m_bLoop = false;
 	m_bRunning = false;
-	m_videoWaitCondition.wakeAll();
-	m_audioWaitCondition.wakeAll();
+	// ϵĽ⸴߳
+	m_videoPacketQueue.abort();
+	m_audioPacketQueue.abort();
+	m_pauseWaitCondition.wakeAll();
 	m_AVSyncWaitCondition.wakeAll();
 	wait();
 }
@@ -242,6 +216,11 @@ void CLXCodecThread::stop() {
 void CLXCodecThread::run() {
 	int nRet = -1;
 	char errBuf[ERRBUF_SIZE]{};
+	// һ stop ʱ abort
+	m_videoPacketQueue.reopen();
+	m_audioPacketQueue.reopen();
+	m_videoPushPacketQueue.reopen();
+	m_audioPushPacketQueue.reopen();
 	//ƵƵ
 	nRet = avformat_open_input(&m_pFormatCtx, m_strFile.toStdString().c_str(), nullptr, nullptr);
 	if (nRet < 0) {
@@ -260,7 +239,7 @@ void CLXCodecThread::run() {
 	m_nVideoIndex = av_find_best_stream(m_pFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
 	m_nAudioIndex = av_find_best_stream(m_pFormatCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
 	if (-1 == m_nVideoIndex && -1 == m_nAudioIndex) {
-		av_log(nullptr, AV_LOG_ERROR, "Can't find video and audio stream, %s\n");
+		av_log(nullptr, AV_LOG_ERROR, "Can't find video and audio stream\n");
 		avformat_close_input(&m_pFormatCtx);
 		return;
 	}
@@ -556,7 +535,6 @@ void CLXCodecThread::run() {
 
 		// ߳
 		m_pPushThread = new CLXPushThread(pOutputFormatCtx, m_videoPushPacketQueue, m_audioPushPacketQueue,
-		                                  m_pushVideoWaitCondition, m_pushVideoMutex, m_pushAudioWaitCondition, m_pushAudioMutex,
 		                                  LXPushStreamInfo::Video & m_stPushStreamInfo.eStream, LXPushStreamInfo::Audio & m_stPushStreamInfo.eStream);
 		m_pPushThread->start();
 	}
@@ -568,8 +546,7 @@ void CLXCodecThread::run() {
 		QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairVideoFormat;
 		pairVideoFormat = qMakePair(pairPushFormat.first, std::make_tuple(std::get<0>(pairPushFormat.second), std::get<1>(pairPushFormat.second)));
 		// Ƶ߳
-		m_pVideoThread = new CLXVideoThread(m_videoPacketQueue, m_videoPushPacketQueue, m_videoWaitCondition,
-		                                    m_videoMutex, m_pushVideoWaitCondition, m_pushVideoMutex, m_pFormatCtx, m_nVideoIndex, nVideoEncodeIndex,
+		m_pVideoThread = new CLXVideoThread(m_videoPacketQueue, m_videoPushPacketQueue, m_pFormatCtx, m_nVideoIndex, nVideoEncodeIndex,
 		                                    pairVideoFormat,
 		                                    m_eMode, m_nAudioIndex < 0, LXPushStreamInfo::Video & m_stPushStreamInfo.eStream, m_szPlay,
 		                                    m_eDecodeMode);
@@ -588,8 +565,8 @@ void CLXCodecThread::run() {
 			// һƵԪ
 			auto pairEncodeCtx = std::make_tuple(std::get<0>(pairPushFormat.second), std::get<2>(pairPushFormat.second));
 			// Ƶ߳
-			m_pEncodeMuteThread = new CLXEncodeMuteAudioThread(m_audioPacketQueue, m_audioWaitCondition, m_audioMutex, m_AVSyncWaitCondition,
-			                                                   m_AVSyncMutex, nAudioEncodeIndex, pairEncodeCtx);
+			m_pEncodeMuteThread = new CLXEncodeMuteAudioThread(m_audioPacketQueue, m_AVSyncWaitCondition, m_AVSyncMutex, nAudioEncodeIndex,
+			                                                   pairEncodeCtx);
 			m_pEncodeMuteThread->start();
 			// ͸ʽƵлȡAACprofile
 			avcodec_parameters_from_context(&decodePara, std::get<2>(pairPushFormat.second));
@@ -600,8 +577,8 @@ void CLXCodecThread::run() {
 		QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairAudioFormat;
 		pairAudioFormat = qMakePair(pairPushFormat.first, std::make_tuple(std::get<0>(pairPushFormat.second), std::get<2>(pairPushFormat.second)));
 		// Ƶ߳
-		m_pAudioThread = new CLXAudioThread(m_audioPacketQueue, m_audioPushPacketQueue, m_audioWaitCondition, m_audioMutex, m_pushAudioWaitCondition,
-		                                    m_pushAudioMutex, m_pFormatCtx, m_nAudioIndex, nAudioEncodeIndex, pairAudioFormat, m_eMode,
+		m_pAudioThread = new CLXAudioThread(m_audioPacketQueue, m_audioPushPacketQueue, m_pFormatCtx, m_nAudioIndex, nAudioEncodeIndex,
+		                                    pairAudioFormat, m_eMode,
 		                                    LXPushStreamInfo::Audio & m_stPushStreamInfo.eStream, decodePara);
 		connect(m_pAudioThread, &CLXAudioThread::notifyAudio, this, &CLXCodecThread::notifyAudio);
 		connect(m_pAudioThread, &CLXAudioThread::notifyCountDown, this, &CLXCodecThread::notifyCountDown);
@@ -620,56 +597,49 @@ void CLXCodecThread::run() {
 
 	//ȡݰ
 Loop:
-	while (m_bRunning && av_read_frame(m_pFormatCtx, packet) >= 0) {
-		// ͣ״̬ȴ̻߳
+	while (m_bRunning) {
+		// ͣ״̬ȴָʱ¼״̬
 		if (m_bPause) {
-			if (m_nVideoIndex >= 0) {
-				QMutexLocker videoLocker(&m_videoMutex);
-				m_videoWaitCondition.wait(&m_videoMutex);
-			} else if (m_nAudioIndex >= 0) {
-				QMutexLocker audioLocker(&m_audioMutex);
-				m_audioWaitCondition.wait(&m_audioMutex);
+			QMutexLocker locker(&m_pauseMutex);
+			if (m_bPause && m_bRunning) {
+				m_pauseWaitCondition.wait(&m_pauseMutex, LX_QUEUE_WAIT_MS);
 			}
-			av_packet_unref(packet);
 			continue;
 		}
+		m_demuxMutex.lock();
+		nRet = av_read_frame(m_pFormatCtx, packet);
+		m_demuxMutex.unlock();
+		if (nRet < 0) {
+			break;
+		}
 		// ǰݰƵ
 		if (m_nVideoIndex == packet->stream_index) {
-			// ͼģʽѭ¡ݰ͵ƵУ߳
+			// ͼģʽѭ¡ݰ͵ƵУʱ
 			if (m_bPicture) {
 				while (m_bRunning) {
 					AVPacket* pkt = av_packet_clone(packet);
-					QMutexLocker locker(&m_videoMutex);
-					if (m_videoPacketQueue.isFull()) {
-						m_videoWaitCondition.wait(&m_videoMutex);
+					if (pkt && m_videoPacketQueue.push(pkt) != UVQUEUE_OK) {
+						av_packet_free(&pkt);
 					}
-					m_videoPacketQueue.push(pkt);
-					m_videoWaitCondition.wakeOne();
 					m_AVSyncWaitCondition.wakeOne();
 				}
 			}
-			// 򽫿¡ݰ͵ƵУ߳
+			// 򽫿¡ݰ͵ƵУѾ߳
 			else {
 				AVPacket* pkt = av_packet_clone(packet);
-				QMutexLocker locker(&m_videoMutex);
-				if (m_videoPacketQueue.isFull()) {
-					m_videoWaitCondition.wait(&m_videoMutex);
+				if (pkt && m_videoPacketQueue.push(pkt) != UVQUEUE_OK) {
+					av_packet_free(&pkt);
 				}
-				m_videoPacketQueue.push(pkt);
 				m_AVSyncWaitCondition.wakeOne();
-				m_videoWaitCondition.wakeOne();
 			}
 		}
 		// ǰݰƵ
 		else if (m_nAudioIndex == packet->stream_index) {
-			// ¡ݰ͵ƵУ߳
+			// ¡ݰ͵Ƶ
 			AVPacket* pkt = av_packet_clone(packet);
-			QMutexLocker locker(&m_audioMutex);
-			if (m_audioPacketQueue.isFull()) {
-				m_audioWaitCondition.wait(&m_audioMutex);
+			if (pkt && m_audioPacketQueue.push(pkt) != UVQUEUE_OK) {
+				av_packet_free(&pkt);
 			}
-			m_audioPacketQueue.push(pkt);
-			m_audioWaitCondition.wakeOne();
 		}
 		// ͷŵǰݰ
 		av_packet_unref(packet);
@@ -720,19 +690,20 @@ void CLXCodecThread::LogCallBack(void* avcl, int level, const char* fmt, va_list
 }
 
 void CLXCodecThread::clearMemory() {
+	//  abort жУ push/pop ϵ߳
+	m_videoPacketQueue.abort();
+	m_audioPacketQueue.abort();
+	m_videoPushPacketQueue.abort();
+	m_audioPushPacketQueue.abort();
 	if (m_pPushThread) {
-		m_pushVideoWaitCondition.wakeAll();
-		m_pushAudioWaitCondition.wakeAll();
 		m_pPushThread->stop();
 		SAFE_DELETE(m_pPushThread);
 	}
 	if (m_pVideoThread) {
-		m_videoWaitCondition.wakeAll();
 		m_pVideoThread->stop();
 		SAFE_DELETE(m_pVideoThread);
 	}
 	if (m_pAudioThread) {
-		m_audioWaitCondition.wakeAll();
 		m_pAudioThread->stop();
 		SAFE_DELETE(m_pAudioThread);
 	}
@@ -741,43 +712,20 @@ void CLXCodecThread::clearMemory() {
 		m_pEncodeMuteThread->stop();
 		SAFE_DELETE(m_pEncodeMuteThread);
 	}
-	while (!m_videoPacketQueue.isEmpty()) {
-		AVPacket* pkt = m_videoPacketQueue.pop();
-		av_packet_unref(pkt);
-		av_packet_free(&pkt);
-	}
-	m_videoPacketQueue.clear();
-	while (!m_audioPacketQueue.isEmpty()) {
-		AVPacket* pkt = m_audioPacketQueue.pop();
-		av_packet_unref(pkt);
-		av_packet_free(&pkt);
-	}
-	m_audioPacketQueue.clear();
-	while (!m_videoPushPacketQueue.isEmpty()) {
-		AVPacket* pkt = m_videoPushPacketQueue.pop();
-		av_packet_unref(pkt);
-		av_packet_free(&pkt);
-	}
-	m_videoPushPacketQueue.clear();
-	while (!m_audioPushPacketQueue.isEmpty()) {
-		AVPacket* pkt = m_audioPushPacketQueue.pop();
-		av_packet_unref(pkt);
-		av_packet_free(&pkt);
-	}
-	m_audioPushPacketQueue.clear();
+	m_videoPacketQueue.clear(LXFreePacket);
+	m_audioPacketQueue.clear(LXFreePacket);
+	m_videoPushPacketQueue.clear(LXFreePacket);
+	m_audioPushPacketQueue.clear(LXFreePacket);
 }
 
 //CLXVideoThread
-CLXVideoThread::CLXVideoThread(CircularQueue<AVPacket*>& packetQueue, CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& waitCondition,
-                               QMutex& mutex,
-                               QWaitCondition& videoWaitCondition, QMutex& videoMutex, AVFormatContext* pFormatCtx,
+CLXVideoThread::CLXVideoThread(CLXPacketQueue& packetQueue, CLXPacketQueue& pushPacketQueue, AVFormatContext* pFormatCtx,
                                int nStreamIndex, int nEncodeStreamIndex,
                                QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairOutputCtx, CLXCodecThread::OpenMode eMode,
                                bool bSendCountDown, bool bPush, QSize szPlay, CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent)
 : QThread(parent), m_pFormatCtx(pFormatCtx), m_szPlay(szPlay), m_pairOutputCtx(std::move(pairOutputCtx)), m_nStreamIndex(nStreamIndex),
   m_nEncodeStreamIndex(nEncodeStreamIndex), m_bSendCountDown(bSendCountDown), m_bPush(bPush), m_packetQueue(packetQueue),
-  m_pushPacketQueue(pushPacketQueue), m_decodeWaitCondition(waitCondition), m_decodeMutex(mutex), m_pushWaitCondition(videoWaitCondition),
-  m_pushMutex(videoMutex), m_eMode(eMode), m_eDecodeMode(eDecodeMode) {
+  m_pushPacketQueue(pushPacketQueue), m_eMode(eMode), m_eDecodeMode(eDecodeMode) {
 }
 
 CLXVideoThread::~CLXVideoThread() {
@@ -785,10 +733,7 @@ CLXVideoThread::~CLXVideoThread() {
 }
 
 void CLXVideoThread::pause() {
-	QMutexLocker locker(&m_decodeMutex);
 	m_bPause = true;
-	m_encodeWaitCondition.wakeAll();
-	m_playWaitCondition.wakeAll();
 	if (m_pEncodeThread) {
 		m_pEncodeThread->pause();
 	}
@@ -798,7 +743,6 @@ void CLXVideoThread::pause() {
 }
 
 void CLXVideoThread::resume() {
-	QMutexLocker locker(&m_decodeMutex);
 	m_bPause = false;
 	if (m_pEncodeThread) {
 		m_pEncodeThread->resume();
@@ -810,53 +754,30 @@ void CLXVideoThread::resume() {
 
 void CLXVideoThread::stop() {
 	m_bRunning = false;
-	// ߳
-	m_encodeWaitCondition.wakeAll();
-	m_playWaitCondition.wakeAll();
+	// ֡ϵ߳
+	m_decodeFrameQueue.abort();
+	m_playFrameQueue.abort();
 	if (m_pEncodeThread) {
-		m_encodeWaitCondition.wakeAll();
 		m_pEncodeThread->stop();
 		SAFE_DELETE(m_pEncodeThread);
 	}
 	if (m_pPlayThread) {
-		m_playWaitCondition.wakeAll();
 		m_pPlayThread->stop();
 		SAFE_DELETE(m_pPlayThread);
 	}
 	// ȴִ߳
 	wait();
-	while (!m_decodeFrameQueue.isEmpty()) {
-		AVFrame* frame = m_decodeFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_decodeFrameQueue.clear();
-	while (!m_playFrameQueue.isEmpty()) {
-		AVFrame* frame = m_playFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_playFrameQueue.clear();
+	m_decodeFrameQueue.clear(LXFreeFrame);
+	m_playFrameQueue.clear(LXFreeFrame);
 }
 
 void CLXVideoThread::setCurrentPts(int64_t nPts) {
-	// õǰŵʱ
-	if (m_pPlayThread) {
-		m_pPlayThread->setCurrentPts(nPts);
-	}
+	// ֻڽ߳ˢ£ֻ
+	m_nFlushPts = nPts;
+	m_bFlush = true;
 	// ͲŵƵ֡
-	while (!m_decodeFrameQueue.isEmpty()) {
-		AVFrame* frame = m_decodeFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_decodeFrameQueue.clear();
-	while (!m_playFrameQueue.isEmpty()) {
-		AVFrame* frame = m_playFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_playFrameQueue.clear();
+	m_decodeFrameQueue.clear(LXFreeFrame);
+	m_playFrameQueue.clear(LXFreeFrame);
 }
 
 enum AVPixelFormat CLXVideoThread::hw_pix_fmt = AV_PIX_FMT_NONE;
@@ -927,6 +848,10 @@ void CLXVideoThread::run() {
 	} else {
 		codec();
 	}
+	// CPU : ֱдػĶڴ
+	if (!hw_device_ctx) {
+		m_decodePool.install(m_pCodecCtx, pVideoCodec);
+	}
 	// 򿪽 m_pCodecCtxĹ
 	nRet = avcodec_open2(m_pCodecCtx, pVideoCodec, nullptr);
 	if (nRet < 0) {
@@ -938,110 +863,94 @@ void CLXVideoThread::run() {
 	AVFrame* pFrame = nullptr;
 	//  pFrame ṹ
 	pFrame = av_frame_alloc();
+	m_decodeFrameQueue.reopen();
+	m_playFrameQueue.reopen();
 	// Ҫ
 	if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
 		QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx = qMakePair(m_pCodecCtx, m_pairOutputCtx.second);
 		// ̣߳ڽ֡͵ݰ
-		m_pEncodeThread = new CLXEncodeVideoThread(m_decodeFrameQueue, m_pushPacketQueue, m_encodeWaitCondition, m_encodeMutex,
-		                                           m_pushWaitCondition, m_pushMutex, m_nEncodeStreamIndex, pairEncodeCtx, m_eDecodeMode);
+		m_pEncodeThread = new CLXEncodeVideoThread(m_decodeFrameQueue, m_pushPacketQueue, m_nEncodeStreamIndex, pairEncodeCtx, m_eDecodeMode);
 		m_pEncodeThread->start();
 	}
 	// ǲģʽ
 	if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
 		// ̣߳߳ڽ֡вŻʾ
-		m_pPlayThread = new CLXVideoPlayThread(m_playFrameQueue, m_playWaitCondition, m_playMutex, m_pCodecCtx,
-		                                       m_pFormatCtx->streams[m_nStreamIndex]->time_base, m_bSendCountDown, this, m_szPlay, m_eDecodeMode);
+		m_pPlayThread = new CLXVideoPlayThread(m_playFrameQueue, m_pCodecCtx, m_pFormatCtx->streams[m_nStreamIndex]->time_base, m_bSendCountDown,
+		                                       this, m_szPlay, m_eDecodeMode);
 		m_pPlayThread->start();
 	}
+	// ֡¡һݷУʱʧʱͷ
+	auto pushFrame = [](CLXFrameQueue& queue, const AVFrame* frame) {
+		if (AVFrame* pCopyFrame = av_frame_clone(frame)) {
+			if (queue.push(pCopyFrame) != UVQUEUE_OK) {
+				av_frame_free(&pCopyFrame);
+			}
+		}
+	};
 	// sw_frame 洢 GPU  CPU 
 	AVFrame* sw_frame = av_frame_alloc();
 	// tmp_frame  GPU ʱжǷҪת
 	AVFrame* tmp_frame = nullptr;
 	while (m_bRunning) {
 		if (m_bPause) {
+			QThread::msleep(LX_PAUSE_WAIT_MS);
 			continue;
 		}
-		// ¼ǰʱ䣬ͳƽʱ
-		QElapsedTimer ti;
-		ti.start();
-		// ʹûԽصĲб
-		m_decodeMutex.lock();
-		// Ϊգѵȴȴµݰ
-		if (m_packetQueue.isEmpty()) {
-			m_decodeWaitCondition.wakeOne();
-			m_decodeWaitCondition.wait(&m_decodeMutex);
-		}
-		// ӽȡһݰ
-		AVPacket* packet = m_packetQueue.pop();
-		if (Q_LIKELY(packet)) {
-			// ݰ
-			nRet = avcodec_send_packet(m_pCodecCtx, packet);
-			if (nRet < 0) {
-				av_strerror(nRet, errBuf, ERRBUF_SIZE);
-				av_log(nullptr, AV_LOG_ERROR, "Can't send video packet, %s\n", errBuf);
-				av_packet_unref(packet);
-				av_packet_free(&packet);
-				m_decodeMutex.unlock();
-				continue;
+		// seek ֮ˢ½ɵ֡
+		if (m_bFlush.exchange(false)) {
+			avcodec_flush_buffers(m_pCodecCtx);
+			m_decodeFrameQueue.clear(LXFreeFrame);
+			m_playFrameQueue.clear(LXFreeFrame);
+			if (m_pPlayThread) {
+				m_pPlayThread->setCurrentPts(m_nFlushPts);
 			}
-			// ͨ avcodec_receive_frame ѭȡƵ֡
-			while (avcodec_receive_frame(m_pCodecCtx, pFrame) >= 0) {
-				// ֡ʽ GPU ķʽԽݴ GPU תƵ CPU
-				if (pFrame->format == hw_pix_fmt) {
-					/* retrieve data from GPU to CPU */
-					if (av_hwframe_transfer_data(sw_frame, pFrame, 0) < 0) {
-						av_strerror(nRet, errBuf, ERRBUF_SIZE);
-						av_log(nullptr, AV_LOG_ERROR, "Error transferring the data to system memory, %s\n", errBuf);
-						av_packet_unref(packet);
-						av_packet_free(&packet);
-						m_decodeMutex.unlock();
-						continue;
-					}
-					//  tmp_frame ָ sw_frame
-					tmp_frame = sw_frame;
-					tmp_frame->pts = pFrame->pts;
-					tmp_frame->pkt_dts = pFrame->pkt_dts;
+		}
+		// ӽȡһݰʱ¼״̬
+		AVPacket* packet = nullptr;
+		if (m_packetQueue.pop(&packet, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+			continue;
+		}
+		// ݰ
+		nRet = avcodec_send_packet(m_pCodecCtx, packet);
+		av_packet_free(&packet);
+		if (nRet < 0) {
+			av_strerror(nRet, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_ERROR, "Can't send video packet, %s\n", errBuf);
+			continue;
+		}
+		// ͨ avcodec_receive_frame ѭȡƵ֡
+		while (avcodec_receive_frame(m_pCodecCtx, pFrame) >= 0) {
+			// ֡ʽ GPU ķʽԽݴ GPU תƵ CPU
+			if (pFrame->format == hw_pix_fmt) {
+				/* retrieve data from GPU to CPU */
+				nRet = av_hwframe_transfer_data(sw_frame, pFrame, 0);
+				if (nRet < 0) {
+					av_strerror(nRet, errBuf, ERRBUF_SIZE);
+					av_log(nullptr, AV_LOG_ERROR, "Error transferring the data to system memory, %s\n", errBuf);
+					av_frame_unref(pFrame);
+					continue;
 				}
 				//  tmp_frame ָ sw_frame
-				else
-					tmp_frame = pFrame;
-
-				// жǷ
-				if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
-					// ʹû m_encodeMutex Ͷнб
-					// ڶʱȴ
-					m_encodeMutex.lock();
-					if (m_decodeFrameQueue.isFull()) {
-						m_encodeWaitCondition.wait(&m_encodeMutex);
-					}
-					if (AVFrame* pCopyFrame = av_frame_clone(tmp_frame)) {
-						m_decodeFrameQueue.push(pCopyFrame);
-						m_encodeWaitCondition.wakeOne();
-					}
-					m_encodeMutex.unlock();
-				}
-				// жǷ񲥷
-				if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
-					// ʹû m_playMutex Ͷнб
-					// ڶʱȴ
-					m_playMutex.lock();
-					if (m_playFrameQueue.isFull()) {
-						m_playWaitCondition.wait(&m_playMutex);
-					}
-					if (AVFrame* pCopyFrame = av_frame_clone(tmp_frame)) {
-						m_playFrameQueue.push(pCopyFrame);
-						m_playWaitCondition.wakeOne();
-					}
-					m_playMutex.unlock();
-				}
+				tmp_frame = sw_frame;
+				tmp_frame->pts = pFrame->pts;
+				tmp_frame->pkt_dts = pFrame->pkt_dts;
 			}
-			// ͷŽʹõԴݰ֡
-			av_packet_unref(packet);
-			av_packet_free(&packet);
+			//  tmp_frame ָ sw_frame
+			else
+				tmp_frame = pFrame;
+
+			// жǷ
+			if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
+				pushFrame(m_decodeFrameQueue, tmp_frame);
+			}
+			// жǷ񲥷
+			if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
+				pushFrame(m_playFrameQueue, tmp_frame);
+			}
+			// ͷŽ֡
+			av_frame_unref(sw_frame);
 			av_frame_unref(pFrame);
 		}
-		// 뻥
-		m_decodeMutex.unlock();
 	}
 	// ͷͨ av_frame_alloc Ľ֡ṹ pFrame
 	av_frame_free(&pFrame);
@@ -1055,17 +964,16 @@ void CLXVideoThread::run() {
 	avcodec_close(m_pCodecCtx);
 	// ͷŽ
 	avcodec_free_context(&m_pCodecCtx);
+	m_decodePool.reset();
 }
 
 //CLXAudioThread
-CLXAudioThread::CLXAudioThread(CircularQueue<AVPacket*>& packetQueue, CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& waitCondition,
-                               QMutex& mutex, QWaitCondition& audioWaitCondition, QMutex& audioMutex, AVFormatContext* pFormatCtx,
+CLXAudioThread::CLXAudioThread(CLXPacketQueue& packetQueue, CLXPacketQueue& pushPacketQueue, AVFormatContext* pFormatCtx,
                                int nStreamIndex, int nEncodeStreamIndex,
                                QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairOutputCtx, CLXCodecThread::OpenMode eMode,
                                bool bPush, const AVCodecParameters& decodePara, QObject* parent)
 : QThread(parent), m_pFormatCtx(pFormatCtx), m_decodePara(decodePara), m_pairOutputCtx(std::move(pairOutputCtx)), m_nStreamIndex(nStreamIndex),
-  m_nEncodeStreamIndex(nEncodeStreamIndex), m_bPush(bPush), m_packetQueue(packetQueue), m_pushPacketQueue(pushPacketQueue),
-  m_decodeWaitCondition(waitCondition), m_decodeMutex(mutex), m_pushWaitCondition(audioWaitCondition), m_pushMutex(audioMutex), m_eMode(eMode) {
+  m_nEncodeStreamIndex(nEncodeStreamIndex), m_bPush(bPush), m_packetQueue(packetQueue), m_pushPacketQueue(pushPacketQueue), m_eMode(eMode) {
 }
 
 CLXAudioThread::~CLXAudioThread() {
@@ -1073,9 +981,6 @@ CLXAudioThread::~CLXAudioThread() {
 }
 
 void CLXAudioThread::pause() {
-	QMutexLocker locker(&m_decodeMutex);
-	m_encodeWaitCondition.wakeAll();
-	m_playWaitCondition.wakeAll();
 	if (m_pEncodeThread) {
 		m_pEncodeThread->pause();
 	}
@@ -1086,7 +991,6 @@ void CLXAudioThread::pause() {
 }
 
 void CLXAudioThread::resume() {
-	QMutexLocker locker(&m_decodeMutex);
 	m_bPause = false;
 	if (m_pEncodeThread) {
 		m_pEncodeThread->resume();
@@ -1098,49 +1002,26 @@ void CLXAudioThread::resume() {
 
 void CLXAudioThread::stop() {
 	m_bRunning = false;
-	m_encodeWaitCondition.wakeAll();
-	m_playWaitCondition.wakeAll();
+	m_decodeFrameQueue.abort();
+	m_playFrameQueue.abort();
 	if (m_pEncodeThread) {
-		m_encodeWaitCondition.wakeAll();
 		m_pEncodeThread->stop();
 		SAFE_DELETE(m_pEncodeThread);
 	}
 	if (m_pPlayThread) {
-		m_playWaitCondition.wakeAll();
 		m_pPlayThread->stop();
 		SAFE_DELETE(m_pPlayThread);
 	}
 	wait();
-	while (!m_decodeFrameQueue.isEmpty()) {
-		AVFrame* frame = m_decodeFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_decodeFrameQueue.clear();
-	while (!m_playFrameQueue.isEmpty()) {
-		AVFrame* frame = m_playFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_playFrameQueue.clear();
+	m_decodeFrameQueue.clear(LXFreeFrame);
+	m_playFrameQueue.clear(LXFreeFrame);
 }
 
 void CLXAudioThread::setCurrentPts(int64_t nPts) {
-	if (m_pPlayThread) {
-		m_pPlayThread->setCurrentPts(nPts);
-	}
-	while (!m_decodeFrameQueue.isEmpty()) {
-		AVFrame* frame = m_decodeFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_decodeFrameQueue.clear();
-	while (!m_playFrameQueue.isEmpty()) {
-		AVFrame* frame = m_playFrameQueue.pop();
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	}
-	m_playFrameQueue.clear();
+	m_nFlushPts = nPts;
+	m_bFlush = true;
+	m_decodeFrameQueue.clear(LXFreeFrame);
+	m_playFrameQueue.clear(LXFreeFrame);
 }
 
 void CLXAudioThread::run() {
@@ -1169,77 +1050,68 @@ void CLXAudioThread::run() {
 	}
 	// Ƶ֪ͨ
 	emit notifyAudioPara(m_pCodecCtx->sample_rate, m_pCodecCtx->channels);
+	m_decodeFrameQueue.reopen();
+	m_playFrameQueue.reopen();
 	// жΪͻǲţҴӦ߳
 	if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
 		QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx = qMakePair(m_pCodecCtx, m_pairOutputCtx.second);
-		m_pEncodeThread = new CLXEncodeAudioThread(m_decodeFrameQueue, m_pushPacketQueue, m_encodeWaitCondition, m_encodeMutex,
-		                                           m_pushWaitCondition, m_pushMutex, m_nEncodeStreamIndex, pairEncodeCtx);
+		m_pEncodeThread = new CLXEncodeAudioThread(m_decodeFrameQueue, m_pushPacketQueue, m_nEncodeStreamIndex, pairEncodeCtx);
 
 		m_pEncodeThread->start();
 	}
 	if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
-		m_pPlayThread = new CLXAudioPlayThread(m_playFrameQueue, m_playWaitCondition, m_playMutex, m_pCodecCtx,
+		m_pPlayThread = new CLXAudioPlayThread(m_playFrameQueue, m_pCodecCtx,
 		                                       m_nStreamIndex >= 0 ? m_pFormatCtx->streams[m_nStreamIndex]->time_base : m_pCodecCtx->time_base, this);
 		m_pPlayThread->start();
 	}
+	auto pushFrame = [](CLXFrameQueue& queue, const AVFrame* frame) {
+		if (AVFrame* pCopyFrame = av_frame_clone(frame)) {
+			if (queue.push(pCopyFrame) != UVQUEUE_OK) {
+				av_frame_free(&pCopyFrame);
+			}
+		}
+	};
 
 	AVFrame* pFrame = nullptr;
 	pFrame = av_frame_alloc();
 	while (m_bRunning) {
 		if (m_bPause) {
+			QThread::msleep(LX_PAUSE_WAIT_MS);
 			continue;
 		}
-		m_decodeMutex.lock();
-		// ƵΪգѲȴ
-		if (m_packetQueue.isEmpty()) {
-			m_decodeWaitCondition.wakeOne();
-			m_decodeWaitCondition.wait(&m_decodeMutex);
+		// seek ֮ˢ½
+		if (m_bFlush.exchange(false)) {
+			avcodec_flush_buffers(m_pCodecCtx);
+			m_decodeFrameQueue.clear(LXFreeFrame);
+			m_playFrameQueue.clear(LXFreeFrame);
+			if (m_pPlayThread) {
+				m_pPlayThread->setCurrentPts(m_nFlushPts);
+			}
 		}
-		// ƵлȡһƵ
-		AVPacket* packet = m_packetQueue.pop();
-		if (Q_LIKELY(packet)) {
-			// ͨ avcodec_send_packet Ƶн
-			nRet = avcodec_send_packet(m_pCodecCtx, packet);
-			if (nRet < 0) {
-				av_strerror(nRet, errBuf, ERRBUF_SIZE);
-				av_log(nullptr, AV_LOG_ERROR, "Can't send audio packet, %s\n", errBuf);
-				av_packet_unref(packet);
-				av_packet_free(&packet);
-				m_decodeMutex.unlock();
-				continue;
+		// ƵлȡһƵʱ¼״̬
+		AVPacket* packet = nullptr;
+		if (m_packetQueue.pop(&packet, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+			continue;
+		}
+		// ͨ avcodec_send_packet Ƶн
+		nRet = avcodec_send_packet(m_pCodecCtx, packet);
+		av_packet_free(&packet);
+		if (nRet < 0) {
+			av_strerror(nRet, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_ERROR, "Can't send audio packet, %s\n", errBuf);
+			continue;
+		}
+		// սƵ֡
+		while (avcodec_receive_frame(m_pCodecCtx, pFrame) >= 0) {
+			// жͻǲģʽƵ֡ӦĶе
+			if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
+				pushFrame(m_decodeFrameQueue, pFrame);
 			}
-			// սƵ֡
-			while (avcodec_receive_frame(m_pCodecCtx, pFrame) >= 0) {
-				// жͻǲģʽƵ֡ӦĶе
-				if (CLXCodecThread::OpenMode::OpenMode_Push & m_eMode && m_bPush) {
-					m_encodeMutex.lock();
-					if (m_decodeFrameQueue.isFull()) {
-						m_encodeWaitCondition.wait(&m_encodeMutex);
-					}
-					if (AVFrame* pCopyFrame = av_frame_clone(pFrame)) {
-						m_decodeFrameQueue.push(pCopyFrame);
-						m_encodeWaitCondition.wakeOne();
-					}
-					m_encodeMutex.unlock();
-				}
-				if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
-					m_playMutex.lock();
-					if (m_playFrameQueue.isFull()) {
-						m_playWaitCondition.wait(&m_playMutex);
-					}
-					if (AVFrame* pCopyFrame = av_frame_clone(pFrame)) {
-						m_playFrameQueue.push(pCopyFrame);
-						m_playWaitCondition.wakeOne();
-					}
-					m_playMutex.unlock();
-				}
+			if (CLXCodecThread::OpenMode::OpenMode_Play & m_eMode) {
+				pushFrame(m_playFrameQueue, pFrame);
 			}
-			// ͷƵ֡
-			av_packet_unref(packet);
-			av_packet_free(&packet);
 			av_frame_unref(pFrame);
 		}
-		m_decodeMutex.unlock();
 	}
 	// ͷһƵ֡
 	av_frame_free(&pFrame);
@@ -1250,38 +1122,31 @@ void CLXAudioThread::run() {
 }
 
 //CLXVideoPlayThread
-CLXVideoPlayThread::CLXVideoPlayThread(CircularQueue<AVFrame*>& decodeFrameQueue, QWaitCondition& waitCondition, QMutex& mutex,
-                                       AVCodecContext* pCodecCtx, const AVRational& timeBase, bool bSendCountDown, CLXVideoThread* videoThread,
-                                       QSize szPlay,
-                                       CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent)
+CLXVideoPlayThread::CLXVideoPlayThread(CLXFrameQueue& decodeFrameQueue, AVCodecContext* pCodecCtx, const AVRational& timeBase, bool bSendCountDown,
+                                       CLXVideoThread* videoThread, QSize szPlay, CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent)
 : QThread(parent), m_pCodecCtx(pCodecCtx), m_bSendCountDown(bSendCountDown), m_timeBase(timeBase), m_videoThread(videoThread),
-  m_playFrameQueue(decodeFrameQueue), m_playWaitCondition(waitCondition), m_playMutex(mutex), m_szPlay(szPlay), m_eDecodeMode(eDecodeMode) {
+  m_playFrameQueue(decodeFrameQueue), m_szPlay(szPlay), m_eDecodeMode(eDecodeMode) {
 }
 
 CLXVideoPlayThread::~CLXVideoPlayThread() = default;
 
 void CLXVideoPlayThread::pause() {
-	QMutexLocker locker(&m_playMutex);
 	m_bPause = true;
 }
 
 void CLXVideoPlayThread::resume() {
-	QMutexLocker locker(&m_playMutex);
 	m_bPause = false;
 	m_nLastTime = av_gettime();
 }
 
 void CLXVideoPlayThread::stop() {
 	m_bRunning = false;
-	m_playWaitCondition.wakeOne();
 	wait();
 }
 
+//  CLXVideoThread ڽ߳ˢ
 void CLXVideoPlayThread::setCurrentPts(int64_t nPts) {
-	if (m_pCodecCtx) {
-		avcodec_flush_buffers(m_pCodecCtx);
-		m_nLastPts = nPts;
-	}
+	m_nLastPts = nPts;
 }
 
 void CLXVideoPlayThread::run() {
@@ -1296,67 +1161,59 @@ void CLXVideoPlayThread::run() {
 #else
 	enum AVPixelFormat srcFormat = m_eDecodeMode == CLXCodecThread::eLXDecodeMode::eLXDecodeMode_CPU ? m_pCodecCtx->pix_fmt : AV_PIX_FMT_NV12;
 #endif
-	struct SwsContext* img_decode_convert_ctx = sws_getContext(m_pCodecCtx->width, m_pCodecCtx->height, srcFormat, m_szPlay.width(),
-	                                                           m_szPlay.height(), AV_PIX_FMT_RGB32, SWS_BICUBIC, nullptr, nullptr, nullptr);
+	// 4K/8K Դˮƽ߳ת, ߳߶Ⱦ
+	CUVSwsConverter img_decode_converter;
+	img_decode_converter.init(m_pCodecCtx->width, m_pCodecCtx->height, srcFormat, m_szPlay.width(), m_szPlay.height(), AV_PIX_FMT_RGB32,
+	                          SWS_BICUBIC, 0);
 	// ʼʱ
 	m_nLastTime = av_gettime();
 	m_nLastPts = 0;
 	// ѭƵ֡
 	while (m_bRunning) {
-		// ͣһѭ
+		// ͣȴһѭ
 		if (m_bPause) {
+			QThread::msleep(LX_PAUSE_WAIT_MS);
+			continue;
+		}
+		// Ӳ֡ȡһ֡ʱ¼״̬
+		AVFrame* pFrame = nullptr;
+		if (m_playFrameQueue.pop(&pFrame, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
 			continue;
 		}
-		// ʲŶ
-		m_playMutex.lock();
-		// ŶΪգѲȴ
-		if (m_playFrameQueue.isEmpty()) {
-			m_playWaitCondition.wakeOne();
-			m_playWaitCondition.wait(&m_playMutex);
+		// ͵ʱ֪ͨ
+		if (m_bSendCountDown) {
+			int64_t nCurrentTimeStamp = pFrame->pts * av_q2d(m_timeBase); // NOLINT
+			emit m_videoThread->notifyCountDown(nCurrentTimeStamp);
 		}
-		// Ӳ֡ȡһ֡
-		AVFrame* pFrame = m_playFrameQueue.pop();
-		if (Q_LIKELY(pFrame)) {
-			// ͵ʱ֪ͨ
-			if (m_bSendCountDown) {
-				int64_t nCurrentTimeStamp = pFrame->pts * av_q2d(m_timeBase); // NOLINT
-				emit m_videoThread->notifyCountDown(nCurrentTimeStamp);
-			}
-			// ʱƫ
-			int64_t nTimeStampOffset = (pFrame->pts - m_nLastPts) * AV_TIME_BASE * av_q2d(m_timeBase); // NOLINT
-			// ֡תΪ RGB ʽ
-			int nH = sws_scale(img_decode_convert_ctx, pFrame->data, pFrame->linesize, 0, pFrame->height, pFrameRGB->data, // NOLINT
-			                   pFrameRGB->linesize);
+		// ʱƫ
+		int64_t nTimeStampOffset = (pFrame->pts - m_nLastPts) * AV_TIME_BASE * av_q2d(m_timeBase); // NOLINT
+		// ֡תΪ RGB ʽ
+		// NOTE: a failed conversion leaves the last image on screen, the timing below still advances
+		if (img_decode_converter.convert(pFrame, pFrameRGB->data, pFrameRGB->linesize) > 0) {
 			// QImageʾ
 			QImage tmpImg(static_cast<const uchar*>(pFrameRGB->data[0]), m_szPlay.width(), m_szPlay.height(), QImage::Format_RGB32);
 			tmpImg.detach();
 			// ȷ͸ CLXVideoThread CLXVideoThread ͸ CLXPlaybackWidget ֳ
 			emit m_videoThread->notifyImage(QPixmap::fromImage(tmpImg));
-			// ʱƫƲ
-			int64_t nTimeOffset = nTimeStampOffset - av_gettime() + m_nLastTime;
-			if (nTimeOffset > 0) {
-				av_usleep(nTimeOffset);
-			}
-			// ͷ֡
-			av_frame_unref(pFrame);
-			av_frame_free(&pFrame);
 		}
-		m_playMutex.unlock();
+		// ͷ֡
+		av_frame_free(&pFrame);
+		// ʱƫƲ
+		int64_t nTimeOffset = nTimeStampOffset - av_gettime() + m_nLastTime;
+		if (nTimeOffset > 0) {
+			av_usleep(nTimeOffset);
+		}
 	}
 	// ͷ RGB ͼݻ
 	av_freep(&pFrameRGB->data[0]);
 	// ͷ RGB ֡
 	av_frame_free(&pFrameRGB);
-	// ͷͼת
-	sws_freeContext(img_decode_convert_ctx);
 }
 
 //CLXAudioPlayThread
-CLXAudioPlayThread::CLXAudioPlayThread(CircularQueue<AVFrame*>& decodeFrameQueue, QWaitCondition& waitCondition,
-                                       QMutex& mutex, AVCodecContext* pCodecCtx, const AVRational& timeBase,
+CLXAudioPlayThread::CLXAudioPlayThread(CLXFrameQueue& decodeFrameQueue, AVCodecContext* pCodecCtx, const AVRational& timeBase,
                                        CLXAudioThread* audioThread, QObject* parent)
-: QThread(parent), m_pCodecCtx(pCodecCtx), m_timeBase(timeBase), m_audioThread(audioThread),
-  m_playFrameQueue(decodeFrameQueue), m_playWaitCondition(waitCondition), m_playMutex(mutex) {
+: QThread(parent), m_pCodecCtx(pCodecCtx), m_timeBase(timeBase), m_audioThread(audioThread), m_playFrameQueue(decodeFrameQueue) {
 }
 
 CLXAudioPlayThread::~CLXAudioPlayThread() {
@@ -1364,27 +1221,22 @@ CLXAudioPlayThread::~CLXAudioPlayThread() {
 }
 
 void CLXAudioPlayThread::pause() {
-	QMutexLocker locker(&m_playMutex);
 	m_bPause = true;
 }
 
 void CLXAudioPlayThread::resume() {
-	QMutexLocker locker(&m_playMutex);
 	m_nLastTime = av_gettime();
 	m_bPause = false;
 }
 
 void CLXAudioPlayThread::stop() {
 	m_bRunning = false;
-	m_playWaitCondition.wakeOne();
 	wait();
 }
 
+//  CLXAudioThread ڽ߳ˢ
 void CLXAudioPlayThread::setCurrentPts(int64_t nPts) {
-	if (m_pCodecCtx) {
-		avcodec_flush_buffers(m_pCodecCtx);
-		m_nLastPts = nPts;
-	}
+	m_nLastPts = nPts;
 }
 
 void CLXAudioPlayThread::run() {
@@ -1405,41 +1257,31 @@ void CLXAudioPlayThread::run() {
 	// ѭƵ֡
 	while (m_bRunning) {
 		if (m_bPause) {
+			QThread::msleep(LX_PAUSE_WAIT_MS);
 			continue;
 		}
-		// ʲ֡
-		m_playMutex.lock();
-		// ֡ΪգѲȴ
-		if (m_playFrameQueue.isEmpty()) {
-			m_playWaitCondition.wakeOne();
-			m_playWaitCondition.wait(&m_playMutex);
-		}
-		int64_t nTimeStampOffset = 0;
-		// ӲŶȡһ֡
-		AVFrame* pFrame = m_playFrameQueue.pop();
-		// ֡
-		if (Q_LIKELY(pFrame)) {
-			// ͵ʱ֪ͨ
-			int64_t nCurrentTimeStamp = pFrame->pts * av_q2d(m_timeBase); // NOLINT
-			emit m_audioThread->notifyCountDown(nCurrentTimeStamp);
-			// ʱƫ
-			nTimeStampOffset = (pFrame->pts - m_nLastPts) * AV_TIME_BASE * av_q2d(m_timeBase); // NOLINT
-			// ִƵת
-			swr_convert(audio_decode_swrCtx, &audio_decode_buffer, m_pCodecCtx->channels * m_pCodecCtx->sample_rate,
-			            const_cast<const uint8_t**>(pFrame->data), pFrame->nb_samples);
-			// ƵݴС
-			int out_audio_buffer_size = av_samples_get_buffer_size(nullptr, out_channel_nb, pFrame->nb_samples, AV_SAMPLE_FMT_S16, 1);
-			// ƵתΪ QByteArray ͸߳
-			QByteArray data(reinterpret_cast<const char*>(audio_decode_buffer), out_audio_buffer_size);
-			// ȷ͸ CLXCodecThread ̣߳ CLXCodecThread ̷߳͸ CLXPlaybackWidgetƵд m_audioByteBufferд m_pAudioDevice
-			//  m_pAudioDevice = m_pAudioOutput->start(); 
-			emit m_audioThread->notifyAudio(data);
-			// ͷ֡
-			av_frame_unref(pFrame);
-			av_frame_free(&pFrame);
+		// ӲŶȡһ֡ʱ¼״̬
+		AVFrame* pFrame = nullptr;
+		if (m_playFrameQueue.pop(&pFrame, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+			continue;
 		}
-		// 
-		m_playMutex.unlock();
+		// ͵ʱ֪ͨ
+		int64_t nCurrentTimeStamp = pFrame->pts * av_q2d(m_timeBase); // NOLINT
+		emit m_audioThread->notifyCountDown(nCurrentTimeStamp);
+		// ʱƫ
+		int64_t nTimeStampOffset = (pFrame->pts - m_nLastPts) * AV_TIME_BASE * av_q2d(m_timeBase); // NOLINT
+		// ִƵת
+		swr_convert(audio_decode_swrCtx, &audio_decode_buffer, m_pCodecCtx->channels * m_pCodecCtx->sample_rate,
+		            const_cast<const uint8_t**>(pFrame->data), pFrame->nb_samples);
+		// ƵݴС
+		int out_audio_buffer_size = av_samples_get_buffer_size(nullptr, out_channel_nb, pFrame->nb_samples, AV_SAMPLE_FMT_S16, 1);
+		// ƵתΪ QByteArray ͸߳
+		QByteArray data(reinterpret_cast<const char*>(audio_decode_buffer), out_audio_buffer_size);
+		// ȷ͸ CLXCodecThread ̣߳ CLXCodecThread ̷߳͸ CLXPlaybackWidgetƵд m_audioByteBufferд m_pAudioDevice
+		//  m_pAudioDevice = m_pAudioOutput->start(); 
+		emit m_audioThread->notifyAudio(data);
+		// ͷ֡
+		av_frame_free(&pFrame);
 		// ʱƫƲߣȷƵʱв
 		int64_t nTimeOffset = nTimeStampOffset - av_gettime() + m_nLastTime;
 		if (nTimeOffset > 0) {
@@ -1452,14 +1294,11 @@ void CLXAudioPlayThread::run() {
 	swr_free(&audio_decode_swrCtx);
 }
 
-CLXEncodeVideoThread::CLXEncodeVideoThread(CircularQueue<AVFrame*>& encodeFrameQueue, CircularQueue<AVPacket*>& pushPacketQueue,
-                                           QWaitCondition& encodeWaitCondition,
-                                           QMutex& encodeMutex, QWaitCondition& pushWaitCondition, QMutex& pushMutex, int nEncodeStreamIndex,
+CLXEncodeVideoThread::CLXEncodeVideoThread(CLXFrameQueue& encodeFrameQueue, CLXPacketQueue& pushPacketQueue, int nEncodeStreamIndex,
                                            QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx,
                                            CLXCodecThread::eLXDecodeMode eEncodeMode,
                                            QObject* parent)
 : QThread(parent), m_encodeFrameQueue(encodeFrameQueue), m_pushPacketQueue(pushPacketQueue), m_nEncodeStreamIndex(nEncodeStreamIndex),
-  m_encodeWaitCondition(encodeWaitCondition), m_encodeMutex(encodeMutex), m_pushWaitCondition(pushWaitCondition), m_pushMutex(pushMutex),
   m_pairEncodeCtx(std::move(pairEncodeCtx)), m_eEncodeMode(eEncodeMode) {
 }
 
@@ -1468,18 +1307,15 @@ CLXEncodeVideoThread::~CLXEncodeVideoThread() {
 }
 
 void CLXEncodeVideoThread::pause() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = true;
 }
 
 void CLXEncodeVideoThread::resume() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = false;
 }
 
 void CLXEncodeVideoThread::stop() {
 	m_bRunning = false;
-	m_encodeWaitCondition.wakeOne();
 	wait();
 }
 
@@ -1499,16 +1335,16 @@ void CLXEncodeVideoThread::run() {
 		av_image_fill_arrays(pFrameYUV420P->data, pFrameYUV420P->linesize, video_convert_buffer, AV_PIX_FMT_YUV420P, pEncodeCtx->width,
 		                     pEncodeCtx->height, 1);
 		// ͼת
+		CUVSwsConverter img_encode_converter;
 #ifdef Q_OS_WIN
-		struct SwsContext* img_encode_convert_ctx = sws_getContext(m_pairEncodeCtx.first->width, m_pairEncodeCtx.first->height,
-		                                                           m_eEncodeMode == CLXCodecThread::eLXDecodeMode::eLXDecodeMode_CPU
-			                                                           ? m_pairEncodeCtx.first->pix_fmt : AV_PIX_FMT_NV12, pEncodeCtx->width,
-		                                                           pEncodeCtx->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC, nullptr, nullptr, nullptr);
+		img_encode_converter.init(m_pairEncodeCtx.first->width, m_pairEncodeCtx.first->height,
+		                          m_eEncodeMode == CLXCodecThread::eLXDecodeMode::eLXDecodeMode_CPU ? m_pairEncodeCtx.first->pix_fmt : AV_PIX_FMT_NV12,
+		                          pEncodeCtx->width, pEncodeCtx->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC, 0);
 #elif defined(Q_OS_LINUX)
-        struct SwsContext* img_encode_convert_ctx = sws_getContext(
+        img_encode_converter.init(
                 m_pairEncodeCtx.first->width, m_pairEncodeCtx.first->height, m_pairEncodeCtx.first->pix_fmt,
                 pEncodeCtx->width, pEncodeCtx->height, AV_PIX_FMT_YUV420P,
-                SWS_ACCURATE_RND | SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+                SWS_ACCURATE_RND | SWS_FAST_BILINEAR, 0);
 #endif
 		// AVFrameĸʽΪ YUV420P
 		pFrameYUV420P->format = AV_PIX_FMT_YUV420P;
@@ -1518,103 +1354,86 @@ void CLXEncodeVideoThread::run() {
 
 		// ߳ڼѭִ
 		while (m_bRunning) {
-			// ̱߳ͣһѭ
+			// ̱߳ͣȴһѭ
 			if (m_bPause) {
+				QThread::msleep(LX_PAUSE_WAIT_MS);
 				continue;
 			}
-			// ʱ֡
-			m_encodeMutex.lock();
-			// ֡ΪգѲȴ
-			if (m_encodeFrameQueue.isEmpty()) {
-				m_encodeWaitCondition.wakeOne();
-				m_encodeWaitCondition.wait(&m_encodeMutex);
+			// ӱ֡ȡһ֡ʱ¼״̬
+			AVFrame* pFrame = nullptr;
+			if (m_encodeFrameQueue.pop(&pFrame, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+				continue;
 			}
-			// ӱ֡ȡһ֡
-			AVFrame* pFrame = m_encodeFrameQueue.pop();
-			// ֡Ч
-			if (Q_LIKELY(pFrame)) {
-				// ȡ PTS Ķ
-				const CCalcPtsDur& calPts = std::get<0>(m_pairEncodeCtx.second);
-				// Ĭʹԭʼ֡б
-				AVFrame* pEncodeFrame = pFrame;
-				// ֧ NV12 ʽ֡ķֱʲҪ󣬽иʽת
-				if (AV_PIX_FMT_YUV420P != m_pairEncodeCtx.first->pix_fmt || m_pairEncodeCtx.first->width != pEncodeCtx->width ||
-				    m_pairEncodeCtx.first->height != pEncodeCtx->height) {
-					// ͼת
-					nRet = sws_scale(img_encode_convert_ctx, pFrame->data, pFrame->linesize, 0, m_pairEncodeCtx.first->height, pFrameYUV420P->data,
-					                 pFrameYUV420P->linesize);
-					// תʧܣ¼沢һѭ
-					if (nRet < 0) {
-						av_strerror(nRet, errBuf, ERRBUF_SIZE);
-						av_log(nullptr, AV_LOG_WARNING, "video sws_scale yuv420p fail, %s\n", errBuf);
-						av_packet_unref(pPushPacket);
-						m_encodeMutex.unlock();
-						continue;
-					}
-					//  YUV420P ֡Ŀ͸
-					pFrameYUV420P->width = pEncodeCtx->width;
-					pFrameYUV420P->height = pEncodeCtx->height;
-					// ʹת֡б
-					pEncodeFrame = av_frame_clone(pFrameYUV420P);
+			// Ĭʹԭʼ֡б
+			AVFrame* pEncodeFrame = pFrame;
+			// ֽʱͷԭʼ֡ת֡
+			defer(
+				if (pEncodeFrame != pFrame) {
+					av_frame_free(&pEncodeFrame);
 				}
-				// ֡ PTS ͸
-				pEncodeFrame->pts = calPts.GetVideoPts(frame_index);
-				nRet = avcodec_send_frame(pEncodeCtx, pEncodeFrame);
-				// ʧܣ¼沢һѭ
+				av_frame_free(&pFrame);
+				av_packet_unref(pPushPacket);
+			)
+			// ȡ PTS Ķ
+			const CCalcPtsDur& calPts = std::get<0>(m_pairEncodeCtx.second);
+			// ֧ NV12 ʽ֡ķֱʲҪ󣬽иʽת
+			if (AV_PIX_FMT_YUV420P != m_pairEncodeCtx.first->pix_fmt || m_pairEncodeCtx.first->width != pEncodeCtx->width ||
+			    m_pairEncodeCtx.first->height != pEncodeCtx->height) {
+				// ͼת
+				nRet = img_encode_converter.convert(pFrame, pFrameYUV420P->data, pFrameYUV420P->linesize);
+				// תʧܣ¼沢һѭ
 				if (nRet < 0) {
 					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "video avcodec_send_frame fail, %s\n", errBuf);
-					av_packet_unref(pPushPacket);
-					m_encodeMutex.unlock();
+					av_log(nullptr, AV_LOG_WARNING, "video sws_scale yuv420p fail, %s\n", errBuf);
 					continue;
 				}
-				// ձݰ
-				nRet = avcodec_receive_packet(pEncodeCtx, pPushPacket);
-				if (nRet < 0) {
-					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "video avcodec_receive_packet fail, %s\n", errBuf);
-					av_packet_unref(pPushPacket);
-					m_encodeMutex.unlock();
+				//  YUV420P ֡Ŀ͸
+				pFrameYUV420P->width = pEncodeCtx->width;
+				pFrameYUV420P->height = pEncodeCtx->height;
+				// ʹת֡б
+				pEncodeFrame = av_frame_clone(pFrameYUV420P);
+				if (!pEncodeFrame) {
+					pEncodeFrame = pFrame;
 					continue;
 				}
-				// Ͱ
-				pPushPacket->stream_index = m_nEncodeStreamIndex;
-				m_pushMutex.lock();
-				// Ͷȴ
-				if (m_pushPacketQueue.isFull()) {
-					m_pushWaitCondition.wait(&m_pushMutex);
-				}
-				// ݰ¡һݲ
-				m_pushPacketQueue.push(av_packet_clone(pPushPacket));
-				m_pushWaitCondition.wakeOne();
-				m_pushMutex.unlock();
-				// ͷԭʼ֡Դ
-				av_frame_unref(pFrame);
-				// ͷű֡Դ
-				av_frame_unref(pEncodeFrame);
-				av_frame_free(&pEncodeFrame);
-				// ͷͰԴ
-				av_packet_unref(pPushPacket);
-				// ֡
-				frame_index++;
 			}
-			m_encodeMutex.unlock();
+			// ֡ PTS ͸
+			pEncodeFrame->pts = calPts.GetVideoPts(frame_index);
+			nRet = avcodec_send_frame(pEncodeCtx, pEncodeFrame);
+			// ʧܣ¼沢һѭ
+			if (nRet < 0) {
+				av_strerror(nRet, errBuf, ERRBUF_SIZE);
+				av_log(nullptr, AV_LOG_WARNING, "video avcodec_send_frame fail, %s\n", errBuf);
+				continue;
+			}
+			// ձݰ
+			nRet = avcodec_receive_packet(pEncodeCtx, pPushPacket);
+			if (nRet < 0) {
+				av_strerror(nRet, errBuf, ERRBUF_SIZE);
+				av_log(nullptr, AV_LOG_WARNING, "video avcodec_receive_packet fail, %s\n", errBuf);
+				continue;
+			}
+			// Ͱ
+			pPushPacket->stream_index = m_nEncodeStreamIndex;
+			// ݰ¡һݲͣʱ
+			AVPacket* pPacket = av_packet_clone(pPushPacket);
+			if (pPacket && m_pushPacketQueue.push(pPacket) != UVQUEUE_OK) {
+				av_packet_free(&pPacket);
+			}
+			// ֡
+			frame_index++;
 		}
 		// ͷԴ
 		av_frame_free(&pFrameYUV420P);
 		av_packet_free(&pPushPacket);
 		av_freep(&video_convert_buffer);
-		sws_freeContext(img_encode_convert_ctx);
 	}
 }
 
 //CLXEncodeAudioThread
-CLXEncodeAudioThread::CLXEncodeAudioThread(CircularQueue<AVFrame*>& encodeFrameQueue, CircularQueue<AVPacket*>& pushPacketQueue,
-                                           QWaitCondition& encodeWaitCondition,
-                                           QMutex& encodeMutex, QWaitCondition& pushWaitCondition, QMutex& pushMutex, int nEncodeStreamIndex,
+CLXEncodeAudioThread::CLXEncodeAudioThread(CLXFrameQueue& encodeFrameQueue, CLXPacketQueue& pushPacketQueue, int nEncodeStreamIndex,
                                            QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx, QObject* parent)
 : QThread(parent), m_encodeFrameQueue(encodeFrameQueue), m_pushPacketQueue(pushPacketQueue), m_nEncodeStreamIndex(nEncodeStreamIndex),
-  m_encodeWaitCondition(encodeWaitCondition), m_encodeMutex(encodeMutex), m_pushWaitCondition(pushWaitCondition), m_pushMutex(pushMutex),
   m_pairEncodeCtx(std::move(pairEncodeCtx)) {
 }
 
@@ -1623,18 +1442,15 @@ CLXEncodeAudioThread::~CLXEncodeAudioThread() {
 }
 
 void CLXEncodeAudioThread::pause() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = true;
 }
 
 void CLXEncodeAudioThread::resume() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = false;
 }
 
 void CLXEncodeAudioThread::stop() {
 	m_bRunning = false;
-	m_encodeWaitCondition.wakeOne();
 	wait();
 }
 
@@ -1657,75 +1473,68 @@ void CLXEncodeAudioThread::run() {
 		AVPacket* pPushPacket = av_packet_alloc();
 		while (m_bRunning) {
 			if (m_bPause) {
+				QThread::msleep(LX_PAUSE_WAIT_MS);
 				continue;
 			}
-			m_encodeMutex.lock();
-			if (m_encodeFrameQueue.isEmpty()) {
-				m_encodeWaitCondition.wakeOne();
-				m_encodeWaitCondition.wait(&m_encodeMutex);
+			// ȡƵ֡еһ֡ʱ¼״̬
+			AVFrame* pFrame = nullptr;
+			if (m_encodeFrameQueue.pop(&pFrame, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+				continue;
 			}
-			// ȡƵ֡еһ֡
-			AVFrame* pFrame = m_encodeFrameQueue.pop();
-			if (Q_LIKELY(pFrame)) {
-				// Ƶ֡
-				const CCalcPtsDur& calPts = std::get<0>(m_pairEncodeCtx.second);
-				AVFrame* pEncodeFrame = pFrame;
-				// Ƶʽ AV_SAMPLE_FMT_FLTPƵز
-				if (AV_SAMPLE_FMT_FLTP != m_pairEncodeCtx.first->sample_fmt) {
-					// زʧܣ¼ϢͷԴ
-					nRet = swr_convert_frame(audio_encode_swrCtx, pFrameAAC, pFrame);
-					if (nRet < 0) {
-						av_strerror(nRet, errBuf, ERRBUF_SIZE);
-						av_log(nullptr, AV_LOG_WARNING, "audio swr_convert fail, %s\n", errBuf);
-						av_packet_unref(pPushPacket);
-						m_encodeMutex.unlock();
-						continue;
-					}
-					// ¡زƵ֡
-					pEncodeFrame = av_frame_clone(pFrameAAC);
+			AVFrame* pEncodeFrame = pFrame;
+			// ֽʱͷԭʼ֡ز֡
+			defer(
+				if (pEncodeFrame != pFrame) {
+					av_frame_free(&pEncodeFrame);
 				}
-				// Ƶ֡ʱ
-				pEncodeFrame->pts = calPts.GetAudioPts(frame_index, pEncodeCtx->sample_rate);
-				// Ƶ֡͸
-				nRet = avcodec_send_frame(pEncodeCtx, pEncodeFrame);
+				av_frame_free(&pFrame);
+				av_packet_unref(pPushPacket);
+			)
+			// Ƶ֡
+			const CCalcPtsDur& calPts = std::get<0>(m_pairEncodeCtx.second);
+			// Ƶʽ AV_SAMPLE_FMT_FLTPƵز
+			if (AV_SAMPLE_FMT_FLTP != m_pairEncodeCtx.first->sample_fmt) {
+				// زʧܣ¼ϢͷԴ
+				nRet = swr_convert_frame(audio_encode_swrCtx, pFrameAAC, pFrame);
 				if (nRet < 0) {
-					// ʧܣ¼ϢͷԴ
 					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
-					av_packet_unref(pPushPacket);
-					m_encodeMutex.unlock();
+					av_log(nullptr, AV_LOG_WARNING, "audio swr_convert fail, %s\n", errBuf);
 					continue;
 				}
-				// ձƵݰ
-				nRet = avcodec_receive_packet(pEncodeCtx, pPushPacket);
-				if (nRet < 0) {
-					// ʧܣ¼ϢͷԴ
-					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
-					av_packet_unref(pPushPacket);
-					m_encodeMutex.unlock();
+				// ¡زƵ֡
+				pEncodeFrame = av_frame_clone(pFrameAAC);
+				if (!pEncodeFrame) {
+					pEncodeFrame = pFrame;
 					continue;
 				}
-				// Ͱ
-				pPushPacket->stream_index = m_nEncodeStreamIndex;
-				m_pushMutex.lock();
-				if (m_pushPacketQueue.isFull()) {
-					// ȴ
-					m_pushWaitCondition.wait(&m_pushMutex);
-				}
-				// ¡ݰ͵
-				m_pushPacketQueue.push(av_packet_clone(pPushPacket));
-				m_pushWaitCondition.wakeOne();
-				m_pushMutex.unlock();
-				// ͷ֡ݰ
-				av_frame_unref(pFrame);
-				av_frame_unref(pEncodeFrame);
-				av_frame_free(&pEncodeFrame);
-				av_packet_unref(pPushPacket);
-				// ֡
-				frame_index++;
 			}
-			m_encodeMutex.unlock();
+			// Ƶ֡ʱ
+			pEncodeFrame->pts = calPts.GetAudioPts(frame_index, pEncodeCtx->sample_rate);
+			// Ƶ֡͸
+			nRet = avcodec_send_frame(pEncodeCtx, pEncodeFrame);
+			if (nRet < 0) {
+				// ʧܣ¼ϢͷԴ
+				av_strerror(nRet, errBuf, ERRBUF_SIZE);
+				av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
+				continue;
+			}
+			// ձƵݰ
+			nRet = avcodec_receive_packet(pEncodeCtx, pPushPacket);
+			if (nRet < 0) {
+				// ʧܣ¼ϢͷԴ
+				av_strerror(nRet, errBuf, ERRBUF_SIZE);
+				av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
+				continue;
+			}
+			// Ͱ
+			pPushPacket->stream_index = m_nEncodeStreamIndex;
+			// ¡ݰ͵Уʱ
+			AVPacket* pPacket = av_packet_clone(pPushPacket);
+			if (pPacket && m_pushPacketQueue.push(pPacket) != UVQUEUE_OK) {
+				av_packet_free(&pPacket);
+			}
+			// ֡
+			frame_index++;
 		}
 		// ͷԴ
 		av_frame_free(&pFrameAAC);
@@ -1735,12 +1544,10 @@ void CLXEncodeAudioThread::run() {
 }
 
 //CLXEncodeMuteAudioThread
-CLXEncodeMuteAudioThread::CLXEncodeMuteAudioThread(CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& encodeWaitCondition,
-                                                   QMutex& encodeMutex, QWaitCondition& syncWaitCondition, QMutex& syncMutex, int nEncodeStreamIndex,
-                                                   std::tuple<CCalcPtsDur, AVCodecContext*> pairEncodeCtx, QObject* parent)
-: QThread(parent), m_encodePacketQueue(pushPacketQueue), m_nEncodeStreamIndex(nEncodeStreamIndex),
-  m_encodeWaitCondition(encodeWaitCondition), m_encodeMutex(encodeMutex), m_syncWaitCondition(syncWaitCondition), m_syncMutex(syncMutex),
-  m_pairEncodeCtx(std::move(pairEncodeCtx)) {
+CLXEncodeMuteAudioThread::CLXEncodeMuteAudioThread(CLXPacketQueue& pushPacketQueue, QWaitCondition& syncWaitCondition, QMutex& syncMutex,
+                                                   int nEncodeStreamIndex, std::tuple<CCalcPtsDur, AVCodecContext*> pairEncodeCtx, QObject* parent)
+: QThread(parent), m_encodePacketQueue(pushPacketQueue), m_nEncodeStreamIndex(nEncodeStreamIndex), m_syncWaitCondition(syncWaitCondition),
+  m_syncMutex(syncMutex), m_pairEncodeCtx(std::move(pairEncodeCtx)) {
 }
 
 CLXEncodeMuteAudioThread::~CLXEncodeMuteAudioThread() {
@@ -1748,17 +1555,16 @@ CLXEncodeMuteAudioThread::~CLXEncodeMuteAudioThread() {
 }
 
 void CLXEncodeMuteAudioThread::pause() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = true;
 }
 
 void CLXEncodeMuteAudioThread::resume() {
-	QMutexLocker locker(&m_encodeMutex);
 	m_bPause = false;
 }
 
 void CLXEncodeMuteAudioThread::stop() {
 	m_bRunning = false;
+	m_syncWaitCondition.wakeAll();
 	wait();
 }
 
@@ -1818,18 +1624,29 @@ void CLXEncodeMuteAudioThread::run() {
 			const CCalcPtsDur& calPts = std::get<0>(m_pairEncodeCtx);
 			// 뾲Ƶ֡
 			while (m_bRunning) {
-				// ͣ״̬һѭ
+				// ͣ״̬ȴһѭ
 				if (m_bPause) {
+					QThread::msleep(LX_PAUSE_WAIT_MS);
 					continue;
 				}
-				// ʹûס̵߳Ļ
-				QMutexLocker locker(&m_syncMutex);
-				// ȴ̵߳źţȴƵ֪߳ͨԿʼһ֡Ƶ
-				m_syncWaitCondition.wait(&m_syncMutex);
+				// ȴ̵߳źţȴƵ֪߳ͨԿʼһ֡Ƶʱ¼״̬
+				{
+					QMutexLocker locker(&m_syncMutex);
+					if (!m_syncWaitCondition.wait(&m_syncMutex, LX_QUEUE_WAIT_MS)) {
+						continue;
+					}
+				}
 				// ѭ֡Ƶ
 				for (int i = 0; i < 2; ++i) {
 					// ¡Ƶ֡
 					AVFrame* pCopyFrame = av_frame_clone(pMuteFrame);
+					if (!pCopyFrame) {
+						continue;
+					}
+					defer(
+						av_frame_free(&pCopyFrame);
+						av_packet_unref(pEncodePacket);
+					)
 					// þƵʱ
 					pCopyFrame->pts = calPts.GetAudioPts(frame_index, pEncodeCtx->sample_rate);
 					// ;Ƶ֡б
@@ -1837,8 +1654,6 @@ void CLXEncodeMuteAudioThread::run() {
 					if (nRet < 0) {
 						av_strerror(nRet, errBuf, ERRBUF_SIZE);
 						av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
-						av_frame_unref(pCopyFrame);
-						av_packet_unref(pEncodePacket);
 						continue;
 					}
 					// ձƵ
@@ -1846,30 +1661,17 @@ void CLXEncodeMuteAudioThread::run() {
 					if (nRet < 0) {
 						av_strerror(nRet, errBuf, ERRBUF_SIZE);
 						av_log(nullptr, AV_LOG_WARNING, "audio avcodec_receive_packet fail, %s\n", errBuf);
-						av_frame_unref(pCopyFrame);
-						av_packet_unref(pEncodePacket);
 						continue;
 					}
 					// Ƶ
 					pEncodePacket->stream_index = m_nEncodeStreamIndex;
-					// ʹûסеĻ
-					m_encodeMutex.lock();
-					// ȴеź
-					if (m_encodePacketQueue.isFull()) {
-						m_encodeWaitCondition.wait(&m_encodeMutex);
+					// ƵУʱ
+					AVPacket* pPacket = av_packet_clone(pEncodePacket);
+					if (pPacket && m_encodePacketQueue.push(pPacket) != UVQUEUE_OK) {
+						av_packet_free(&pPacket);
 					}
-					// Ƶ
-					m_encodePacketQueue.push(av_packet_clone(pEncodePacket));
-					// ֪ͨ߳̿Կʼһ֡
-					m_encodeWaitCondition.wakeOne();
-					// ͷžƵ֡Դ
-					av_frame_unref(pCopyFrame);
-					av_frame_free(&pCopyFrame);
-					// ͷűƵԴ
-					av_packet_unref(pEncodePacket);
 					// ֡
 					frame_index++;
-					m_encodeMutex.unlock();
 				}
 			}
 			// ͷԴ
@@ -1882,12 +1684,10 @@ void CLXEncodeMuteAudioThread::run() {
 }
 
 //CLXPushThread
-CLXPushThread::CLXPushThread(AVFormatContext* pOutputFormatCtx, CircularQueue<AVPacket*>& videoPacketQueue,
-                             CircularQueue<AVPacket*>& audioPacketQueue, QWaitCondition& videoWaitCondition, QMutex& videoMutex,
-                             QWaitCondition& audioWaitCondition, QMutex& audioMutex, bool bPushVideo, bool bPushAudio, QObject* parent)
+CLXPushThread::CLXPushThread(AVFormatContext* pOutputFormatCtx, CLXPacketQueue& videoPacketQueue, CLXPacketQueue& audioPacketQueue,
+                             bool bPushVideo, bool bPushAudio, QObject* parent)
 : QThread(parent), m_videoPacketQueue(videoPacketQueue), m_audioPacketQueue(audioPacketQueue), m_bPushVideo(bPushVideo),
-  m_bPushAudio(bPushAudio), m_videoWaitCondition(videoWaitCondition), m_videoMutex(videoMutex), m_audioWaitCondition(audioWaitCondition),
-  m_audioMutex(audioMutex), m_pOutputFormatCtx(pOutputFormatCtx) {
+  m_bPushAudio(bPushAudio), m_pOutputFormatCtx(pOutputFormatCtx) {
 }
 
 CLXPushThread::~CLXPushThread() {
@@ -1895,96 +1695,66 @@ CLXPushThread::~CLXPushThread() {
 }
 
 void CLXPushThread::pause() {
-	QMutexLocker videoLocker(&m_videoMutex);
-	QMutexLocker audioLocker(&m_audioMutex);
 	m_bPause = true;
 }
 
 void CLXPushThread::resume() {
-	QMutexLocker videoLocker(&m_videoMutex);
-	QMutexLocker audioLocker(&m_audioMutex);
 	m_bPause = false;
 }
 
 void CLXPushThread::stop() {
 	m_bRunning = false;
-	m_videoWaitCondition.wakeAll();
-	m_audioWaitCondition.wakeAll();
 	wait();
 }
 
+void CLXPushThread::writePacket(AVPacket* pPacket, const char* szType) {
+	char errBuf[ERRBUF_SIZE]{};
+	// ûݻʱЧݰ
+	if (pPacket->buf && pPacket->pts >= 0) {
+		int nRet = av_interleaved_write_frame(m_pOutputFormatCtx, pPacket);
+		if (nRet < 0) {
+			av_strerror(nRet, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_WARNING, "%s push error, %s\n", szType, errBuf);
+		}
+	}
+	av_packet_free(&pPacket);
+}
+
 void CLXPushThread::run() {
 	//QFile file(qApp->applicationDirPath() + "PTS_logger.txt");
 	//file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Truncate);
 	//QTextStream textStream(&file);
-	char errBuf[ERRBUF_SIZE]{};
 	while (m_bRunning) {
 		if (m_bPause) {
+			QThread::msleep(LX_PAUSE_WAIT_MS);
 			continue;
 		}
-		int nVideoPts = 0;
+		int64_t nVideoPts = 0;
 		if (m_bPushVideo) {
-			QMutexLocker locker(&m_videoMutex);
-			if (m_videoPacketQueue.isEmpty()) {
-				m_videoWaitCondition.wakeOne();
-				m_videoWaitCondition.wait(&m_videoMutex);
+			// ȡƵͷݰʱ¼״̬
+			AVPacket* pVideoPacket = nullptr;
+			if (m_videoPacketQueue.pop(&pVideoPacket, LX_QUEUE_WAIT_MS) != UVQUEUE_OK) {
+				continue;
 			}
-			// ȡƵͷݰ
-			AVPacket* pVideoPacket = m_videoPacketQueue.pop();
-			if (pVideoPacket && pVideoPacket->pts >= 0) {
-				//QString curTime = "\nvideo:\t" + QDateTime::fromMSecsSinceEpoch(QDateTime::currentMSecsSinceEpoch()).toString("yyyy-MM-dd hh:mm:ss.zzz");
-				//textStream << curTime << "\n\r";
-				//OutputDebugStringA(curTime.toStdString().c_str());
-				// qDebug() << "video" << pVideoPacket->pts;
-				nVideoPts = pVideoPacket->pts; // NOLINT
-				// Ƶݰд
-				int nRet = av_interleaved_write_frame(m_pOutputFormatCtx, pVideoPacket);
-				if (nRet < 0) {
-					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "video push error, %s\n", errBuf);
-					av_packet_unref(pVideoPacket);
-					av_packet_free(&pVideoPacket);
-					continue;
-				}
-				av_packet_unref(pVideoPacket);
-				av_packet_free(&pVideoPacket);
+			// qDebug() << "video" << pVideoPacket->pts;
+			if (pVideoPacket->pts >= 0) {
+				nVideoPts = pVideoPacket->pts;
 			}
+			// Ƶݰд
+			writePacket(pVideoPacket, "video");
 		}
 		if (m_bPushAudio) {
-			QMutexLocker locker(&m_audioMutex);
-			if (m_audioPacketQueue.isEmpty()) {
-				m_audioWaitCondition.wakeOne();
-				m_audioWaitCondition.wait(&m_audioMutex);
-			}
-			// Ƶͷȡݰ
-			AVPacket* pAudioPacket = m_audioPacketQueue.pop();
-			while (pAudioPacket && pAudioPacket->buf && pAudioPacket->pts >= 0 && (!m_bPushVideo || pAudioPacket->pts <= nVideoPts)) {
-				//QString curTime = "\naudio:\t" + QDateTime::fromMSecsSinceEpoch(QDateTime::currentMSecsSinceEpoch()).toString("yyyy-MM-dd hh:mm:ss.zzz");
-				//textStream << curTime << "\n\r";
-				//OutputDebugStringA(curTime.toStdString().c_str());
-				//qDebug() << "audio" << pAudioPacket->pts;
-				// д
-				int nRet = av_interleaved_write_frame(m_pOutputFormatCtx, pAudioPacket);
-				if (nRet < 0) {
-					av_strerror(nRet, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_WARNING, "audio push error, %s\n", errBuf);
-					av_packet_unref(pAudioPacket);
-					av_packet_free(&pAudioPacket);
-					// зǿգһƵݰ PTS СƵݰ PTSȡһ
-					if (!m_audioPacketQueue.isEmpty()) {
-						if (m_audioPacketQueue.first()->pts < nVideoPts) {
-							pAudioPacket = m_audioPacketQueue.pop();
-						}
-					}
-					continue;
+			AVPacket* pAudioPacket = nullptr;
+			if (!m_bPushVideo) {
+				// ֻƵʱȴһƵ
+				if (m_audioPacketQueue.pop(&pAudioPacket, LX_QUEUE_WAIT_MS) == UVQUEUE_OK) {
+					writePacket(pAudioPacket, "audio");
 				}
-				av_packet_unref(pAudioPacket);
-				av_packet_free(&pAudioPacket);
-				// зǿգһƵݰ PTS СƵݰ PTSȡһ
-				if (!m_audioPacketQueue.isEmpty()) {
-					if (!m_bPushVideo || m_audioPacketQueue.first()->pts < nVideoPts) {
-						pAudioPacket = m_audioPacketQueue.pop();
-					}
+			} else {
+				// д PTS ڵǰƵƵƵ
+				while (m_audioPacketQueue.popIf(&pAudioPacket, [nVideoPts](const AVPacket* pkt) { return pkt->pts <= nVideoPts; })) {
+					//qDebug() << "audio" << pAudioPacket->pts;
+					writePacket(pAudioPacket, "audio");
 				}
 			}
 		}
@@ -2025,15 +1795,24 @@ void CLXRecvThread::run() {
 		av_log(nullptr, AV_LOG_ERROR, "Can't open input, %s\n", errBuf);
 		return;
 	}
+	// ͬһĿٴ̽ʱʹò̽⻺
+	const std::string strProbeKey = CUVProbeCache::key(m_strPath.toStdString(), m_pFormatCtx);
+	const bool bProbeCached = CUVProbeCache::instance().apply(strProbeKey, m_pFormatCtx);
 	// ýļеϢ
 	nRet = avformat_find_stream_info(m_pFormatCtx, nullptr);
 	// ʧܣ¼Ϣرļ
 	if (nRet < 0) {
 		av_strerror(nRet, errBuf, ERRBUF_SIZE);
 		av_log(nullptr, AV_LOG_ERROR, "Can't find stream info, %s\n", errBuf);
+		if (bProbeCached) {
+			CUVProbeCache::instance().remove(strProbeKey);
+		}
 		avformat_close_input(&m_pFormatCtx);
 		return;
 	}
+	if (!bProbeCached) {
+		CUVProbeCache::instance().store(strProbeKey, m_pFormatCtx);
+	}
 	// ӡʽϢ
 	av_dump_format(m_pFormatCtx, 0, m_strPath.toStdString().c_str(), 0);
 	// ƵƵ
@@ -2041,7 +1820,7 @@ void CLXRecvThread::run() {
 	int nAudioIndex = av_find_best_stream(m_pFormatCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
 	// ʧܣ¼Ϣرļ
 	if (-1 == nVideoIndex && -1 == nAudioIndex) {
-		av_log(nullptr, AV_LOG_ERROR, "Can't find video and audio stream, %s\n");
+		av_log(nullptr, AV_LOG_ERROR, "Can't find video and audio stream\n");
 		avformat_close_input(&m_pFormatCtx);
 		return;
 	}
@@ -10,7 +10,9 @@
 
 #include "def/avdef.hpp"
 #include "def/uvdef.hpp"
+#include "util/uvblockingqueue.hpp"
 #include "util/uvffmpeg_util.hpp"
+#include "video/uvdecodepool.hpp"
 
 class CLXCodecThread;
 class CLXVideoThread;
@@ -29,92 +31,41 @@ struct AVPacket;
 struct AVRational;
 struct AVCodecParameters;
 
-// ѭ
-template<typename T>
-struct CircularQueue {
-public:
-	// ָСѭ
-	explicit CircularQueue(quint64 size);
-	~CircularQueue();
-	// жѭǷ
-	bool isFull() const;
-	// жѭǷΪ
-	bool isEmpty() const;
-	// Ԫѭĩβ
-	bool push(T);
-	// 
-	T pop();
-	// ȡ
-	T first();
-	// ն
-	void clear();
-	int size() const;
-
-private:
-	std::atomic_int m_nSize{ 0 };  // ѭܴС
-	std::atomic_int m_nFront{ 0 }; // ѭͷ
-	std::atomic_int m_nRear{ 0 };  // ѭβ
-	T* m_pData{ nullptr };         // 洢ѭԪص
-};
-
-template<typename T>
-inline CircularQueue<T>::CircularQueue(quint64 size): m_nSize(size) { // NOLINT
-	m_pData = new T[size];
+// , ͬʱƸֽ, 4K ʱֽ
+#define LX_VIDEO_PACKET_NUM     1000
+#define LX_VIDEO_PACKET_BYTES   (32 * 1024 * 1024)
+#define LX_AUDIO_PACKET_NUM     10000
+#define LX_AUDIO_PACKET_BYTES   (4 * 1024 * 1024)
+#define LX_VIDEO_FRAME_NUM      100
+#define LX_VIDEO_FRAME_BYTES    (128 * 1024 * 1024)
+#define LX_AUDIO_FRAME_NUM      1000
+#define LX_AUDIO_FRAME_BYTES    (16 * 1024 * 1024)
+// еȴʱ, ʱ¼״̬, λ ms
+#define LX_QUEUE_WAIT_MS        100
+// ͣʱѯ, λ ms
+#define LX_PAUSE_WAIT_MS        10
+
+typedef CUVBlockingQueue<AVPacket*> CLXPacketQueue;
+typedef CUVBlockingQueue<AVFrame*> CLXFrameQueue;
+
+inline size_t LXPacketBytes(AVPacket* const& pkt) {
+	return pkt ? pkt->size : 0;
 }
 
-template<typename T>
-inline CircularQueue<T>::~CircularQueue() {
-	delete[]m_pData;
-}
-
-template<typename T>
-inline bool CircularQueue<T>::isFull() const {
-	return m_nFront == (m_nRear + 1) % m_nSize;
-}
-
-template<typename T>
-inline bool CircularQueue<T>::isEmpty() const {
-	return m_nFront == m_nRear;
-}
-
-template<typename T>
-inline bool CircularQueue<T>::push(T data) {
-	if (isFull()) {
-		return false;
+inline size_t LXFrameBytes(AVFrame* const& frame) {
+	size_t bytes = 0;
+	for (int i = 0; frame && i < AV_NUM_DATA_POINTERS && frame->buf[i]; ++i) {
+		bytes += frame->buf[i]->size;
 	}
-	m_pData[m_nRear] = data;
-	m_nRear = (m_nRear + 1) % m_nSize;
-	return true;
+	return bytes;
 }
 
-template<typename T>
-inline T CircularQueue<T>::pop() {
-	if (isEmpty()) {
-		return nullptr;
-	}
-	T data = m_pData[m_nFront];
-	m_nFront = (m_nFront + 1) % m_nSize;
-	return data;
-}
-
-template<typename T>
-inline T CircularQueue<T>::first() {
-	if (isEmpty()) {
-		return nullptr;
-	}
-	T data = m_pData[m_nFront];
-	return data;
+inline void LXFreePacket(AVPacket* pkt) {
+	av_packet_free(&pkt);
 }
 
-template<typename T>
-inline void CircularQueue<T>::clear() {
-	m_nFront = 0;
-	m_nRear = 0;
-}
-
-template<typename T>
-inline int CircularQueue<T>::size() const {
-	return (m_nRear - m_nFront + m_nSize) % m_nSize;
+inline void LXFreeFrame(AVFrame* frame) {
+	av_frame_free(&frame);
 }
 
 class CCalcPtsDur {
@@ -193,22 +144,17 @@ private:
 	QString m_strFile;                   // Ҫļ·
 	QSize m_szPlay;                      // ŴڴС
 	LXPushStreamInfo m_stPushStreamInfo; // Ϣ
-	bool m_bRunning{ true };
-	bool m_bPause{ false };
+	std::atomic<bool> m_bRunning{ true };
+	std::atomic<bool> m_bPause{ false };
 	int m_nVideoIndex{ -1 };
 	int m_nAudioIndex{ -1 };
-	CircularQueue<AVPacket*> m_videoPacketQueue{ 1000 };      // 洢Ƶݵ AVPacket ָ
-	CircularQueue<AVPacket*> m_audioPacketQueue{ 10000 };     // 洢Ƶݵ AVPacket ָ
-	CircularQueue<AVPacket*> m_videoPushPacketQueue{ 1000 };  // 洢Ƶݵ AVPacket ָ
-	CircularQueue<AVPacket*> m_audioPushPacketQueue{ 10000 }; // 洢Ƶݵ AVPacket ָ
-	QWaitCondition m_videoWaitCondition;
-	QMutex m_videoMutex; // Ƶ̵߳ĵȴͻ
-	QWaitCondition m_audioWaitCondition;
-	QMutex m_audioMutex; // Ƶ̵߳ĵȴͻ
-	QWaitCondition m_pushVideoWaitCondition;
-	QMutex m_pushVideoMutex; // Ƶ̵߳ĵȴͻ
-	QWaitCondition m_pushAudioWaitCondition;
-	QMutex m_pushAudioMutex; // Ƶ̵߳ĵȴͻ
+	CLXPacketQueue m_videoPacketQueue{ LX_VIDEO_PACKET_NUM, LX_VIDEO_PACKET_BYTES, LXPacketBytes };     // 洢Ƶݵ AVPacket ָ
+	CLXPacketQueue m_audioPacketQueue{ LX_AUDIO_PACKET_NUM, LX_AUDIO_PACKET_BYTES, LXPacketBytes };     // 洢Ƶݵ AVPacket ָ
+	CLXPacketQueue m_videoPushPacketQueue{ LX_VIDEO_PACKET_NUM, LX_VIDEO_PACKET_BYTES, LXPacketBytes }; // 洢Ƶݵ AVPacket ָ
+	CLXPacketQueue m_audioPushPacketQueue{ LX_AUDIO_PACKET_NUM, LX_AUDIO_PACKET_BYTES, LXPacketBytes }; // 洢Ƶݵ AVPacket ָ
+	QMutex m_demuxMutex; // seek  av_read_frame 
+	QWaitCondition m_pauseWaitCondition;
+	QMutex m_pauseMutex; // ͣʱ⸴̵߳ĵȴͻ
 	QWaitCondition m_AVSyncWaitCondition;
 	QMutex m_AVSyncMutex; // Ƶ̵ͬ߳ĵĵȴͻ
 
@@ -230,10 +176,6 @@ public:
 	/* @Parameter
 	packetQueue 洢ǰݰ
 	pushPacketQueue 洢ݰ
-	waitCondition ߳ͬ
-	mutex 
-	videoWaitCondition Ƶͬ
-	videoMutex Ƶ
 	pFormatCtx Ƶʽ
 	nStreamIndex Ƶ
 	nEncodeStreamIndex Ƶ
@@ -244,9 +186,7 @@ public:
 	szPlay Ƶŵĳߴ
 	eDecodeMode ģʽ
 	*/
-	explicit CLXVideoThread(CircularQueue<AVPacket*>& packetQueue, CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& waitCondition,
-	                        QMutex& mutex,
-	                        QWaitCondition& videoWaitCondition, QMutex& videoMutex, AVFormatContext* pFormatCtx,
+	explicit CLXVideoThread(CLXPacketQueue& packetQueue, CLXPacketQueue& pushPacketQueue, AVFormatContext* pFormatCtx,
 	                        int nStreamIndex, int nEncodeStreamIndex, QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> mapOutputCtx,
 	                        CLXCodecThread::OpenMode eMode,
 	                        bool bSendCountDown, bool bPush, QSize szPlay, CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent = nullptr);
@@ -259,6 +199,7 @@ public:
 
 public:
 	// õǰʱ
+	// õǰʱ, ɽ߳Լˢ
 	void setCurrentPts(int64_t nPts);
 
 	static enum AVPixelFormat hw_pix_fmt;
@@ -276,30 +217,25 @@ protected:
 private:
 	AVFormatContext* m_pFormatCtx{ nullptr };                                          // Ƶ
 	AVCodecContext* m_pCodecCtx{ nullptr };                                            // Ƶ
+	CUVDecodePool m_decodePool;                                                        // ʱ get_buffer2
 	QSize m_szPlay;                                                                    // Ƶųߴ
 	QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> m_pairOutputCtx; // ʽĺͱϢ
 	int m_nStreamIndex{ -1 };                                                          // Ƶ
 	int m_nEncodeStreamIndex{ -1 };                                                    // Ƶ
-	bool m_bRunning{ true };                                                           // Ƿ
-	bool m_bPause{ false };                                                            // Ƿͣ
+	std::atomic<bool> m_bRunning{ true };                                              // Ƿ
+	std::atomic<bool> m_bPause{ false };                                               // Ƿͣ
+	std::atomic<bool> m_bFlush{ false };                                               // seek ǷҪˢ½
+	std::atomic<int64_t> m_nFlushPts{ 0 };                                             // seek Ŀʱ
 	bool m_bSendCountDown{ false };                                                    // Ƿ͵ʱź
 	bool m_bPush{ false };                                                             // Ƿ
 	bool m_decodeType{ false };                                                        // 
 
 	CLXEncodeVideoThread* m_pEncodeThread{ nullptr };  // Ƶ߳
 	CLXVideoPlayThread* m_pPlayThread{ nullptr };      // Ƶ߳
-	CircularQueue<AVPacket*>& m_packetQueue;           // 洢ǰݰѭ
-	CircularQueue<AVPacket*>& m_pushPacketQueue;       // 洢ݰѭ
-	CircularQueue<AVFrame*> m_decodeFrameQueue{ 100 }; // 洢Ƶ֡ѭ
-	CircularQueue<AVFrame*> m_playFrameQueue{ 100 };   // 洢ŵƵ֡ѭ
-	QWaitCondition& m_decodeWaitCondition;             // ߳ͻ
-	QMutex& m_decodeMutex;
-	QWaitCondition m_encodeWaitCondition; // ߳ͻ
-	QMutex m_encodeMutex;
-	QWaitCondition m_playWaitCondition; // ߳ͻ
-	QMutex m_playMutex;
-	QWaitCondition& m_pushWaitCondition; // ߳ͻ
-	QMutex& m_pushMutex;
+	CLXPacketQueue& m_packetQueue;                                                             // 洢ǰݰ
+	CLXPacketQueue& m_pushPacketQueue;                                                         // 洢ݰ
+	CLXFrameQueue m_decodeFrameQueue{ LX_VIDEO_FRAME_NUM, LX_VIDEO_FRAME_BYTES, LXFrameBytes }; // 洢Ƶ֡Ķ
+	CLXFrameQueue m_playFrameQueue{ LX_VIDEO_FRAME_NUM, LX_VIDEO_FRAME_BYTES, LXFrameBytes };   // 洢ŵƵ֡Ķ
 	CLXCodecThread::OpenMode m_eMode{ CLXCodecThread::OpenMode::OpenMode_Play }; // ģʽǲŻ
 	const CLXCodecThread::eLXDecodeMode& m_eDecodeMode;                          // ģʽ
 };
@@ -311,10 +247,6 @@ public:
 	/* @Parameter
 	packetQueue 洢ǰݰ
 	pushPacketQueue 洢ݰ
-	waitCondition ߳ͬ
-	mutex 
-	audioWaitCondition Ƶͬ
-	audioMutex Ƶ
 	pFormatCtx Ƶʽ
 	nStreamIndex Ƶ
 	nEncodeStreamIndex Ƶ
@@ -323,9 +255,7 @@ public:
 	bPush Ƿ
 	decodePara 
 	*/
-	explicit CLXAudioThread(CircularQueue<AVPacket*>& packetQueue, CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& waitCondition,
-	                        QMutex& mutex,
-	                        QWaitCondition& audioWaitCondition, QMutex& audioMutex, AVFormatContext* pFormatCtx,
+	explicit CLXAudioThread(CLXPacketQueue& packetQueue, CLXPacketQueue& pushPacketQueue, AVFormatContext* pFormatCtx,
 	                        int nStreamIndex, int nEncodeStreamIndex, QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairOutputCtx,
 	                        CLXCodecThread::OpenMode eMode,
 	                        bool bPush, const AVCodecParameters& decodePara, QObject* parent = nullptr);
@@ -358,22 +288,16 @@ private:
 	QPair<AVFormatContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> m_pairOutputCtx; // Ƶ
 	int m_nStreamIndex{ -1 };                                                          // Ƶ
 	int m_nEncodeStreamIndex{ -1 };                                                    // Ƶ
-	bool m_bRunning{ true };                                                           // ߳Ƿ
-	bool m_bPause{ false };                                                            // ߳Ƿͣ
+	std::atomic<bool> m_bRunning{ true };                                              // ߳Ƿ
+	std::atomic<bool> m_bPause{ false };                                               // ߳Ƿͣ
+	std::atomic<bool> m_bFlush{ false };                                               // seek ǷҪˢ½
+	std::atomic<int64_t> m_nFlushPts{ 0 };                                             // seek Ŀʱ
 	bool m_bPush{ false };                                                             // ߳Ƿ
 
-	CircularQueue<AVPacket*>& m_packetQueue;            // Ƶ
-	CircularQueue<AVPacket*>& m_pushPacketQueue;        // ƵͰ
-	CircularQueue<AVFrame*> m_decodeFrameQueue{ 1000 }; // ֡
-	CircularQueue<AVFrame*> m_playFrameQueue{ 1000 };   // ֡
-	QWaitCondition& m_decodeWaitCondition;              // ȴԼ뻥
-	QMutex& m_decodeMutex;
-	QWaitCondition m_encodeWaitCondition; // ȴԼ뻥
-	QMutex m_encodeMutex;
-	QWaitCondition m_playWaitCondition; // ŵȴԼŻ
-	QMutex m_playMutex;
-	QWaitCondition& m_pushWaitCondition; // ȴԼ
-	QMutex& m_pushMutex;
+	CLXPacketQueue& m_packetQueue;                                                             // Ƶ
+	CLXPacketQueue& m_pushPacketQueue;                                                         // ƵͰ
+	CLXFrameQueue m_decodeFrameQueue{ LX_AUDIO_FRAME_NUM, LX_AUDIO_FRAME_BYTES, LXFrameBytes }; // ֡
+	CLXFrameQueue m_playFrameQueue{ LX_AUDIO_FRAME_NUM, LX_AUDIO_FRAME_BYTES, LXFrameBytes };   // ֡
 	CLXCodecThread::OpenMode m_eMode{ CLXCodecThread::OpenMode::OpenMode_Play }; // Ƶʽ
 };
 
@@ -383,8 +307,6 @@ class CLXVideoPlayThread final : public QThread {
 public:
 	/* @Parameter
 	decodeFrameQueue ȴƵ֡
-	waitCondition ߳ͬ
-	mutex 
 	pCodecCtx ӦƵ
 	timeBase Ƶ֡ʱ
 	bSendCountDown Ƿ͵ʱ
@@ -392,8 +314,7 @@ public:
 	szPlay ŴڴС
 	eDecodeMode Ƶģʽ
 	*/
-	explicit CLXVideoPlayThread(CircularQueue<AVFrame*>& decodeFrameQueue, QWaitCondition& waitCondition, QMutex& mutex,
-	                            AVCodecContext* pCodecCtx, const AVRational& timeBase, bool bSendCountDown, CLXVideoThread* videoThread, QSize szPlay,
+	explicit CLXVideoPlayThread(CLXFrameQueue& decodeFrameQueue, AVCodecContext* pCodecCtx, const AVRational& timeBase, bool bSendCountDown, CLXVideoThread* videoThread, QSize szPlay,
 	                            CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent = nullptr);
 	~CLXVideoPlayThread() override;
 
@@ -409,17 +330,15 @@ protected:
 	void run() override;
 
 private:
-	AVCodecContext* m_pCodecCtx{ nullptr };    // Ƶ
-	bool m_bRunning{ true };                   // ߳Ƿ
-	bool m_bPause{ false };                    // Ƿͣ
-	int64_t m_nLastTime{ -1 };                 // һβʱ
-	int64_t m_nLastPts{ -1 };                  // һβʱ
-	bool m_bSendCountDown{ false };            // Ƿ͵ʱ֪ͨ
-	const AVRational& m_timeBase;              // Ƶ֡ʱ
-	CLXVideoThread* m_videoThread{ nullptr };  // Ƶ߳
-	CircularQueue<AVFrame*>& m_playFrameQueue; // Ƶ֡
-	QWaitCondition& m_playWaitCondition;       // ƵŵȴԼ
-	QMutex& m_playMutex;
+	AVCodecContext* m_pCodecCtx{ nullptr };   // Ƶ
+	std::atomic<bool> m_bRunning{ true };     // ߳Ƿ
+	std::atomic<bool> m_bPause{ false };      // Ƿͣ
+	std::atomic<int64_t> m_nLastTime{ -1 };   // һβʱ
+	std::atomic<int64_t> m_nLastPts{ -1 };    // һβʱ
+	bool m_bSendCountDown{ false };           // Ƿ͵ʱ֪ͨ
+	const AVRational& m_timeBase;             // Ƶ֡ʱ
+	CLXVideoThread* m_videoThread{ nullptr }; // Ƶ߳
+	CLXFrameQueue& m_playFrameQueue;          // Ƶ֡
 	QSize m_szPlay;                                     // Ŵڳߴ
 	const CLXCodecThread::eLXDecodeMode& m_eDecodeMode; // Ƶģʽ
 };
@@ -430,14 +349,11 @@ class CLXAudioPlayThread final : public QThread {
 public:
 	/* @Parameter
 	decodeFrameQueue ȴƵ֡
-	waitCondition ߳ͬ
-	mutex 
 	pCodecCtx ӦƵ
 	timeBase Ƶ֡ʱ
 	audioThread Ƶ߳
 	*/
-	explicit CLXAudioPlayThread(CircularQueue<AVFrame*>& decodeFrameQueue, QWaitCondition& waitCondition, QMutex& mutex,
-	                            AVCodecContext* pCodecCtx, const AVRational& timeBase, CLXAudioThread* audioThread, QObject* parent = nullptr);
+	explicit CLXAudioPlayThread(CLXFrameQueue& decodeFrameQueue, AVCodecContext* pCodecCtx, const AVRational& timeBase, CLXAudioThread* audioThread, QObject* parent = nullptr);
 	~CLXAudioPlayThread() override;
 
 public:
@@ -452,16 +368,14 @@ protected:
 	void run() override;
 
 private:
-	AVCodecContext* m_pCodecCtx{ nullptr };    // Ƶ
-	bool m_bRunning{ true };                   // Ƿ
-	bool m_bPause{ false };                    // Ƿͣ
-	int64_t m_nLastTime{ -1 };                 // һβʱ
-	int64_t m_nLastPts{ -1 };                  // һβʱ
-	const AVRational& m_timeBase;              // Ƶʱ
-	CLXAudioThread* m_audioThread{ nullptr };  // Ƶ߳
-	CircularQueue<AVFrame*>& m_playFrameQueue; // Ƶ֡
-	QWaitCondition& m_playWaitCondition;       // ƵŵȴԼ
-	QMutex& m_playMutex;
+	AVCodecContext* m_pCodecCtx{ nullptr };   // Ƶ
+	std::atomic<bool> m_bRunning{ true };     // Ƿ
+	std::atomic<bool> m_bPause{ false };      // Ƿͣ
+	std::atomic<int64_t> m_nLastTime{ -1 };   // һβʱ
+	std::atomic<int64_t> m_nLastPts{ -1 };    // һβʱ
+	const AVRational& m_timeBase;             // Ƶʱ
+	CLXAudioThread* m_audioThread{ nullptr }; // Ƶ߳
+	CLXFrameQueue& m_playFrameQueue;          // Ƶ֡
 };
 
 class CLXEncodeVideoThread final : public QThread {
@@ -471,17 +385,11 @@ public:
 	/* @Parameter
 	encodeFrameQueue ȴƵ֡
 	pushPacketQueue ȴ͵Ƶ
-	encodeWaitCondition ߳ͬ
-	encodeMutex 뻥
-	pushWaitCondition ߳ͬ
-	pushMutex ͻ
 	nEncodeStreamIndex Ƶ
 	pairEncodeCtx ĺϢ
 	eDecodeMode ģʽ
 	*/
-	explicit CLXEncodeVideoThread(CircularQueue<AVFrame*>& encodeFrameQueue, CircularQueue<AVPacket*>& pushPacketQueue,
-	                              QWaitCondition& encodeWaitCondition,
-	                              QMutex& encodeMutex, QWaitCondition& pushWaitCondition, QMutex& pushMutex, int nEncodeStreamIndex,
+	explicit CLXEncodeVideoThread(CLXFrameQueue& encodeFrameQueue, CLXPacketQueue& pushPacketQueue, int nEncodeStreamIndex,
 	                              QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx,
 	                              CLXCodecThread::eLXDecodeMode eDecodeMode, QObject* parent = nullptr);
 	~CLXEncodeVideoThread() override;
@@ -495,16 +403,12 @@ protected:
 	void run() override;
 
 private:
-	CircularQueue<AVFrame*>& m_encodeFrameQueue;                                      // ȴƵ֡
-	CircularQueue<AVPacket*>& m_pushPacketQueue;                                      // ȴƵ
+	CLXFrameQueue& m_encodeFrameQueue;                                                // ȴƵ֡
+	CLXPacketQueue& m_pushPacketQueue;                                                // ȴƵ
 	int m_nEncodeStreamIndex{ -1 };                                                   // Ƶ
-	QWaitCondition& m_encodeWaitCondition;                                            // ߳ͬ
-	QMutex& m_encodeMutex;                                                            // 뻥
-	QWaitCondition& m_pushWaitCondition;                                              // ̻߳
-	QMutex& m_pushMutex;                                                              // 
 	QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> m_pairEncodeCtx; // ԼصϢ
-	bool m_bRunning{ true };                                                          // Ƿ
-	bool m_bPause{ false };                                                           // Ƿͣ
+	std::atomic<bool> m_bRunning{ true };                                             // Ƿ
+	std::atomic<bool> m_bPause{ false };                                              // Ƿͣ
 	const CLXCodecThread::eLXDecodeMode& m_eEncodeMode;                               // ģʽ
 };
 
@@ -515,16 +419,10 @@ public:
 	/* @Parameter
 	encodeFrameQueue ȴƵ֡
 	pushPacketQueue ȴ͵Ƶ
-	encodeWaitCondition ߳ͬ
-	encodeMutex 뻥
-	pushWaitCondition ߳ͬ
-	pushMutex ͻ
 	nEncodeStreamIndex Ƶ
 	pairEncodeCtx ĺϢ
 	*/
-	explicit CLXEncodeAudioThread(CircularQueue<AVFrame*>& encodeFrameQueue, CircularQueue<AVPacket*>& pushPacketQueue,
-	                              QWaitCondition& encodeWaitCondition,
-	                              QMutex& encodeMutex, QWaitCondition& pushWaitCondition, QMutex& pushMutex, int nEncodeStreamIndex,
+	explicit CLXEncodeAudioThread(CLXFrameQueue& encodeFrameQueue, CLXPacketQueue& pushPacketQueue, int nEncodeStreamIndex,
 	                              QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> pairEncodeCtx, QObject* parent = nullptr);
 	~CLXEncodeAudioThread() override;
 
@@ -537,16 +435,12 @@ protected:
 	void run() override;
 
 private:
-	CircularQueue<AVFrame*>& m_encodeFrameQueue;                                      // ȴƵ֡
-	CircularQueue<AVPacket*>& m_pushPacketQueue;                                      // ȴ͵Ƶ
+	CLXFrameQueue& m_encodeFrameQueue;                                                // ȴƵ֡
+	CLXPacketQueue& m_pushPacketQueue;                                                // ȴ͵Ƶ
 	int m_nEncodeStreamIndex{ -1 };                                                   // Ƶ
-	QWaitCondition& m_encodeWaitCondition;                                            // ߳ͬ
-	QMutex& m_encodeMutex;                                                            // ̻߳
-	QWaitCondition& m_pushWaitCondition;                                              // ߳ͬ
-	QMutex& m_pushMutex;                                                              // ̻߳
 	QPair<AVCodecContext*, std::tuple<CCalcPtsDur, AVCodecContext*>> m_pairEncodeCtx; // Ϣ
-	bool m_bRunning{ true };                                                          // Ƿ
-	bool m_bPause{ false };                                                           // Ƿͣ
+	std::atomic<bool> m_bRunning{ true };                                             // Ƿ
+	std::atomic<bool> m_bPause{ false };                                              // Ƿͣ
 };
 
 class CLXEncodeMuteAudioThread final : public QThread {
@@ -555,15 +449,12 @@ class CLXEncodeMuteAudioThread final : public QThread {
 public:
 	/* @Parameter
 	pushPacketQueue ȴ͵Ƶ
-	encodeWaitCondition ߳ͬ
-	encodeMutex 뻥
 	syncWaitCondition ߳ͬ
 	syncMutex ͻ
 	nEncodeStreamIndex Ƶ
 	pairEncodeCtx ĺϢ
 	*/
-	explicit CLXEncodeMuteAudioThread(CircularQueue<AVPacket*>& pushPacketQueue, QWaitCondition& encodeWaitCondition,
-	                                  QMutex& encodeMutex, QWaitCondition& syncWaitCondition, QMutex& syncMutex, int nEncodeStreamIndex,
+	explicit CLXEncodeMuteAudioThread(CLXPacketQueue& pushPacketQueue, QWaitCondition& syncWaitCondition, QMutex& syncMutex, int nEncodeStreamIndex,
 	                                  std::tuple<CCalcPtsDur, AVCodecContext*> pairEncodeCtx, QObject* parent = nullptr);
 	~CLXEncodeMuteAudioThread() override;
 
@@ -576,24 +467,21 @@ protected:
 	void run() override;
 
 private:
-	CircularQueue<AVPacket*>& m_encodePacketQueue;            // ȴ͵Ƶ
+	CLXPacketQueue& m_encodePacketQueue;                      // ȴ͵Ƶ
 	int m_nEncodeStreamIndex{ -1 };                           // Ƶ
-	QWaitCondition& m_encodeWaitCondition;                    // ߳ͬ
-	QMutex& m_encodeMutex;                                    // 뻥
 	QWaitCondition& m_syncWaitCondition;                      // ߳ͬ
 	QMutex& m_syncMutex;                                      // ͻ
 	std::tuple<CCalcPtsDur, AVCodecContext*> m_pairEncodeCtx; // ĺϢ
-	bool m_bRunning{ true };                                  // Ƿ
-	bool m_bPause{ false };                                   // Ƿͣ
+	std::atomic<bool> m_bRunning{ true };                     // Ƿ
+	std::atomic<bool> m_bPause{ false };                      // Ƿͣ
 };
 
 class CLXPushThread final : public QThread {
 	Q_OBJECT
 
 public:
-	explicit CLXPushThread(AVFormatContext* pOutputFormatCtx, CircularQueue<AVPacket*>& videoPacketQueue,
-	                       CircularQueue<AVPacket*>& audioPacketQueue, QWaitCondition& videoWaitCondition, QMutex& videoMutex,
-	                       QWaitCondition& audioWaitCondition, QMutex& audioMutex, bool bPushVideo, bool bPushAudio, QObject* parent = nullptr);
+	explicit CLXPushThread(AVFormatContext* pOutputFormatCtx, CLXPacketQueue& videoPacketQueue, CLXPacketQueue& audioPacketQueue,
+	                       bool bPushVideo, bool bPushAudio, QObject* parent = nullptr);
 	~CLXPushThread() override;
 
 public:
@@ -608,16 +496,16 @@ protected:
 	void run() override;
 
 private:
-	CircularQueue<AVPacket*>& m_videoPacketQueue;   // Ƶݶ
-	CircularQueue<AVPacket*>& m_audioPacketQueue;   // Ƶݶ
-	bool m_bRunning{ true };                        // ߳Ƿִ
-	bool m_bPause{ false };                         // ߳Ƿͣ
+	// дһݰͷ
+	void writePacket(AVPacket* pPacket, const char* szType);
+
+private:
+	CLXPacketQueue& m_videoPacketQueue;             // Ƶݶ
+	CLXPacketQueue& m_audioPacketQueue;             // Ƶݶ
+	std::atomic<bool> m_bRunning{ true };           // ߳Ƿִ
+	std::atomic<bool> m_bPause{ false };            // ߳Ƿͣ
 	bool m_bPushVideo{ true };                      // ǷƵ
 	bool m_bPushAudio{ false };                     // ǷƵ
-	QWaitCondition& m_videoWaitCondition;           // Ƶȴ
-	QMutex& m_videoMutex;                           // Ƶ
-	QWaitCondition& m_audioWaitCondition;           // Ƶȴ
-	QMutex& m_audioMutex;                           // Ƶ
 	AVFormatContext* m_pOutputFormatCtx{ nullptr }; // ʽ
 };
 
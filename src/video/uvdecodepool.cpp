@@ -0,0 +1,157 @@
+﻿#include "uvdecodepool.hpp"
+
+#include "util/uvbuf.hpp"
+
+// what a pooled buffer was charged, released when the buffer is freed
+typedef struct decode_buffer_s {
+	std::shared_ptr<CUVMemoryAccount> account;
+	size_t bytes;
+} DecodeBuffer;
+
+/**
+ * class CUVDecodePool
+ */
+CUVDecodePool::CUVDecodePool() {
+	account = CUVMemoryBudget::instance().open("decode pool", [this] { reset(); });
+}
+
+CUVDecodePool::~CUVDecodePool() {
+	account->detach();
+	reset();
+}
+
+bool CUVDecodePool::install(AVCodecContext* ctx, const AVCodec* codec) {
+	if (!ctx || !codec || !(codec->capabilities & AV_CODEC_CAP_DR1)) {
+		return false;
+	}
+	ctx->opaque = this;
+	ctx->get_buffer2 = getBuffer2;
+	return true;
+}
+
+void CUVDecodePool::reset() {
+	std::lock_guard<std::mutex> locker(mutex);
+	uninit();
+}
+
+int CUVDecodePool::getBuffer2(AVCodecContext* ctx, AVFrame* frame, const int flags) {
+	const auto pool = static_cast<CUVDecodePool*>(ctx->opaque);
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+	// NOTE: hardware surfaces come from hw_frames_ctx, palette and bitstream formats are not plain planes
+	if (!pool || ctx->codec_type != AVMEDIA_TYPE_VIDEO || ctx->hw_frames_ctx || !desc ||
+	    (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+		return avcodec_default_get_buffer2(ctx, frame, flags);
+	}
+	return pool->getBuffer(ctx, frame);
+}
+
+AVBufferRef* CUVDecodePool::allocBuffer(void* opaque, const size_t size) {
+	const auto pool = static_cast<CUVDecodePool*>(opaque);
+	++pool->miss_cnt;
+	// NOTE: the decoder cannot wait for memory, buffers are always charged; the frame cache and
+	// packet queue of the same player give way instead
+	pool->account->charge(size);
+	void* data = try_aligned_alloc(size, DECODE_POOL_ALIGN, pool->huge_pages);
+	if (!data) {
+		// NOTE: av_buffer_pool_get fails and the decoder reports ENOMEM
+		pool->account->release(size);
+		return nullptr;
+	}
+	const auto holder = new DecodeBuffer{ pool->account, size };
+	AVBufferRef* buf = av_buffer_create(static_cast<uint8_t*>(data), size, freeBuffer, holder, 0);
+	if (!buf) {
+		freeBuffer(holder, static_cast<uint8_t*>(data));
+	}
+	return buf;
+}
+
+void CUVDecodePool::freeBuffer(void* opaque, uint8_t* data) {
+	const auto holder = static_cast<DecodeBuffer*>(opaque);
+	holder->account->release(holder->bytes);
+	delete holder;
+	safe_aligned_free(data);
+}
+
+int CUVDecodePool::getBuffer(AVCodecContext* ctx, AVFrame* frame) {
+	std::lock_guard<std::mutex> locker(mutex);
+	int ret = update(ctx, static_cast<AVPixelFormat>(frame->format), frame->width, frame->height);
+	if (ret < 0) {
+		return ret;
+	}
+	for (int i = 0; i < nb_planes; ++i) {
+		++get_cnt;
+		// NOTE: only the pool's allocBuffer runs under av_buffer_pool_get, opaque is this
+		frame->buf[i] = av_buffer_pool_get(pools[i]);
+		if (!frame->buf[i]) {
+			av_frame_unref(frame);
+			return AVERROR(ENOMEM);
+		}
+		frame->data[i] = frame->buf[i]->data;
+		frame->linesize[i] = linesizes[i];
+	}
+	frame->extended_data = frame->data;
+	return 0;
+}
+
+int CUVDecodePool::update(AVCodecContext* ctx, const AVPixelFormat pix_fmt, const int w, const int h) {
+	if (pools[0] && pix_fmt == pool_pix_fmt && w == pool_w && h == pool_h) {
+		return 0;
+	}
+	uninit();
+
+	// same geometry as avcodec_default_get_buffer2: codec alignment of width/height (edge emulation,
+	// macroblock rows), then widen until every linesize is a multiple of DECODE_POOL_ALIGN
+	int aligned_w = w;
+	int aligned_h = h;
+	int stride_align[AV_NUM_DATA_POINTERS]{};
+	avcodec_align_dimensions2(ctx, &aligned_w, &aligned_h, stride_align);
+
+	int ret = 0;
+	bool unaligned = false;
+	do {
+		ret = av_image_fill_linesizes(linesizes, pix_fmt, aligned_w);
+		if (ret < 0) {
+			return ret;
+		}
+		aligned_w += aligned_w & ~(aligned_w - 1);
+		unaligned = false;
+		for (const int linesize: linesizes) {
+			unaligned |= linesize % DECODE_POOL_ALIGN != 0;
+		}
+	} while (unaligned);
+
+	ptrdiff_t linesizes_ptr[DECODE_POOL_PLANES]{};
+	for (int i = 0; i < DECODE_POOL_PLANES; ++i) {
+		linesizes_ptr[i] = linesizes[i];
+	}
+	size_t sizes[DECODE_POOL_PLANES]{};
+	ret = av_image_fill_plane_sizes(sizes, pix_fmt, aligned_h, linesizes_ptr);
+	if (ret < 0) {
+		return ret;
+	}
+
+	nb_planes = 0;
+	for (int i = 0; i < DECODE_POOL_PLANES && sizes[i] > 0; ++i) {
+		pools[i] = av_buffer_pool_init2(sizes[i] + DECODE_POOL_PADDING, this, allocBuffer, nullptr);
+		if (!pools[i]) {
+			uninit();
+			return AVERROR(ENOMEM);
+		}
+		++nb_planes;
+	}
+	pool_pix_fmt = pix_fmt;
+	pool_w = w;
+	pool_h = h;
+	av_log(nullptr, AV_LOG_DEBUG, "decode pool %s %dx%d, linesize %d/%d/%d\n", av_get_pix_fmt_name(pix_fmt), w, h, linesizes[0], linesizes[1], linesizes[2]);
+	return 0;
+}
+
+void CUVDecodePool::uninit() {
+	// NOTE: buffers still held by frames return to the system when they are released
+	for (auto& pool: pools) {
+		av_buffer_pool_uninit(&pool);
+	}
+	nb_planes = 0;
+	pool_pix_fmt = AV_PIX_FMT_NONE;
+	pool_w = pool_h = 0;
+}
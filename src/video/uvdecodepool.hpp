@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "util/uvffmpeg_util.hpp"
+#include "util/uvmemorybudget.hpp"
+
+// plane start and linesize alignment: cache line, widest SIMD load, GL_UNPACK_ALIGNMENT 8
+#define DECODE_POOL_ALIGN       64
+// readable bytes behind each plane, decoders and sws may over-read the last row
+#define DECODE_POOL_PADDING     (16 + DECODE_POOL_ALIGN)
+#define DECODE_POOL_PLANES      4
+
+/**
+ * @note: 视频解码器的 get_buffer2 分配器, 解码器直接写入池化内存, 直通(passthrough)时渲染线程原样上传.
+ * 按 (pix_fmt, w, h) 每个平面建一个 AVBufferPool, 分辨率变化时重建; 平面起始与 linesize 均按 64 字节对齐,
+ * 尾部留有填充, 内存不清零, 可选透明大页(仅 Linux). 硬件帧, 调色板格式和不支持 DR1 的解码器仍用默认分配器.
+ * 帧线程会并发调用 get_buffer2, 内部加锁; 已发出的帧持有 AVBufferPool 的引用, 池重建或 reset 后依然有效.
+ * 分配的内存计入内存预算, 预算紧张时 reset 被用来裁剪空闲缓冲.
+ * NOTE: 必须比安装它的 AVCodecContext 活得久.
+ */
+class CUVDecodePool {
+public:
+	CUVDecodePool();
+	~CUVDecodePool();
+
+	CUVDecodePool(const CUVDecodePool&) = delete;
+	CUVDecodePool& operator=(const CUVDecodePool&) = delete;
+
+	void setHugePages(const bool enable) { huge_pages = enable; }
+	void setBudgetOwner(const void* owner) { account->setOwner(owner); }
+	// before avcodec_open2, false if the decoder keeps the default allocator
+	bool install(AVCodecContext* ctx, const AVCodec* codec);
+	// drop idle buffers, after the codec context is freed
+	void reset();
+
+	// per plane buffer, a frame takes one per plane
+	[[nodiscard]] int hitCount() const { return get_cnt - miss_cnt; }
+	[[nodiscard]] int missCount() const { return miss_cnt; }
+
+private:
+	static int getBuffer2(AVCodecContext* ctx, AVFrame* frame, int flags);
+	static AVBufferRef* allocBuffer(void* opaque, size_t size);
+	static void freeBuffer(void* opaque, uint8_t* data);
+
+	int getBuffer(AVCodecContext* ctx, AVFrame* frame);
+	int update(AVCodecContext* ctx, AVPixelFormat pix_fmt, int w, int h);
+	void uninit();
+
+	// NOTE: shared with the buffers, they release into it after the pool is gone
+	std::shared_ptr<CUVMemoryAccount> account;
+	std::mutex mutex;
+	AVBufferPool* pools[DECODE_POOL_PLANES]{};
+	int linesizes[DECODE_POOL_PLANES]{};
+	int nb_planes{};
+	AVPixelFormat pool_pix_fmt{ AV_PIX_FMT_NONE };
+	int pool_w{};
+	int pool_h{};
+
+	std::atomic<bool> huge_pages{ false };
+	std::atomic<int> get_cnt{ 0 };  // plane buffers handed out
+	std::atomic<int> miss_cnt{ 0 }; // plane buffers newly allocated
+};
@@ -0,0 +1,194 @@
+﻿#include "uvdecoderbudget.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * class CUVDecoderBudget
+ */
+CUVDecoderBudget& CUVDecoderBudget::instance() {
+	static CUVDecoderBudget budget;
+	return budget;
+}
+
+void CUVDecoderBudget::setTotal(const int threads) {
+	std::vector<const void*> changed;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		total_threads = std::max(threads, 0);
+		changed = rebalance();
+	}
+	notify(changed);
+}
+
+int CUVDecoderBudget::open(const void* owner, const AVCodecID codec_id, const int width, const int height, ChangeFunc on_change) {
+	std::vector<const void*> changed;
+	int threads = 1;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		auto it = decoders.find(owner);
+		if (it == decoders.end()) {
+			// NOTE: no view reported yet, assume it is shown at its own size
+			it = decoders.emplace(owner, DecoderEntry{ false, AV_CODEC_ID_NONE, 0, 0, width, height, true, 0, nullptr }).first;
+		}
+		DecoderEntry& entry = it->second;
+		entry.opened = true;
+		entry.codec_id = codec_id;
+		entry.width = width;
+		entry.height = height;
+		entry.on_change = nullptr; // the caller takes the result below, no callback for this round
+		changed = rebalance();
+		entry.on_change = std::move(on_change);
+		threads = entry.threads;
+	}
+	notify(changed);
+	return threads;
+}
+
+void CUVDecoderBudget::close(const void* owner) {
+	std::vector<const void*> changed;
+	{
+		std::lock_guard<std::mutex> notify_locker(notify_mutex);
+		std::lock_guard<std::mutex> locker(mutex);
+		const auto it = decoders.find(owner);
+		if (it == decoders.end() || !it->second.opened) {
+			return;
+		}
+		it->second.opened = false;
+		it->second.threads = 0;
+		it->second.on_change = nullptr;
+		changed = rebalance();
+	}
+	notify(changed);
+}
+
+void CUVDecoderBudget::setView(const void* owner, const int view_w, const int view_h, const bool visible) {
+	std::vector<const void*> changed;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		auto& entry = decoders.emplace(owner, DecoderEntry{ false, AV_CODEC_ID_NONE, 0, 0, 0, 0, true, 0, nullptr }).first->second;
+		if (entry.view_w == view_w && entry.view_h == view_h && entry.visible == visible) {
+			return;
+		}
+		entry.view_w = view_w;
+		entry.view_h = view_h;
+		entry.visible = visible;
+		if (!entry.opened) {
+			return;
+		}
+		changed = rebalance();
+	}
+	notify(changed);
+}
+
+void CUVDecoderBudget::remove(const void* owner) {
+	std::vector<const void*> changed;
+	{
+		std::lock_guard<std::mutex> notify_locker(notify_mutex);
+		std::lock_guard<std::mutex> locker(mutex);
+		const auto it = decoders.find(owner);
+		if (it == decoders.end()) {
+			return;
+		}
+		const bool opened = it->second.opened;
+		decoders.erase(it);
+		if (!opened) {
+			return;
+		}
+		changed = rebalance();
+	}
+	notify(changed);
+}
+
+int CUVDecoderBudget::threads(const void* owner) const {
+	std::lock_guard<std::mutex> locker(mutex);
+	const auto it = decoders.find(owner);
+	return it != decoders.end() ? it->second.threads : 0;
+}
+
+int CUVDecoderBudget::total() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return total_threads > 0 ? total_threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+double CUVDecoderBudget::weight(const DecoderEntry& entry) {
+	if (!entry.visible || entry.view_w <= 0 || entry.view_h <= 0) {
+		return 0;
+	}
+	double complexity = 1.0;
+	switch (entry.codec_id) {
+		case AV_CODEC_ID_HEVC:
+		case AV_CODEC_ID_VP9:
+		case AV_CODEC_ID_AV1:
+			complexity = 2.0;
+			break;
+		case AV_CODEC_ID_MPEG2VIDEO:
+		case AV_CODEC_ID_MPEG4:
+		case AV_CODEC_ID_MJPEG:
+			complexity = 0.5;
+			break;
+		default:
+			break;
+	}
+	const double pixels = static_cast<double>(entry.width) * entry.height;
+	// NOTE: a small tile of a big stream drops frames first, a stretched tile gets the threads
+	const double coverage = std::clamp(static_cast<double>(entry.view_w) * entry.view_h / std::max(pixels, 1.0), 0.25, 1.0);
+	return pixels * complexity * coverage;
+}
+
+int CUVDecoderBudget::maxThreads(const DecoderEntry& entry) {
+	return std::clamp(entry.height / DECODER_ROWS_PER_THREAD, 1, DECODER_MAX_THREADS);
+}
+
+std::vector<const void*> CUVDecoderBudget::rebalance() {
+	const int budget = total_threads > 0 ? total_threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	int opened = 0;
+	double weights = 0;
+	for (const auto& [owner, entry]: decoders) {
+		if (entry.opened) {
+			++opened;
+			weights += weight(entry);
+		}
+	}
+
+	// NOTE: one thread each, the rest by weight; oversubscribed budgets stay at one thread per decoder
+	const int spare = std::max(budget - opened, 0);
+	std::vector<const void*> changed;
+	for (auto& [owner, entry]: decoders) {
+		if (!entry.opened) {
+			continue;
+		}
+		int threads = 1;
+		if (spare > 0 && weights > 0) {
+			threads += static_cast<int>(spare * weight(entry) / weights);
+		}
+		threads = std::min(threads, maxThreads(entry));
+		if (threads != entry.threads) {
+			entry.threads = threads;
+			if (entry.on_change) {
+				changed.push_back(owner);
+			}
+		}
+	}
+	return changed;
+}
+
+void CUVDecoderBudget::notify(const std::vector<const void*>& changed) {
+	// NOTE: close/remove wait for this, a callback never runs for a decoder that is gone
+	std::lock_guard<std::mutex> notify_locker(notify_mutex);
+	for (const void* owner: changed) {
+		ChangeFunc on_change;
+		int threads = 0;
+		{
+			std::lock_guard<std::mutex> locker(mutex);
+			const auto it = decoders.find(owner);
+			if (it == decoders.end() || !it->second.opened || !it->second.on_change) {
+				continue;
+			}
+			on_change = it->second.on_change;
+			threads = it->second.threads;
+		}
+		on_change(threads);
+	}
+}
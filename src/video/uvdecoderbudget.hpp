@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "util/uvffmpeg_util.hpp"
+
+// upper bound of threads for one decoder, more does not scale in libavcodec
+#define DECODER_MAX_THREADS         16
+// rows of pixels per thread: 1080p => 8, 4K => 16, 480p => 3
+#define DECODER_ROWS_PER_THREAD     135
+// a running decoder is only reopened (at a keyframe) for a change of at least this many threads
+#define DECODER_REBALANCE_MIN_DELTA 2
+
+/**
+ * @note: 全局解码线程预算, 在所有软解的播放器之间分配 libavcodec 的 thread_count.
+ * 总线程数默认等于 CPU 核数; 每个解码器至少 1 个线程, 其余按负载权重分配:
+ * 像素数 x 编码复杂度(HEVC/VP9/AV1 高于 H.264) x 画面占用(小窗显示大分辨率时降低), 不可见的窗口只给 1 个.
+ * 窗口增加, 拉伸, 隐藏或关闭时重新分配, 变化的播放器收到回调, 在下一个关键帧重建解码器.
+ */
+class CUVDecoderBudget {
+public:
+	typedef std::function<void(int threads)> ChangeFunc;
+
+	static CUVDecoderBudget& instance();
+
+	// 0: hardware concurrency
+	void setTotal(int threads);
+	// a decoder is about to open, returns its thread count; on_change is called on rebalance,
+	// it must not call back into the budget
+	int open(const void* owner, AVCodecID codec_id, int width, int height, ChangeFunc on_change);
+	void close(const void* owner);
+	// size of the view showing the decoder, before or after open
+	void setView(const void* owner, int view_w, int view_h, bool visible);
+	// player destroyed
+	void remove(const void* owner);
+
+	[[nodiscard]] int threads(const void* owner) const;
+	[[nodiscard]] int total() const;
+
+private:
+	CUVDecoderBudget() = default;
+
+	typedef struct decoder_entry_s {
+		bool opened;
+		AVCodecID codec_id;
+		int width;
+		int height;
+		int view_w;
+		int view_h;
+		bool visible;
+		int threads;
+		ChangeFunc on_change;
+	} DecoderEntry;
+
+	[[nodiscard]] static double weight(const DecoderEntry& entry);
+	[[nodiscard]] static int maxThreads(const DecoderEntry& entry);
+	// recompute under the lock, returns the decoders whose count changed, notify calls them outside
+	std::vector<const void*> rebalance();
+	void notify(const std::vector<const void*>& changed);
+
+	mutable std::mutex mutex;
+	std::mutex notify_mutex;
+	std::unordered_map<const void*, DecoderEntry> decoders;
+	int total_threads{};
+};
@@ -2,11 +2,14 @@
 
 #include <QDateTime>
 #include <QDebug>
+#include <QDir>
 
 #include "conf/uvconf.hpp"
 #include "global/uvscope.hpp"
 
 #define DEFAULT_BLOCK_TIMEOUT   10  // s
+// accurate seek: stop skipping non-reference frames this close to the target
+#define AV_SEEK_NONREF_MARGIN(frame_duration) MAX(8 * (frame_duration), 200.0) // ms
 
 std::atomic_flag CUVFFPlayer::s_ffmpeg_init = ATOMIC_FLAG_INIT;
 
@@ -31,6 +34,22 @@ static void list_devices() {
 	av_dict_free(&options);
 }
 
+// pix_fmt the renderer can draw without conversion, PIX_FMT_NONE means sws_scale is required
+static int passthrough_pix_fmt(const AVPixelFormat src, const AVPixelFormat dst) {
+	if (dst == AV_PIX_FMT_YUV420P) {
+		switch (src) {
+			case AV_PIX_FMT_YUV420P:
+			case AV_PIX_FMT_YUVJ420P: return PIX_FMT_IYUV;
+			case AV_PIX_FMT_NV12: return PIX_FMT_NV12;
+			case AV_PIX_FMT_NV21: return PIX_FMT_NV21;
+			default: break;
+		}
+	} else if (dst == AV_PIX_FMT_BGR24 && src == AV_PIX_FMT_BGR24) {
+		return PIX_FMT_BGR;
+	}
+	return PIX_FMT_NONE;
+}
+
 // NOTE: avformat_open_input,av_read_frame block
 static int interrupt_callback(void* opaque) {
 	if (opaque == nullptr) return 0;
@@ -87,12 +106,32 @@ CUVFFPlayer::CUVFFPlayer() : CUVVideoPlayer(), CUVThread() {
 	video_codec_ctx = nullptr;
 	video_packet = nullptr;
 	video_frame = nullptr;
-	sws_ctx = nullptr;
 
 	block_starttime = time(nullptr);
 	block_timeout = DEFAULT_BLOCK_TIMEOUT;
 	quit = 0;
 
+	video_packet_queue.setLimits(g_confile->get<int>("packet_cache_num", "video", DEFAULT_PACKET_CACHE_NUM),
+	                             g_confile->get<int>("packet_cache_bytes", "video", DEFAULT_PACKET_CACHE_BYTES));
+	audio_packet_queue.setLimits(g_confile->get<int>("packet_cache_num", "audio", DEFAULT_PACKET_CACHE_NUM),
+	                             g_confile->get<int>("packet_cache_bytes", "audio", DEFAULT_PACKET_CACHE_BYTES));
+	// every buffer pool of this player counts against its share of the memory budget
+	frame_buf.pool->setBudgetOwner(this);
+	video_packet_queue.setBudgetOwner(this);
+	audio_packet_queue.setBudgetOwner(this);
+	decode_pool.setBudgetOwner(this);
+	use_executor = g_confile->get<bool>("executor", "video", true);
+	decode_pool_enable = g_confile->get<bool>("decode_pool", "video", true);
+	decode_pool.setHugePages(g_confile->get<bool>("decode_pool_huge_pages", "video", false));
+	video_packet_queue.setReadyCallback([this] { wakeupDecode(); });
+	frame_buf.setWritableCallback([this] { wakeupDecode(); });
+	accurate_seek = g_confile->get<bool>("accurate_seek", "video", true);
+	keyindex_enable = g_confile->get<bool>("keyindex", "video", true);
+	keyindex_dir = QString::fromStdString(g_confile->getValue("keyindex_dir", "video"));
+	if (!keyindex_dir.isEmpty() && QDir::isRelativePath(keyindex_dir)) {
+		keyindex_dir = qApp->applicationDirPath() + "/" + keyindex_dir;
+	}
+
 	if (!s_ffmpeg_init.test_and_set()) {
 		avformat_network_init();
 		avdevice_register_all();
@@ -102,13 +141,17 @@ CUVFFPlayer::CUVFFPlayer() : CUVVideoPlayer(), CUVThread() {
 
 CUVFFPlayer::~CUVFFPlayer() {
 	close();
+	CUVDecoderBudget::instance().remove(this);
 }
 
 int CUVFFPlayer::seek(const int64_t ms) {
 	if (fmt_ctx) {
+		// NOTE: av_seek_frame must run on the demux thread, here only wake it and drop the queued packets
+		seek_ms = ms;
+		seek_request = true;
+		flushPacketQueues();
 		clear_frame_cache();
-		av_log(nullptr, AV_LOG_DEBUG, "seek => %ld ms\n", ms);
-		return av_seek_frame(fmt_ctx, video_stream_index, (start_time + ms) / 1000 / (double) video_time_base_num * video_time_base_den, AVSEEK_FLAG_BACKWARD); // NOLINT
+		wakeupDemux();
 	}
 	return 0;
 }
@@ -139,80 +182,702 @@ bool CUVFFPlayer::doPrepare() {
 		}
 		return false;
 	}
+	video_packet_queue.start();
+	audio_packet_queue.start();
+	// NOTE: new serial per run, frames left in the display scheduler by the last run are dropped
+	flushPacketQueues();
+	video_packet_serial = video_packet_queue.serial();
+	audio_packet_serial = audio_packet_queue.serial();
+	video_frame_pending = false;
+	seek_request = false;
+	demux_thread = std::thread(&CUVFFPlayer::demuxLoop, this);
+	startKeyIndex();
+	if (audio_codec_ctx) {
+		audio_thread = std::thread(&CUVFFPlayer::audioLoop, this);
+		audio_out.pause(false);
+	}
 	event_callback(UVPLAYER_OPENED);
 	return true;
 }
 
 void CUVFFPlayer::doTask() {
-	char errBuf[ERRBUF_SIZE]{};
-	// loop until get a video frame
-	while (!quit) {
-		// av_init_packet(video_packet);
+	decodeStep(true);
+}
 
-		fmt_ctx->interrupt_callback.callback = interrupt_callback; // 设置中断回调
-		fmt_ctx->interrupt_callback.opaque = this;
-		block_starttime = time(nullptr);
+void CUVFFPlayer::run() {
+	if (!use_executor) {
+		CUVThread::run();
+		return;
+	}
+	// NOTE: decoding runs as a task of the shared executor, woken by the packet queue and the frame cache;
+	// this thread only opened the stream and waits to close it
+	const auto task = CUVExecutor::instance().create([this] {
+		if (status == PAUSE || quit) {
+			return false;
+		}
+		// NOTE: only steps that got a frame are timed, a step that finds nothing to do returns in microseconds
+		const auto begin = std::chrono::steady_clock::now();
+		const bool more = decodeStep(false);
+		if (more) {
+			addTaskTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+		}
+		return more;
+	}, decode_priority);
+	std::atomic_store(&decode_task, task);
+	task->wake();
+	waitStop();
+	std::atomic_store(&decode_task, std::shared_ptr<CUVExecutorTask>());
+	task->close();
+}
 
-		int ret = av_read_frame(fmt_ctx, video_packet);
-		fmt_ctx->interrupt_callback.callback = nullptr;
-		if (ret != 0) {
-			if (!quit) {
-				if (ret == AVERROR_EOF || avio_feof(fmt_ctx->pb)) {
-					eof = 1;
-					event_callback(UVPLAYER_EOF);
-				} else {
-					error = ret;
-					event_callback(UVPLAYER_ERROR);
+void CUVFFPlayer::wakeupDecode() const {
+	if (const auto task = std::atomic_load(&decode_task)) {
+		task->wake();
+	}
+}
+
+bool CUVFFPlayer::decodeStep(const bool block) {
+	char errBuf[ERRBUF_SIZE]{};
+	// NOTE: pacing is done by the display side on pts, the decoder only waits for room in the frame cache,
+	// in low latency mode it never waits, the frame cache squeezes out the older frame
+	if (!low_latency && !frame_buf.waitWritable(block ? AV_REFRESH_RATE : 0)) {
+		return false;
+	}
+	// NOTE: convert the frame the last step had no memory for first, unless a seek made it stale
+	bool retry = video_frame_pending;
+	video_frame_pending = false;
+	if (retry && video_packet_serial != video_packet_queue.serial()) {
+		av_frame_unref(video_frame);
+		retry = false;
+	}
+	// loop until get a video frame
+	while (!quit && !retry) {
+		int ret = avcodec_receive_frame(video_codec_ctx, video_frame);
+		if (ret == 0) {
+			if (video_packet_serial != video_packet_queue.serial()) {
+				// NOTE: a newer seek cancelled this one, drop what the decoder still holds
+				av_frame_unref(video_frame);
+				continue;
+			}
+			if (video_probe_verify) {
+				video_probe_verify = false;
+				if (video_frame->width != width || video_frame->height != height ||
+				    (real_decode_mode == SOFTWARE_DECODE && video_frame->format != src_pix_fmt)) {
+					probeStale("video");
 				}
-				return;
 			}
+			break;
+		}
+		if (ret == AVERROR_EOF) {
+			// decoder drained after the end-of-stream packet, wait for seek or quit in pop
+			if (!eof) {
+				eof = 1;
+				event_callback(UVPLAYER_EOF);
+			}
+		} else if (ret != AVERROR(EAGAIN)) {
+			av_strerror(ret, errBuf, ERRBUF_SIZE);
+			// NOTE: feed the next packet like EAGAIN, returning true would requeue the task at once and spin
+			av_log(nullptr, AV_LOG_ERROR, "video avcodec_receive_frame error: %s\n", errBuf);
+		}
+
+		// NOTE: block until the demux thread delivers a packet, stop() aborts the queue;
+		// the executor task returns instead and is woken by the next push
+		int serial = 0;
+		if ((block ? video_packet_queue.pop(video_packet, &serial, &video_packet_recv_time)
+		           : video_packet_queue.tryPop(video_packet, &serial, &video_packet_recv_time)) != 0) {
+			return false;
 		}
 		// NOTE: if not call av_packet_unref, memory leak.
 		defer(
 			av_packet_unref(video_packet);
 		)
 
-		if (video_packet->stream_index == video_stream_index) {
-			ret = avcodec_send_packet(video_codec_ctx, video_packet);
-			if (ret != 0) {
-				av_strerror(ret, errBuf, ERRBUF_SIZE);
-				av_log(nullptr, AV_LOG_ERROR, "send packet error: %s\n", errBuf);
-				return;
-			}
+		if (serial != video_packet_serial) {
+			// packets before a seek have been flushed, drop the frames buffered in the decoder too
+			video_packet_serial = serial;
+			avcodec_flush_buffers(video_codec_ctx);
+			// decode forward from the keyframe to the seek target, skip frames nothing refers to
+			video_seek_pending = accurate_seek && serial == seek_serial;
+			video_codec_ctx->skip_frame = video_seek_pending ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+		}
 
-			ret = avcodec_receive_frame(video_codec_ctx, video_frame);
-			if (ret != 0) {
-				if (ret != -EAGAIN) {
-					av_strerror(ret, errBuf, ERRBUF_SIZE);
-					av_log(nullptr, AV_LOG_ERROR, "video avcodec_receive_frame error: %s\n", errBuf);
-					return;
-				}
-			} else {
-				break;
+		// NOTE: the decoder thread budget changed, rebuild the decoder at a keyframe,
+		// the few frames the old one still delays are lost
+		if (video_packet->flags & AV_PKT_FLAG_KEY && decoder_threads_target != decoder_threads) {
+			rebalanceDecoder();
+		}
+
+		// empty packet means end of stream, enter draining mode
+		ret = avcodec_send_packet(video_codec_ctx, video_packet->data ? video_packet : nullptr);
+		if (ret != 0 && ret != AVERROR_EOF) {
+			av_strerror(ret, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_ERROR, "send packet error: %s\n", errBuf);
+			if (video_probe_verify && ret == AVERROR_INVALIDDATA) {
+				// NOTE: cached extradata does not describe this stream
+				probeStale("video");
 			}
 		}
 	}
 
-	if (sws_ctx) {
-		const int h = sws_scale(sws_ctx, video_frame->data, video_frame->linesize, 0, video_frame->height, data, linesize);
-		if (h <= 0 || h != video_frame->height) {
-			return;
+	// nothing is shown until the player reopens with a full probe
+	if (quit || probe_stale) {
+		return false;
+	}
+
+	if (!retry) {
+		int64_t pts = video_frame->best_effort_timestamp;
+		if (pts == AV_NOPTS_VALUE) {
+			pts = video_frame->pts;
+		}
+		if (pts != AV_NOPTS_VALUE && video_time_base_num && video_time_base_den) {
+			m_frame.ts = pts / (double) video_time_base_den * video_time_base_num * 1000; // NOLINT
+		} else {
+			m_frame.ts += static_cast<uint64_t>(frame_duration);
+		}
+		m_frame.serial = video_packet_serial;
+		m_frame.recv_time = video_packet_recv_time;
+	}
+
+	if (video_seek_pending) {
+		const auto target = static_cast<double>(seek_target);
+		if (static_cast<double>(m_frame.ts) + frame_duration <= target) {
+			// NOTE: still before the target, no conversion; decode every frame again close to it,
+			// the frame at the target may be a non-reference one
+			video_codec_ctx->skip_frame = target - static_cast<double>(m_frame.ts) > AV_SEEK_NONREF_MARGIN(frame_duration) ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+			return true;
 		}
+		video_seek_pending = false;
+		video_codec_ctx->skip_frame = AVDISCARD_DEFAULT;
+		av_log(nullptr, AV_LOG_DEBUG, "seek reached target %lld ms at %llu ms\n", static_cast<long long>(seek_target), static_cast<unsigned long long>(m_frame.ts));
+	}
+
+	// drop late frames before conversion, the display side would skip them anyway
+	if (low_latency) {
+		// NOTE: a burst after a network stall is decoded (references) but only fresh frames are shown
+		if (avsync.shouldDropAged(m_frame.recv_time, low_latency_max_age)) {
+			return true;
+		}
+	} else if (avsync.shouldDrop(static_cast<double>(m_frame.ts), m_frame.serial, frame_buf.size())) {
+		return true;
+	}
+
+	// NOTE: the stream changed resolution or format (encoder profile switch), reconfigure without reopening
+	if (video_frame->width != src_w || video_frame->height != src_h || video_frame->format != src_pix_fmt) {
+		av_log(nullptr, AV_LOG_INFO, "video changed %dx%d %s => %dx%d %s\n", src_w, src_h, av_get_pix_fmt_name(src_pix_fmt),
+		       video_frame->width, video_frame->height, av_get_pix_fmt_name(static_cast<AVPixelFormat>(video_frame->format)));
+		const int ret = setupVideoScale(video_frame->width, video_frame->height, static_cast<AVPixelFormat>(video_frame->format));
+		// NOTE: remember the geometry either way, a failed one is not retried (and logged) for every frame
+		src_w = video_frame->width;
+		src_h = video_frame->height;
+		src_pix_fmt = static_cast<AVPixelFormat>(video_frame->format);
+		scale_failed = ret != 0;
+		if (scale_failed) {
+			// the widget retries a network source and stops the others, see CUVVideoWidget::onPlayerError
+			error = ret;
+			event_callback(UVPLAYER_ERROR);
+			return true;
+		}
+		width = video_frame->width;
+		height = video_frame->height;
+	}
+	if (scale_failed) {
+		return true;
 	}
 
-	if (video_time_base_num && video_time_base_den) {
-		m_frame.ts = video_frame->pts / (double) video_time_base_den * video_time_base_num * 1000; // NOLINT
+	if (passthrough) {
+		// NOTE: hand out a reference of the decoded frame itself, released when the renderer drops it
+		const int type = passthrough_pix_fmt(static_cast<AVPixelFormat>(video_frame->format), dst_pix_fmt);
+		if (type == PIX_FMT_NONE) {
+			av_log(nullptr, AV_LOG_WARNING, "pass-through got unexpected pix_fmt %s\n", av_get_pix_fmt_name(static_cast<AVPixelFormat>(video_frame->format)));
+			return true;
+		}
+		AVFrame* ref = av_frame_clone(video_frame);
+		if (!ref) {
+			return true;
+		}
+		m_frame.unref();
+		m_frame.buf_ref = std::shared_ptr<AVFrame>(ref, [](AVFrame* p) { av_frame_free(&p); });
+		m_frame.type = type;
+		m_frame.w = ref->width;
+		m_frame.h = ref->height;
+		for (int i = 0; i < 4; ++i) {
+			m_frame.data[i] = ref->data[i];
+			m_frame.linesize[i] = ref->linesize[i];
+		}
+	} else if (converter.valid()) {
+		// NOTE: convert straight into pooled memory, frame_buf and the renderer share it without copying
+		// over the memory budget the executor step does not wait for a buffer: keep the frame, the next pop wakes the task
+		if (alloc_frame(&m_frame, frame_len, block) != 0) {
+			video_frame_pending = true;
+			return false;
+		}
+		data[0] = reinterpret_cast<uint8_t*>(m_frame.buf.base);
+		if (dst_pix_fmt == AV_PIX_FMT_YUV420P) {
+			const int y_size = m_frame.w * m_frame.h;
+			data[1] = data[0] + y_size;
+			data[2] = data[1] + y_size / 4;
+		}
+		const int h = converter.convert(video_frame, data, linesize);
+		if (h <= 0 || h != video_frame->height) {
+			return true;
+		}
 	}
 
 	push_frame(&m_frame);
+	return true;
+}
+
+int CUVFFPlayer::setupVideoScale(const int sw, const int sh, const AVPixelFormat pix_fmt) {
+	// pass-through: the renderer draws the decoder's own planes with their linesize, no sws_scale, no width alignment
+	const bool pass = passthrough_enable && passthrough_pix_fmt(pix_fmt, dst_pix_fmt) != PIX_FMT_NONE;
+	const int dw = pass ? sw : sw >> 2 << 2; // align = 4
+	const int dh = sh;
+	av_log(nullptr, AV_LOG_DEBUG, "dw = %d, dh = %d, dst_pix_fmt = %d, : %s\n", dw, dh, dst_pix_fmt, av_get_pix_fmt_name(dst_pix_fmt));
+
+	if (pass) {
+		av_log(nullptr, AV_LOG_INFO, "pass-through %s, skip sws_scale\n", av_get_pix_fmt_name(pix_fmt));
+		converter.reset();
+	} else if (!converter.init(sw, sh, pix_fmt, dw, dh, dst_pix_fmt, SWS_BICUBIC, convert_threads)) {
+		// NOTE: 4K/8K conversion alone overruns the frame interval on one core, swscale slices it across threads;
+		// contexts come from the process-wide CUVSwsCache
+		av_log(nullptr, AV_LOG_ERROR, "sws_getContext failed\n");
+		return -50;
+	}
+
+	// 确保缓冲区大小正确, 内存在 doTask 中按帧从 frame_buf 的内存池申请, 尺寸变化时池丢弃旧缓冲
+	if (dst_pix_fmt == AV_PIX_FMT_YUV420P) {
+		const int y_size = dw * dh;
+		m_frame.type = PIX_FMT_IYUV;
+		m_frame.bpp = 12;
+		frame_len = y_size * 3 / 2;
+
+		linesize[0] = dw;
+		linesize[1] = linesize[2] = dw / 2;
+	} else if (dst_pix_fmt == AV_PIX_FMT_BGR24) {
+		m_frame.type = PIX_FMT_BGR;
+		m_frame.bpp = 24;
+		frame_len = dw * dh * 3;
+
+		linesize[0] = dw * 3;
+	} else {
+		av_log(nullptr, AV_LOG_ERROR, "Unsupported pixel format\n");
+		return -51;
+	}
+
+	if (use_source_aspect_ratio && (sw != src_w || sh != src_h)) {
+		aspect_ratio_t aspect_ratio;
+		aspect_ratio.type = ASPECT_ORIGINAL_RATIO;
+		aspect_ratio.w = sw;
+		aspect_ratio.h = sh;
+		emit videoAspectRatio(aspect_ratio);
+	}
+	passthrough = pass;
+	src_pix_fmt = pix_fmt;
+	src_w = sw;
+	src_h = sh;
+	m_frame.w = dw;
+	m_frame.h = dh;
+	return 0;
+}
+
+void CUVFFPlayer::setupVideoDecoder(AVCodecContext* ctx, const AVCodec* codec, const int threads) {
+	if (low_latency) {
+		// NOTE: frame threading delays output by thread_count frames, slice threading does not
+		ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+		ctx->thread_type = FF_THREAD_SLICE;
+	} else {
+		ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	}
+	if (threads > 0) {
+		ctx->thread_count = threads;
+	}
+	if (decode_pool_enable && !decode_pool.install(ctx, codec)) {
+		av_log(nullptr, AV_LOG_DEBUG, "decoder %s keeps its own buffers\n", codec->name);
+	}
+}
+
+void CUVFFPlayer::rebalanceDecoder() {
+	const int current = decoder_threads;
+	const int target = decoder_threads_target;
+	if (current <= 0 || target <= 0 || std::abs(target - current) < DECODER_REBALANCE_MIN_DELTA) {
+		return;
+	}
+	const AVCodec* codec = video_codec_ctx->codec;
+	AVCodecContext* ctx = avcodec_alloc_context3(codec);
+	if (!ctx) {
+		return;
+	}
+	int ret = avcodec_parameters_to_context(ctx, fmt_ctx->streams[video_stream_index]->codecpar);
+	if (ret >= 0) {
+		setupVideoDecoder(ctx, codec, target);
+		ctx->skip_frame = video_codec_ctx->skip_frame;
+		// the new decoder gets the same options the stream was opened with
+		AVDictionary* opts = nullptr;
+		av_dict_copy(&opts, codec_opts, 0);
+		ret = avcodec_open2(ctx, codec, &opts);
+		av_dict_free(&opts);
+	}
+	if (ret < 0) {
+		// NOTE: keep the running decoder, do not retry at every keyframe
+		avcodec_free_context(&ctx);
+		decoder_threads_target = current;
+		return;
+	}
+	avcodec_free_context(&video_codec_ctx);
+	video_codec_ctx = ctx;
+	decoder_threads = target;
+	av_log(nullptr, AV_LOG_INFO, "decoder threads %d => %d\n", current, target);
 }
 
 bool CUVFFPlayer::doFinish() {
+	quit = 1;
+	video_packet_queue.abort();
+	audio_packet_queue.abort();
+	wakeupDemux();
+	if (demux_thread.joinable()) {
+		demux_thread.join();
+	}
+	if (audio_thread.joinable()) {
+		audio_thread.join();
+	}
+	stopKeyIndex();
 	const int ret = close();
 	event_callback(UVPLAYER_CLOSED);
 	return !ret;
 }
 
+void CUVFFPlayer::wakeupDemux() {
+	// NOTE: lock before notify, or the wakeup may be lost between predicate check and wait
+	std::lock_guard<std::mutex> locker(demux_mutex);
+	demux_cond.notify_all();
+}
+
+int CUVFFPlayer::seekFile(const int64_t ms) {
+	const int64_t target = start_time + ms;
+	int64_t key_pts = 0;
+	if (const int64_t pos = keyindex.find(target, &key_pts); pos >= 0) {
+		// NOTE: jump straight to the keyframe, no timestamp bisection over the file
+		if (av_seek_frame(fmt_ctx, -1, pos, AVSEEK_FLAG_BYTE) >= 0) {
+			av_log(nullptr, AV_LOG_DEBUG, "seek by keyframe index => %lld ms @ %lld\n", static_cast<long long>(key_pts), static_cast<long long>(pos));
+			return 0;
+		}
+	}
+	return av_seek_frame(fmt_ctx, video_stream_index, target / 1000 / (double) video_time_base_num * video_time_base_den, AVSEEK_FLAG_BACKWARD); // NOLINT
+}
+
+/**
+ * @note: 关键帧索引只对可按字节定位的文件格式(TS/PS/FLV 等)有意义, MP4 的 moov 本身就是完整索引.
+ * 已有有效索引文件时直接 map, 否则在后台线程用独立的 AVFormatContext 扫描生成并保存.
+ */
+void CUVFFPlayer::startKeyIndex() {
+	if (!keyindex_enable || media.type != MEDIA_TYPE_FILE || !fmt_ctx || (fmt_ctx->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+		return;
+	}
+	if (keyindex.load(media.src, keyindex_dir)) {
+		av_log(nullptr, AV_LOG_INFO, "keyframe index loaded: %zu entries\n", keyindex.count());
+		return;
+	}
+	keyindex_cancel = false;
+	keyindex_thread = std::thread([this] {
+		const int64_t begin = av_gettime_relative();
+		if (const int ret = keyindex.build(media.src, keyindex_cancel); ret != 0) {
+			av_log(nullptr, AV_LOG_WARNING, "keyframe index build failed: %d\n", ret);
+			return;
+		}
+		const bool saved = keyindex.save(media.src, keyindex_dir);
+		av_log(nullptr, AV_LOG_INFO, "keyframe index built: %zu entries in %lld ms, saved = %d\n",
+		       keyindex.count(), static_cast<long long>((av_gettime_relative() - begin) / 1000), saved);
+	});
+}
+
+void CUVFFPlayer::stopKeyIndex() {
+	keyindex_cancel = true;
+	if (keyindex_thread.joinable()) {
+		keyindex_thread.join();
+	}
+	keyindex.close();
+}
+
+void CUVFFPlayer::probeStale(const char* what) {
+	if (probe_stale.exchange(true)) {
+		return;
+	}
+	av_log(nullptr, AV_LOG_WARNING, "%s stream differs from the cached probe, reopen with a full probe\n", what);
+	CUVProbeCache::instance().remove(probe_key);
+	event_callback(UVPLAYER_PROBE_STALE);
+}
+
+void CUVFFPlayer::flushPacketQueues() {
+	// NOTE: always flushed together so both serials stay equal, clocks and frames are compared by serial
+	video_packet_queue.flush();
+	audio_packet_queue.flush();
+	avsync.setSerial(video_packet_queue.serial());
+}
+
+/**
+ * @note: 解复用线程, 只负责 av_read_frame 和 seek, 视频包送入 video_packet_queue.
+ * 所有队列都 enough 时才等待(ffplay 的做法), 一路队列满而另一路饿着时继续读, 满的那路暂时超出限制;
+ * 阻塞在一路的 push 上会让另一路的解码和音频主时钟停住, 互相等待.
+ */
+void CUVFFPlayer::demuxLoop() {
+	char errBuf[ERRBUF_SIZE]{};
+	bool stream_end = false;
+	while (!quit) {
+		if (seek_request.exchange(false)) {
+			const int64_t ms = seek_ms;
+			av_log(nullptr, AV_LOG_DEBUG, "seek => %lld ms\n", static_cast<long long>(ms));
+			const int ret = seekFile(ms);
+			if (ret < 0) {
+				av_strerror(ret, errBuf, ERRBUF_SIZE);
+				av_log(nullptr, AV_LOG_ERROR, "seek error: %s\n", errBuf);
+			}
+			flushPacketQueues();
+			// NOTE: set before any packet of the new serial is pushed, the decoders read it on the serial change
+			seek_target = start_time + ms;
+			seek_serial = video_packet_queue.serial();
+			clear_frame_cache();
+			stream_end = false;
+			eof = 0;
+		}
+
+		if (stream_end) {
+			// nothing more to read, sleep until seek or quit
+			std::unique_lock<std::mutex> locker(demux_mutex);
+			demux_cond.wait(locker, [this] { return quit || seek_request; });
+			continue;
+		}
+
+		if (video_packet_queue.enough() && (!audio_codec_ctx || audio_packet_queue.enough())) {
+			std::unique_lock<std::mutex> locker(demux_mutex);
+			demux_cond.wait_for(locker, std::chrono::milliseconds(PACKET_QUEUE_ENOUGH_WAIT_MS), [this] { return quit || seek_request; });
+			continue;
+		}
+
+		fmt_ctx->interrupt_callback.callback = interrupt_callback; // 设置中断回调
+		fmt_ctx->interrupt_callback.opaque = this;
+		block_starttime = time(nullptr);
+
+		const int ret = av_read_frame(fmt_ctx, demux_packet);
+		fmt_ctx->interrupt_callback.callback = nullptr;
+		if (ret != 0) {
+			if (quit) {
+				break;
+			}
+			if (ret == AVERROR_EOF || avio_feof(fmt_ctx->pb)) {
+				// NOTE: EOF is reported by the decode thread after the last frame, here only push an empty packet
+				av_packet_unref(demux_packet);
+				video_packet_queue.push(demux_packet);
+				if (audio_codec_ctx) {
+					audio_packet_queue.push(demux_packet);
+				}
+			} else {
+				error = ret;
+				event_callback(UVPLAYER_ERROR);
+			}
+			stream_end = true;
+			continue;
+		}
+
+		if (demux_packet->stream_index == video_stream_index) {
+			video_packet_queue.push(demux_packet);
+		} else if (audio_codec_ctx && demux_packet->stream_index == audio_stream_index) {
+			audio_packet_queue.push(demux_packet);
+		} else {
+			av_packet_unref(demux_packet);
+		}
+	}
+}
+
+/**
+ * @note: 音频解码线程, 解码后用 swresample 转成 S16 写入 audio_out 的环形缓冲区, 由 SDL 回调取走.
+ * 缓冲区满时等待回调消费, 播放速度即由声卡决定, 音频时钟在回调中更新.
+ */
+void CUVFFPlayer::audioLoop() {
+	char errBuf[ERRBUF_SIZE]{};
+	while (!quit) {
+		int ret = avcodec_receive_frame(audio_codec_ctx, audio_frame);
+		if (ret == 0) {
+			if (audio_probe_verify) {
+				audio_probe_verify = false;
+				if (audio_frame->sample_rate != audio_src_rate || audio_frame->channels != audio_src_channels || audio_frame->format != audio_src_fmt) {
+					probeStale("audio");
+				}
+			}
+			if (!probe_stale) {
+				writeAudio(audio_frame);
+			}
+			av_frame_unref(audio_frame);
+			continue;
+		}
+		if (ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+			av_strerror(ret, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_ERROR, "audio avcodec_receive_frame error: %s\n", errBuf);
+		}
+
+		int serial = 0;
+		if (audio_packet_queue.pop(audio_packet, &serial) != 0) {
+			break;
+		}
+		defer(
+			av_packet_unref(audio_packet);
+		)
+
+		if (serial != audio_packet_serial) {
+			audio_packet_serial = serial;
+			audio_seek_pending = accurate_seek && serial == seek_serial;
+			avcodec_flush_buffers(audio_codec_ctx);
+			// drop the samples buffered in swr and in the ring
+			swr_init(swr_ctx);
+			audio_out.flush();
+			audio_next_pts = NAN;
+		}
+
+		ret = avcodec_send_packet(audio_codec_ctx, audio_packet->data ? audio_packet : nullptr);
+		if (ret != 0 && ret != AVERROR_EOF) {
+			av_strerror(ret, errBuf, ERRBUF_SIZE);
+			av_log(nullptr, AV_LOG_ERROR, "audio send packet error: %s\n", errBuf);
+		}
+	}
+}
+
+void CUVFFPlayer::writeAudio(const AVFrame* frame) {
+	double pts = audio_next_pts;
+	const int64_t ts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+	if (ts != AV_NOPTS_VALUE && audio_time_base_num && audio_time_base_den) {
+		pts = ts / (double) audio_time_base_den * audio_time_base_num * 1000; // NOLINT
+	}
+	if (std::isnan(pts)) {
+		pts = 0;
+	}
+
+	if (audio_seek_pending) {
+		const double end_pts = pts + frame->nb_samples * 1000.0 / frame->sample_rate;
+		if (end_pts <= static_cast<double>(seek_target)) {
+			// before the seek target, not played
+			audio_next_pts = end_pts;
+			return;
+		}
+		audio_seek_pending = false;
+	}
+
+	// NOTE: convert in chunks of audio_buf, a large frame never reallocates the output buffer,
+	// later rounds pass 0 input samples to fetch what swr buffered (NULL input would flush it as end of stream)
+	const auto in = const_cast<const uint8_t**>(frame->extended_data);
+	int in_samples = frame->nb_samples;
+	while (!quit) {
+		const int out_samples = swr_convert(swr_ctx, &audio_buf, audio_buf_samples, in, in_samples);
+		in_samples = 0;
+		if (out_samples <= 0) {
+			break;
+		}
+
+		const size_t len = static_cast<size_t>(out_samples) * audio_out.frame_size;
+		pts += out_samples * 1000.0 / audio_out.sample_rate;
+		size_t written = 0;
+		while (written < len && !quit && audio_packet_serial == audio_packet_queue.serial()) {
+			if (!audio_out.waitWritable(MIN(len - written, audio_out.bytes_per_sec / 10), AV_REFRESH_RATE * 10)) {
+				continue;
+			}
+			written += audio_out.write(audio_buf + written, len - written, pts, audio_packet_serial);
+		}
+		if (out_samples < audio_buf_samples) {
+			break;
+		}
+	}
+	audio_next_pts = pts;
+}
+
+int CUVFFPlayer::openAudio() {
+	char errBuf[ERRBUF_SIZE]{};
+	AVStream* audio_stream = fmt_ctx->streams[audio_stream_index];
+	audio_time_base_num = audio_stream->time_base.num;
+	audio_time_base_den = audio_stream->time_base.den;
+	AVCodecParameters* codec_param = audio_stream->codecpar;
+
+#ifdef FFMPEG_VERSION_GTE_5_0_0
+	const AVCodec* codec = avcodec_find_decoder(codec_param->codec_id);
+#else
+	AVCodec* codec = avcodec_find_decoder(codec_param->codec_id);
+#endif
+	if (!codec) {
+		av_log(nullptr, AV_LOG_ERROR, "Can not find audio decoder %s\n", avcodec_get_name(codec_param->codec_id));
+		return -30;
+	}
+
+	int ret = 0;
+	audio_codec_ctx = avcodec_alloc_context3(codec);
+	if (!audio_codec_ctx) {
+		av_log(nullptr, AV_LOG_ERROR, "audio avcodec_alloc_context3 error\n");
+		return -40;
+	}
+	defer(
+		if (ret != 0) {
+		// NOTE: the video plays on without audio, nothing opened here may stay behind
+		audio_out.close();
+		if (swr_ctx) {
+		swr_free(&swr_ctx);
+		swr_ctx = nullptr;
+		}
+		if (audio_buf) {
+		av_freep(&audio_buf);
+		audio_buf = nullptr;
+		}
+		avcodec_free_context(&audio_codec_ctx);
+		audio_codec_ctx = nullptr;
+		}
+	)
+
+	ret = avcodec_parameters_to_context(audio_codec_ctx, codec_param);
+	if (ret != 0) {
+		av_strerror(ret, errBuf, ERRBUF_SIZE);
+		av_log(nullptr, AV_LOG_ERROR, "audio avcodec_parameters_to_context error: %s\n", errBuf);
+		return ret;
+	}
+
+	ret = avcodec_open2(audio_codec_ctx, codec, nullptr);
+	if (ret != 0) {
+		av_strerror(ret, errBuf, ERRBUF_SIZE);
+		av_log(nullptr, AV_LOG_ERROR, "Can not open audio codec error: %s\n", errBuf);
+		return ret;
+	}
+	audio_stream->discard = AVDISCARD_DEFAULT;
+
+	ret = audio_out.open(audio_codec_ctx->sample_rate, audio_codec_ctx->channels, &avsync.audclk);
+	if (ret != 0) {
+		return ret;
+	}
+
+	audio_src_rate = audio_codec_ctx->sample_rate;
+	audio_src_channels = audio_codec_ctx->channels;
+	audio_src_fmt = audio_codec_ctx->sample_fmt;
+	const int64_t in_layout = audio_codec_ctx->channel_layout ? static_cast<int64_t>(audio_codec_ctx->channel_layout) : av_get_default_channel_layout(audio_codec_ctx->channels);
+	swr_ctx = swr_alloc_set_opts(nullptr,
+	                             av_get_default_channel_layout(audio_out.channels), AV_SAMPLE_FMT_S16, audio_out.sample_rate,
+	                             in_layout, audio_codec_ctx->sample_fmt, audio_codec_ctx->sample_rate,
+	                             0, nullptr);
+	if (!swr_ctx || swr_init(swr_ctx) < 0) {
+		av_log(nullptr, AV_LOG_ERROR, "swr_init failed\n");
+		ret = -50;
+		return ret;
+	}
+
+	// about 100ms of output per chunk
+	audio_buf_samples = MAX(audio_out.sample_rate / 10, 1024);
+	ret = av_samples_alloc(&audio_buf, nullptr, audio_out.channels, audio_buf_samples, AV_SAMPLE_FMT_S16, 0);
+	if (ret < 0) {
+		av_log(nullptr, AV_LOG_ERROR, "av_samples_alloc failed\n");
+		return ret;
+	}
+	ret = 0;
+
+	audio_packet = av_packet_alloc();
+	audio_frame = av_frame_alloc();
+	audio_next_pts = NAN;
+	avsync.setHasAudio(true);
+	av_log(nullptr, AV_LOG_INFO, "audio: %s %d Hz %d ch => S16 %d Hz %d ch\n", codec->name, audio_codec_ctx->sample_rate, audio_codec_ctx->channels, audio_out.sample_rate, audio_out.channels);
+	return ret;
+}
+
 int CUVFFPlayer::open() {
 	char errBuf[ERRBUF_SIZE]{};
 	std::string ifile;
@@ -275,6 +940,19 @@ int CUVFFPlayer::open() {
 		}
 		av_dict_set(&fmt_opts, "stimeout", "5000000", 0); // us
 	}
+	low_latency = media.low_latency && media.type != MEDIA_TYPE_FILE;
+	if (low_latency) {
+		// NOTE: no demux side buffering and a short probe, the first frame shows up as soon as possible
+		av_dict_set(&fmt_opts, "fflags", "nobuffer", 0);
+		av_dict_set_int(&fmt_opts, "probesize", g_confile->get<int>("low_latency_probesize", "video", 32768), 0);
+		av_dict_set_int(&fmt_opts, "analyzeduration", g_confile->get<int>("low_latency_analyzeduration", "video", 100000), 0); // us
+		if (media.type == MEDIA_TYPE_NETWORK) {
+			av_dict_set(&fmt_opts, "max_delay", "0", 0);
+			av_dict_set(&fmt_opts, "reorder_queue_size", "0", 0);
+		}
+		low_latency_max_age = g_confile->get<int>("low_latency_max_age", "video", 150);
+		av_log(nullptr, AV_LOG_INFO, "low latency mode, max frame age %.0f ms\n", low_latency_max_age);
+	}
 	av_dict_set(&fmt_opts, "buffer_size", "2048000", 0);
 	fmt_ctx->interrupt_callback.callback = interrupt_callback;
 	fmt_ctx->interrupt_callback.opaque = this;
@@ -285,19 +963,39 @@ int CUVFFPlayer::open() {
 		av_log(nullptr, AV_LOG_ERROR, "open input error: %s\n", errBuf);
 		return ret;
 	}
-	fmt_ctx->interrupt_callback.callback = nullptr;
 	defer(
 		if (ret != 0 && fmt_ctx) {
 		avformat_close_input(&fmt_ctx);
 		}
 	)
 
+	// NOTE: restart/retry of the same source skips most of the probe, the first frames verify the cached parameters
+	probe_key.clear();
+	probe_cached = false;
+	probe_stale = false;
+	if (g_confile->get<bool>("probe_cache", "video", true)) {
+		CUVProbeCache::instance().setCapacity(g_confile->get<int>("probe_cache_num", "video", DEFAULT_PROBE_CACHE_NUM));
+		probe_key = CUVProbeCache::key(ifile, fmt_ctx);
+		probe_cached = CUVProbeCache::instance().apply(probe_key, fmt_ctx);
+	}
+	const int64_t probe_begin = av_gettime_relative();
+	// NOTE: probing reads the stream too, keep the interrupt callback (quit, block_timeout) until it returns
+	block_starttime = time(nullptr);
 	ret = avformat_find_stream_info(fmt_ctx, nullptr);
+	fmt_ctx->interrupt_callback.callback = nullptr;
 	if (ret != 0) {
 		av_strerror(ret, errBuf, ERRBUF_SIZE);
 		av_log(nullptr, AV_LOG_ERROR, "find stream info error: %s\n", errBuf);
+		if (probe_cached) {
+			CUVProbeCache::instance().remove(probe_key);
+		}
 		return ret;
 	}
+	av_log(nullptr, AV_LOG_INFO, "find stream info%s: %lld ms\n", probe_cached ? " (cached)" : "", static_cast<long long>((av_gettime_relative() - probe_begin) / 1000));
+	if (!probe_cached) {
+		CUVProbeCache::instance().store(probe_key, fmt_ctx);
+	}
+	video_probe_verify = audio_probe_verify = probe_cached;
 	av_log(nullptr, AV_LOG_DEBUG, "stream_num: %d\n", fmt_ctx->nb_streams);
 
 	video_stream_index = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
@@ -381,9 +1079,28 @@ try_software_decode:
 		if (video_codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO || video_codec_ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
 			av_dict_set(&codec_opts, "refcounted_frames", "1", 0);
 		}
-
-		ret = avcodec_open2(video_codec_ctx, codec, &codec_opts);
+		// NOTE: hardware decoders ignore thread_count, software ones share the global decoder thread budget
+		int threads = 0;
+		decoder_threads_target = 0;
+		if (real_decode_mode == SOFTWARE_DECODE) {
+			threads = CUVDecoderBudget::instance().open(this, codec_param->codec_id, codec_param->width, codec_param->height, [this](const int n) {
+				decoder_threads_target = n;
+			});
+			// a rebalance that already reached the callback wins
+			int none = 0;
+			decoder_threads_target.compare_exchange_strong(none, threads);
+		}
+		setupVideoDecoder(video_codec_ctx, codec, threads);
+
+		// NOTE: avcodec_open2 leaves only the unused entries in the dictionary, keep codec_opts whole for rebalanceDecoder
+		AVDictionary* opts = nullptr;
+		av_dict_copy(&opts, codec_opts, 0);
+		ret = avcodec_open2(video_codec_ctx, codec, &opts);
+		av_dict_free(&opts);
+		decoder_threads = ret == 0 ? threads : 0;
 		if (ret != 0) {
+			CUVDecoderBudget::instance().close(this);
+			decoder_threads_target = 0;
 			if (real_decode_mode != SOFTWARE_DECODE) {
 				av_log(nullptr, AV_LOG_WARNING, "Can not open hardware codec error: %d, try software codec.\n", ret);
 				goto try_software_decode;
@@ -396,25 +1113,15 @@ try_software_decode:
 
 		const int sw = video_codec_ctx->width;
 		const int sh = video_codec_ctx->height;
-		if (g_confile->get<bool>("use_source_aspect_ratio", "video")) {
-			aspect_ratio_t aspect_ratio;
-			aspect_ratio.type = ASPECT_ORIGINAL_RATIO;
-			aspect_ratio.w = sw;
-			aspect_ratio.h = sh;
-			emit videoAspectRatio(aspect_ratio);
-		}
+		const AVPixelFormat pix_fmt = video_codec_ctx->pix_fmt;
 
-		src_pix_fmt = video_codec_ctx->pix_fmt;
-
-		av_log(nullptr, AV_LOG_DEBUG, "sw = %d, sh = %d, src_pix_fmt = %d : %s\n", sw, sh, src_pix_fmt, av_get_pix_fmt_name(src_pix_fmt));
-		if (sw <= 0 || sh <= 0 || src_pix_fmt == AV_PIX_FMT_NONE) {
+		av_log(nullptr, AV_LOG_DEBUG, "sw = %d, sh = %d, src_pix_fmt = %d : %s\n", sw, sh, pix_fmt, av_get_pix_fmt_name(pix_fmt));
+		if (sw <= 0 || sh <= 0 || pix_fmt == AV_PIX_FMT_NONE) {
 			av_log(nullptr, AV_LOG_ERROR, "Codec parameters wrong!\n");
 			ret = -45;
 			return ret;
 		}
 
-		const int dw = sw >> 2 << 2; // align = 4
-		const int dh = sh;
 		dst_pix_fmt = AV_PIX_FMT_YUV420P;
 		const std::string str = g_confile->getValue("dst_pix_fmt", "video");
 		if (!str.empty()) {
@@ -424,52 +1131,35 @@ try_software_decode:
 				dst_pix_fmt = AV_PIX_FMT_BGR24;
 			}
 		}
-		av_log(nullptr, AV_LOG_DEBUG, "dw = %d, dh = %d, dst_pix_fmt = %d, : %s\n", dw, dh, dst_pix_fmt, av_get_pix_fmt_name(dst_pix_fmt));
 
-		sws_ctx = sws_getContext(sw, sh, src_pix_fmt, dw, dh, dst_pix_fmt, SWS_BICUBIC, nullptr, nullptr, nullptr);
-		if (!sws_ctx) {
-			av_log(nullptr, AV_LOG_ERROR, "sws_getContext failed\n");
-			ret = -50;
+		passthrough_enable = g_confile->get<bool>("passthrough", "video", true);
+		use_source_aspect_ratio = g_confile->get<bool>("use_source_aspect_ratio", "video");
+		src_w = src_h = 0;
+		scale_failed = false;
+		ret = setupVideoScale(sw, sh, pix_fmt);
+		if (ret != 0) {
 			return ret;
 		}
 
 		video_packet = av_packet_alloc();
 		video_frame = av_frame_alloc();
+		demux_packet = av_packet_alloc();
 
-		m_frame.w = dw;
-		m_frame.h = dh;
-		// ARGB
-		m_frame.buf.resize(dw * dh * 4);
-
-		// 确保缓冲区大小正确
-		if (dst_pix_fmt == AV_PIX_FMT_YUV420P) {
-			const int y_size = dw * dh;
-			m_frame.type = PIX_FMT_IYUV;
-			m_frame.bpp = 12;
-			m_frame.buf.len = y_size * 3 / 2;
-
-			data[0] = reinterpret_cast<uint8_t*>(m_frame.buf.base);
-			data[1] = data[0] + y_size;
-			data[2] = data[1] + y_size / 4;
-			linesize[0] = dw;
-			linesize[1] = linesize[2] = dw / 2;
-		} else if (dst_pix_fmt == AV_PIX_FMT_BGR24) {
-			m_frame.type = PIX_FMT_BGR;
-			m_frame.bpp = 24;
-			m_frame.buf.len = dw * dh * 3;
-
-			data[0] = reinterpret_cast<uint8_t*>(m_frame.buf.base);
-			linesize[0] = dw * 3;
+		// HVideoPlayer member vars
+		// NOTE: fps only gives the fallback frame duration, 29.97/59.94 and VFR streams are paced by pts
+		if (const AVRational frame_rate = av_guess_frame_rate(fmt_ctx, video_stream, nullptr); frame_rate.num && frame_rate.den) {
+			fps = static_cast<int>(lround(av_q2d(frame_rate)));
+			frame_duration = 1000 / av_q2d(frame_rate);
 		} else {
-			av_log(nullptr, AV_LOG_ERROR, "Unsupported pixel format\n");
-			ret = -51;
-			return ret;
+			frame_duration = 1000.0 / (fps > 0 ? fps : DEFAULT_FPS);
 		}
-
-		// HVideoPlayer member vars
-		if (video_stream->avg_frame_rate.num && video_stream->avg_frame_rate.den) {
-			fps = video_stream->avg_frame_rate.num / video_stream->avg_frame_rate.den;
+		avsync.setFrameDuration(frame_duration);
+		if (low_latency) {
+			// the newest frame replaces the queued one, shown on the next refresh regardless of pts
+			set_frame_cache(1);
+			avsync.setMaster(UVSYNC_VIDEO_MASTER);
 		}
+		avsync.setLowLatency(low_latency);
 		width = sw;
 		height = sh;
 		duration = 0;
@@ -491,56 +1181,21 @@ try_software_decode:
 				start_time = 0;
 			}
 		}
-		CUVThread::setSleepPolicy(CUVThread::SLEEP_UNTIL, 1000 / fps);
+		CUVThread::setSleepPolicy(CUVThread::NO_SLEEP);
 	} else {
 		av_log(nullptr, AV_LOG_ERROR, "Can not find video stream.\n");
 		ret = -20;
 		return ret;
 	}
 
-#if 0
-    // 初始化音频解码器
-    if (audio_stream_index >= 0) {
-        AVStream* audio_stream = fmt_ctx->streams[audio_stream_index];
-        AVCodecParameters* audio_codec_param = audio_stream->codecpar;
-        AVCodec* audio_codec = avcodec_find_decoder(audio_codec_param->codec_id);
-        if (!audio_codec) {
-            std::cerr << "Can not find audio codec." << std::endl;
-            return -30;
-        }
-
-        audio_codec_ctx = avcodec_alloc_context3(audio_codec);
-        if (!audio_codec_ctx) {
-            std::cerr << "avcodec_alloc_context3 failed." << std::endl;
-            ret = -40;
-            return ret;
-        }
-
-        defer(
-            if (ret != 0 && audio_codec_ctx) {
-            avcodec_free_context(&audio_codec_ctx);
-            audio_codec_ctx = nullptr;
-            }
-        )
-
-        ret = avcodec_parameters_to_context(audio_codec_ctx, audio_codec_param);
-        if (ret != 0) {
-            std::cerr << "avcodec_parameters_to_context failed." << std::endl;
-            return ret;
-        }
-
-        ret = avcodec_open2(audio_codec_ctx, audio_codec, nullptr);
-        if (ret != 0) {
-            std::cerr << "avcodec_open2 failed." << std::endl;
-            return ret;
-        }
-
-        audio_stream->discard = AVDISCARD_DEFAULT;
-        std::cout << "Audio stream initialized." << std::endl;
-    } else {
-        std::cerr << "Can not find audio stream." << std::endl;
-    }
+	// NOTE: audio is optional, play video only if it can not be opened
+	if (audio_stream_index >= 0 && g_confile->get<bool>("enable", "audio", true)) {
+		if (openAudio() != 0) {
+			av_log(nullptr, AV_LOG_WARNING, "open audio failed, play without audio\n");
+		}
+	}
 
+#if 0
     // 初始化字幕解码器
     if (subtitle_stream_index >= 0) {
         AVStream* subtitle_stream = fmt_ctx->streams[subtitle_stream_index];
@@ -611,6 +1266,9 @@ int CUVFFPlayer::close() {
 		avcodec_free_context(&video_codec_ctx);
 		video_codec_ctx = nullptr;
 	}
+	CUVDecoderBudget::instance().close(this);
+	decoder_threads = 0;
+	decode_pool.reset();
 
 	if (video_frame) {
 		av_frame_unref(video_frame);
@@ -624,25 +1282,44 @@ int CUVFFPlayer::close() {
 		video_packet = nullptr;
 	}
 
-#if 0
-    if (audio_codec_ctx) {
-        nRet = avcodec_close(audio_codec_ctx);
-        avcodec_free_context(&audio_codec_ctx);
-        audio_codec_ctx = nullptr;
-    }
+	if (demux_packet) {
+		av_packet_unref(demux_packet);
+		av_packet_free(&demux_packet);
+		demux_packet = nullptr;
+	}
 
-    if (audio_frame) {
-        av_frame_unref(audio_frame);
-        av_frame_free(&audio_frame);
-        audio_frame = nullptr;
-    }
+	audio_out.close();
+	avsync.setHasAudio(false);
 
-    if (audio_packet) {
-        av_packet_unref(audio_packet);
-        av_packet_free(&audio_packet);
-        audio_packet = nullptr;
-    }
+	if (audio_codec_ctx) {
+		avcodec_close(audio_codec_ctx);
+		avcodec_free_context(&audio_codec_ctx);
+		audio_codec_ctx = nullptr;
+	}
+
+	if (audio_frame) {
+		av_frame_unref(audio_frame);
+		av_frame_free(&audio_frame);
+		audio_frame = nullptr;
+	}
+
+	if (audio_packet) {
+		av_packet_unref(audio_packet);
+		av_packet_free(&audio_packet);
+		audio_packet = nullptr;
+	}
+
+	if (swr_ctx) {
+		swr_free(&swr_ctx);
+		swr_ctx = nullptr;
+	}
 
+	if (audio_buf) {
+		av_freep(&audio_buf);
+		audio_buf = nullptr;
+	}
+
+#if 0
     if (subtitle_codec_ctx) {
         nRet = avcodec_close(subtitle_codec_ctx);
         avcodec_free_context(&subtitle_codec_ctx);
@@ -661,11 +1338,8 @@ int CUVFFPlayer::close() {
     }
 #endif
 
-	if (sws_ctx) {
-		sws_freeContext(sws_ctx);
-		sws_ctx = nullptr;
-	}
+	converter.reset();
 
-	m_frame.buf.cleanup();
+	m_frame.unref();
 	return nRet;
 }
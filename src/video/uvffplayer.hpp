@@ -1,9 +1,19 @@
 ﻿#pragma once
 
 #include <atomic>
-
+#include <condition_variable>
+#include <mutex>
+
+#include "uvdecoderbudget.hpp"
+#include "uvdecodepool.hpp"
+#include "uvswsconverter.hpp"
+#include "uvkeyindex.hpp"
+#include "uvpacketqueue.hpp"
+#include "uvprobecache.hpp"
 #include "uvthread.hpp"
 #include "interface/uvvideoplayer.hpp"
+#include "sdl/uvsdlaudio.hpp"
+#include "util/uvexecutor.hpp"
 #include "util/uvffmpeg_util.hpp"
 
 #define AV_DEFAULT_LOGLEVEL AV_LOG_TRACE
@@ -16,32 +26,109 @@ public:
 
 	int start() override {
 		quit = 0;
+		if (CUVThread::status == STOP) {
+			// NOTE: a run stopped while paused, reset here on the thread calling pause/resume and refresh
+			avsync.setPaused(false);
+		}
 		return CUVThread::start();
 	}
 
 	int stop() override {
+		interrupt();
+		const int ret = CUVThread::stop();
+		// NOTE: the frame pool outlives the run, hand its idle buffers back
+		CUVMemoryBudget::instance().trimOwner(this);
+		return ret;
+	}
+
+	void interrupt() override {
+		// NOTE: interrupt_callback sees quit, a blocked av_read_frame/avformat_open_input returns
 		quit = 1;
-		return CUVThread::stop();
+		video_packet_queue.abort();
+		audio_packet_queue.abort();
+		wakeupDemux();
 	}
 
-	int pause() override { return CUVThread::pause(); }
+	int pause() override {
+		avsync.setPaused(true);
+		audio_out.pause(true);
+		const int ret = CUVThread::pause();
+		// NOTE: budgets default to unlimited, idle pools are otherwise only trimmed when a reserve fails
+		CUVMemoryBudget::instance().trimOwner(this);
+		return ret;
+	}
 
-	int resume() override { return CUVThread::resume(); }
+	int resume() override {
+		avsync.setPaused(false);
+		audio_out.pause(false);
+		const int ret = CUVThread::resume();
+		wakeupDecode();
+		return ret;
+	}
+
+	void set_view(const int w, const int h, const bool visible) override {
+		CUVDecoderBudget::instance().setView(this, w, h, visible);
+		if (!visible) {
+			CUVMemoryBudget::instance().trimOwner(this);
+		}
+	}
+
+	void set_priority(const int priority) override {
+		decode_priority = priority;
+		if (const auto task = std::atomic_load(&decode_task)) {
+			task->setPriority(priority);
+		}
+	}
 
 	int seek(int64_t ms) override;
 
+	[[nodiscard]] FrameStats get_frame_stats() const override {
+		FrameStats stats = CUVVideoPlayer::get_frame_stats();
+		stats.packet_num = static_cast<int>(video_packet_queue.num());
+		stats.packet_bytes = video_packet_queue.bytes();
+		stats.pool_hit_cnt = decode_pool.hitCount();
+		stats.pool_miss_cnt = decode_pool.missCount();
+		stats.mem_bytes = CUVMemoryBudget::instance().ownerUsed(this);
+		const UVThreadStats thread_stats = threadStats();
+		stats.decode_avg_ms = thread_stats.task_cnt ? thread_stats.task_ms / static_cast<double>(thread_stats.task_cnt) : 0;
+		stats.decode_max_ms = thread_stats.task_max_ms;
+		stats.decoder_threads = decoder_threads;
+		stats.convert_threads = converter.threads();
+		stats.convert_avg_ms = converter.avgMs();
+		return stats;
+	}
+
 private:
 	static void logCallBack(void* ptr, int level, const char* fmt, va_list vl);
 	bool doPrepare() override;
 	void doTask() override;
 	bool doFinish() override;
+	void run() override;
+	// decode and convert up to one frame, false when it has to wait for a packet or room in the frame cache
+	bool decodeStep(bool block);
+	void wakeupDecode() const;
+	void setupVideoDecoder(AVCodecContext* ctx, const AVCodec* codec, int threads);
+	// decode size/format => conversion and frame geometry, at open and when the stream changes them
+	int setupVideoScale(int sw, int sh, AVPixelFormat pix_fmt);
+	// decode thread: reopen the video decoder with the thread count the budget assigned
+	void rebalanceDecoder();
+	void demuxLoop();
+	void wakeupDemux();
+	void flushPacketQueues();
+	void startKeyIndex();
+	void stopKeyIndex();
+	void probeStale(const char* what);
+	int seekFile(int64_t ms);
+	void audioLoop();
+	void writeAudio(const AVFrame* frame);
 	int open();
+	int openAudio();
 	int close();
 
 public:
 	int64_t block_starttime{};
 	int64_t block_timeout{};
-	int quit{};
+	std::atomic<int> quit{ 0 };
 
 private:
 	static FILE* m_pLogFile;
@@ -56,17 +143,77 @@ private:
 	AVCodecContext* video_codec_ctx{ nullptr };
 	AVPacket* video_packet{ nullptr };
 	AVFrame* video_frame{ nullptr };
+	// get_buffer2 of video_codec_ctx, software decoders write into pooled aligned planes
+	CUVDecodePool decode_pool;
+	bool decode_pool_enable{ true };
+	// libavcodec threads of the open decoder (0 auto/hardware) and what CUVDecoderBudget assigned now
+	std::atomic<int> decoder_threads{ 0 };
+	std::atomic<int> decoder_threads_target{ 0 };
+
+	// demux thread => video_packet_queue => decode thread(CUVThread) or decode task of the shared executor
+	bool use_executor{ true };
+	std::atomic<int> decode_priority{ UVTASK_PRIORITY_NORMAL };
+	std::shared_ptr<CUVExecutorTask> decode_task; // std::atomic_load/store, read by the queue callbacks
+	std::thread demux_thread;
+	AVPacket* demux_packet{ nullptr };
+	CUVPacketQueue video_packet_queue;
+	int video_packet_serial{};
+	double video_packet_recv_time{}; // arrival of the last packet sent to the decoder
+	// live sources: no demux buffering, one frame cache, newest frame shown at once
+	bool low_latency{};
+	double low_latency_max_age{};
+	std::atomic<bool> seek_request{ false };
+	std::atomic<int64_t> seek_ms{ 0 };
+	// accurate seek: frames of seek_serial before seek_target(stream ms) are decoded but not shown
+	bool accurate_seek{ true };
+	std::atomic<int64_t> seek_target{ 0 };
+	std::atomic<int> seek_serial{ -1 };
+	bool video_seek_pending{}; // decode thread only
+	// the decoded video_frame got no pooled memory (over budget), converted by the next step; decode thread only
+	bool video_frame_pending{};
+	bool audio_seek_pending{}; // audio thread only
+
+	// keyframe index of file sources, loaded or built in background, seek by byte offset when valid
+	bool keyindex_enable{ true };
+	QString keyindex_dir{};
+	CUVKeyframeIndex keyindex;
+	std::thread keyindex_thread;
+	std::atomic<bool> keyindex_cancel{ false };
+	std::mutex demux_mutex;
+	std::condition_variable demux_cond;
+
+	// demux thread => audio_packet_queue => audio thread => audio_out ring => SDL callback
+	AVCodecContext* audio_codec_ctx{ nullptr };
+	AVPacket* audio_packet{ nullptr };
+	AVFrame* audio_frame{ nullptr };
+	std::thread audio_thread;
+	CUVPacketQueue audio_packet_queue;
+	int audio_packet_serial{};
+	SwrContext* swr_ctx{ nullptr };
+	uint8_t* audio_buf{ nullptr }; // resample output, allocated in openAudio
+	int audio_buf_samples{};
+	int audio_time_base_num{};
+	int audio_time_base_den{};
+	double audio_next_pts{ NAN };
+	// decoder input format at open, the first frame is checked against it when the probe was cached
+	int audio_src_rate{};
+	int audio_src_channels{};
+	AVSampleFormat audio_src_fmt{ AV_SAMPLE_FMT_NONE };
+	CUVSDLAudio audio_out;
 
 #if 0
-    AVCodecContext* audio_codec_ctx{ nullptr };
-    AVPacket* audio_packet{ nullptr };
-    AVFrame* audio_frame{ nullptr };
-
     AVCodecContext* subtitle_codec_ctx{ nullptr };
     AVPacket* subtitle_packet{ nullptr };
     AVSubtitle* subtitle{ nullptr };
 #endif
 
+	// probe cache: stream parameters of the last full probe of the same source
+	std::string probe_key{};
+	bool probe_cached{};
+	bool video_probe_verify{}; // decode thread only
+	bool audio_probe_verify{}; // audio thread only
+	std::atomic<bool> probe_stale{ false };
+
 	int video_stream_index{};
 	int audio_stream_index{};
 	int subtitle_stream_index{};
@@ -77,9 +224,19 @@ private:
 	// for scale
 	AVPixelFormat src_pix_fmt{};
 	AVPixelFormat dst_pix_fmt{};
-	SwsContext* sws_ctx{ nullptr };
+	int src_w{};
+	int src_h{};
+	// the stream switched to a size/format the converter cannot take, its frames are dropped until it switches again
+	bool scale_failed{};
+	CUVSwsConverter converter;
+	bool passthrough_enable{ true };
+	bool passthrough{};
+	bool use_source_aspect_ratio{};
 	uint8_t* data[4]{ nullptr };
 	AVFrame* pFrame{};
 	int linesize[4]{};
+	size_t frame_len{};
 	CUVFrame m_frame{};
+	// fallback when the decoder gives no timestamp, ms
+	double frame_duration{};
 };
@@ -0,0 +1,236 @@
+﻿#include "uvkeyindex.hpp"
+
+#include <algorithm>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+#include "global/uvscope.hpp"
+#include "util/uvffmpeg_util.hpp"
+
+static int build_interrupt_callback(void* opaque) {
+	return opaque && static_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+}
+
+/**
+ * class CUVKeyframeIndex
+ */
+CUVKeyframeIndex::~CUVKeyframeIndex() {
+	close();
+}
+
+QString CUVKeyframeIndex::indexPath(const std::string& src, const QString& dir) {
+	const QString path = QString::fromStdString(src);
+	if (dir.isEmpty()) {
+		return path + UVKEYINDEX_SUFFIX;
+	}
+	// cache dir: one file per source, named by the hash of its absolute path
+	const QByteArray hash = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+	return QDir(dir).filePath(QString::fromLatin1(hash) + UVKEYINDEX_SUFFIX);
+}
+
+bool CUVKeyframeIndex::sourceInfo(const std::string& src, int64_t* size, int64_t* mtime) {
+	const QFileInfo info(QString::fromStdString(src));
+	if (!info.exists() || !info.isFile()) {
+		return false;
+	}
+	*size = info.size();
+	*mtime = info.lastModified().toMSecsSinceEpoch();
+	return true;
+}
+
+bool CUVKeyframeIndex::load(const std::string& src, const QString& dir) {
+	close();
+
+	int64_t src_size = 0, src_mtime = 0;
+	if (!sourceInfo(src, &src_size, &src_mtime)) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex);
+	file.setFileName(indexPath(src, dir));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	defer(
+		if (!valid) {
+		file.close();
+		}
+	)
+
+	const qint64 file_size = file.size();
+	if (file_size < static_cast<qint64>(sizeof(UVKeyIndexHeader))) {
+		return false;
+	}
+	// NOTE: the entries are used straight from the mapping, nothing is parsed or copied
+	const uchar* base = file.map(0, file_size);
+	if (!base) {
+		return false;
+	}
+	const auto header = reinterpret_cast<const UVKeyIndexHeader*>(base);
+	if (memcmp(header->magic, UVKEYINDEX_MAGIC, 4) != 0 || header->version != UVKEYINDEX_VERSION ||
+	    header->src_size != src_size || header->src_mtime != src_mtime ||
+	    header->count == 0 || sizeof(UVKeyIndexHeader) + header->count * sizeof(UVKeyIndexEntry) != static_cast<uint64_t>(file_size)) {
+		file.unmap(const_cast<uchar*>(base));
+		return false;
+	}
+
+	mapped = reinterpret_cast<const UVKeyIndexEntry*>(base + sizeof(UVKeyIndexHeader));
+	mapped_count = header->count;
+	valid = true;
+	return true;
+}
+
+bool CUVKeyframeIndex::save(const std::string& src, const QString& dir) {
+	int64_t src_size = 0, src_mtime = 0;
+	if (!sourceInfo(src, &src_size, &src_mtime)) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex);
+	if (built.empty()) {
+		return false;
+	}
+	if (!dir.isEmpty()) {
+		QDir().mkpath(dir);
+	}
+
+	UVKeyIndexHeader header{};
+	memcpy(header.magic, UVKEYINDEX_MAGIC, 4);
+	header.version = UVKEYINDEX_VERSION;
+	header.src_size = src_size;
+	header.src_mtime = src_mtime;
+	header.count = built.size();
+
+	// write to a temp file and rename, a reader never maps a half written index
+	const QString path = indexPath(src, dir);
+	const QString tmp_path = path + ".tmp";
+	QFile tmp(tmp_path);
+	if (!tmp.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+	const qint64 len = static_cast<qint64>(built.size() * sizeof(UVKeyIndexEntry));
+	const bool ok = tmp.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header) &&
+	                tmp.write(reinterpret_cast<const char*>(built.data()), len) == len;
+	tmp.close();
+	if (!ok) {
+		QFile::remove(tmp_path);
+		return false;
+	}
+	QFile::remove(path);
+	return QFile::rename(tmp_path, path);
+}
+
+int CUVKeyframeIndex::build(const std::string& src, const std::atomic<bool>& cancel) {
+	AVFormatContext* fmt_ctx = avformat_alloc_context();
+	if (!fmt_ctx) {
+		return -10;
+	}
+	fmt_ctx->interrupt_callback.callback = build_interrupt_callback;
+	fmt_ctx->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(&cancel);
+	int ret = avformat_open_input(&fmt_ctx, src.c_str(), nullptr, nullptr);
+	if (ret != 0) {
+		return ret;
+	}
+	defer(
+		avformat_close_input(&fmt_ctx);
+	)
+
+	ret = avformat_find_stream_info(fmt_ctx, nullptr);
+	if (ret < 0) {
+		return ret;
+	}
+	const int stream_index = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (stream_index < 0) {
+		return stream_index;
+	}
+	// only the video packets are of interest, let the demuxer skip everything else
+	for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i) {
+		fmt_ctx->streams[i]->discard = static_cast<int>(i) == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+	}
+	const AVRational time_base = fmt_ctx->streams[stream_index]->time_base;
+
+	std::vector<UVKeyIndexEntry> keys;
+	AVPacket* pkt = av_packet_alloc();
+	defer(
+		av_packet_free(&pkt);
+	)
+	while (!cancel) {
+		ret = av_read_frame(fmt_ctx, pkt);
+		if (ret < 0) {
+			break;
+		}
+		if (pkt->stream_index == stream_index && (pkt->flags & AV_PKT_FLAG_KEY) && pkt->pos >= 0) {
+			const int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+			if (ts != AV_NOPTS_VALUE) {
+				const int64_t pts = av_rescale_q(ts, time_base, AVRational{ 1, 1000 });
+				if (keys.empty() || pts > keys.back().pts) {
+					keys.push_back({ pts, pkt->pos });
+				}
+			}
+		}
+		av_packet_unref(pkt);
+	}
+	if (cancel) {
+		return -1;
+	}
+	if (ret != AVERROR_EOF || keys.empty()) {
+		return ret < 0 ? ret : -20;
+	}
+
+	close();
+	std::lock_guard<std::mutex> locker(mutex);
+	built.swap(keys);
+	valid = true;
+	return 0;
+}
+
+void CUVKeyframeIndex::close() {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (mapped) {
+		file.unmap(reinterpret_cast<uchar*>(const_cast<UVKeyIndexEntry*>(mapped)) - sizeof(UVKeyIndexHeader));
+		mapped = nullptr;
+		mapped_count = 0;
+	}
+	if (file.isOpen()) {
+		file.close();
+	}
+	built.clear();
+	valid = false;
+}
+
+bool CUVKeyframeIndex::isValid() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return valid;
+}
+
+size_t CUVKeyframeIndex::count() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return mapped ? mapped_count : built.size();
+}
+
+const UVKeyIndexEntry* CUVKeyframeIndex::entries() const {
+	return mapped ? mapped : built.data();
+}
+
+int64_t CUVKeyframeIndex::find(const int64_t pts, int64_t* key_pts) const {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (!valid) {
+		return -1;
+	}
+	const size_t n = mapped ? mapped_count : built.size();
+	const UVKeyIndexEntry* first = entries();
+	// entries are sorted by pts
+	const UVKeyIndexEntry* it = std::upper_bound(first, first + n, pts, [](const int64_t value, const UVKeyIndexEntry& e) {
+		return value < e.pts;
+	});
+	if (it == first) {
+		return -1;
+	}
+	--it;
+	if (key_pts) {
+		*key_pts = it->pts;
+	}
+	return it->pos;
+}
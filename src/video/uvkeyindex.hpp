@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <QFile>
+
+#define UVKEYINDEX_MAGIC    "UVKI"
+#define UVKEYINDEX_VERSION  1
+#define UVKEYINDEX_SUFFIX   ".uvki"
+
+#pragma pack(push, 1)
+// NOTE: on-disk layout, native little-endian, bump UVKEYINDEX_VERSION on any change
+typedef struct uvkeyindex_header_s {
+	char magic[4];
+	uint32_t version;
+	int64_t src_size;  // bytes
+	int64_t src_mtime; // ms since epoch
+	uint64_t count;
+} UVKeyIndexHeader;
+
+typedef struct uvkeyindex_entry_s {
+	int64_t pts; // stream ms
+	int64_t pos; // byte offset of the keyframe packet
+} UVKeyIndexEntry;
+#pragma pack(pop)
+
+/**
+ * @note: 关键帧索引 (pts => 字节偏移), 用于大文件(TS 录像等)的字节定位 seek.
+ * 首次打开时在后台线程扫描生成并保存, 之后打开直接 map 索引文件, 不再解析.
+ * 索引文件以源文件大小和修改时间校验, 不一致时重新生成.
+ */
+class CUVKeyframeIndex {
+public:
+	CUVKeyframeIndex() = default;
+	~CUVKeyframeIndex();
+
+	// dir empty => next to the source file
+	static QString indexPath(const std::string& src, const QString& dir);
+
+	// map an existing index file, false if missing, stale or of another version
+	bool load(const std::string& src, const QString& dir);
+	bool save(const std::string& src, const QString& dir);
+	// scan the video keyframes of src, cancel aborts the scan; return 0 ok
+	int build(const std::string& src, const std::atomic<bool>& cancel);
+	void close();
+
+	[[nodiscard]] bool isValid() const;
+	[[nodiscard]] size_t count() const;
+	// byte offset of the last keyframe at or before pts, -1 if none
+	int64_t find(int64_t pts, int64_t* key_pts = nullptr) const;
+
+private:
+	static bool sourceInfo(const std::string& src, int64_t* size, int64_t* mtime);
+	[[nodiscard]] const UVKeyIndexEntry* entries() const;
+
+	mutable std::mutex mutex;
+	QFile file;
+	const UVKeyIndexEntry* mapped{ nullptr };
+	size_t mapped_count{};
+	std::vector<UVKeyIndexEntry> built;
+	bool valid{};
+};
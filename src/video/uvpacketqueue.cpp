@@ -0,0 +1,153 @@
+﻿#include "uvpacketqueue.hpp"
+
+#include "uvclock.hpp"
+
+CUVPacketQueue::CUVPacketQueue() {
+	// NOTE: queued packets are consumed, not idle, nothing to trim
+	account = CUVMemoryBudget::instance().open("packet queue");
+}
+
+CUVPacketQueue::~CUVPacketQueue() {
+	clear();
+	for (auto& pkt: free_pkts) {
+		av_packet_free(&pkt);
+	}
+}
+
+void CUVPacketQueue::setLimits(const size_t max_num, const size_t max_bytes) {
+	std::lock_guard<std::mutex> locker(mutex);
+	this->max_num = max_num > 0 ? max_num : 1;
+	this->max_bytes = max_bytes;
+}
+
+int CUVPacketQueue::push(AVPacket* pkt) {
+	std::unique_lock<std::mutex> locker(mutex);
+	if (aborted) {
+		av_packet_unref(pkt);
+		return -1;
+	}
+
+	AVPacket* node = nullptr;
+	if (!free_pkts.empty()) {
+		node = free_pkts.back();
+		free_pkts.pop_back();
+	} else {
+		node = av_packet_alloc();
+	}
+	if (!node) {
+		av_packet_unref(pkt);
+		return -1;
+	}
+	av_packet_move_ref(node, pkt);
+	total_bytes += node->size;
+	account->charge(node->size);
+	packets.push_back({ node, cur_serial, CUVClock::now() });
+	cond_pop.notify_one();
+	locker.unlock();
+	if (ready_cb) {
+		ready_cb();
+	}
+	return 0;
+}
+
+bool CUVPacketQueue::enough() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (packets.empty()) {
+		return false;
+	}
+	// NOTE: the budget is shared with the always charged decode pool, it only makes the queue settle for less
+	return packets.size() >= max_num || total_bytes >= max_bytes || account->overBudget();
+}
+
+int CUVPacketQueue::pop(AVPacket* pkt, int* serial, double* recv_time) {
+	std::unique_lock<std::mutex> locker(mutex);
+	cond_pop.wait(locker, [this] { return aborted || !packets.empty(); });
+	if (aborted) {
+		return -1;
+	}
+	takeFront(pkt, serial, recv_time);
+	return 0;
+}
+
+int CUVPacketQueue::tryPop(AVPacket* pkt, int* serial, double* recv_time) {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (aborted) {
+		return -1;
+	}
+	if (packets.empty()) {
+		return -2;
+	}
+	takeFront(pkt, serial, recv_time);
+	return 0;
+}
+
+void CUVPacketQueue::takeFront(AVPacket* pkt, int* serial, double* recv_time) {
+	PacketNode node = packets.front();
+	packets.pop_front();
+	total_bytes -= node.pkt->size;
+	account->release(node.pkt->size);
+	av_packet_move_ref(pkt, node.pkt);
+	recycle(node.pkt);
+	if (serial) {
+		*serial = node.serial;
+	}
+	if (recv_time) {
+		*recv_time = node.recv_time;
+	}
+}
+
+void CUVPacketQueue::flush() {
+	std::lock_guard<std::mutex> locker(mutex);
+	clear();
+	++cur_serial;
+}
+
+void CUVPacketQueue::abort() {
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		aborted = true;
+		cond_pop.notify_all();
+	}
+	if (ready_cb) {
+		ready_cb();
+	}
+}
+
+void CUVPacketQueue::start() {
+	std::lock_guard<std::mutex> locker(mutex);
+	clear();
+	aborted = false;
+}
+
+int CUVPacketQueue::serial() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return cur_serial;
+}
+
+size_t CUVPacketQueue::num() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return packets.size();
+}
+
+size_t CUVPacketQueue::bytes() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return total_bytes;
+}
+
+void CUVPacketQueue::recycle(AVPacket* pkt) {
+	if (free_pkts.size() < max_num) {
+		free_pkts.push_back(pkt);
+	} else {
+		av_packet_free(&pkt);
+	}
+}
+
+void CUVPacketQueue::clear() {
+	for (auto& node: packets) {
+		av_packet_unref(node.pkt);
+		recycle(node.pkt);
+	}
+	packets.clear();
+	account->release(total_bytes);
+	total_bytes = 0;
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "util/uvffmpeg_util.hpp"
+#include "util/uvmemorybudget.hpp"
+
+#define DEFAULT_PACKET_CACHE_NUM    256
+#define DEFAULT_PACKET_CACHE_BYTES  (16 * 1024 * 1024)
+// the demux thread polls this often while every queue has enough packets
+#define PACKET_QUEUE_ENOUGH_WAIT_MS 10
+
+/**
+ * @note: 解复用线程与解码线程之间的包队列, 包数和字节数限制只决定 enough().
+ * push 从不阻塞, 解复用线程像 ffplay 一样在所有队列都 enough 时才等待, 一路流饿着时不会卡在另一路的 push 上.
+ * pop 在队列空时阻塞, abort 唤醒所有等待者.
+ * flush 清空队列并递增 serial, 解码线程据此判断是否需要 avcodec_flush_buffers.
+ * 排队的包计入内存预算, 所属播放器超出预算时非空队列即算 enough, 但预算本身从不阻塞 push.
+ * 出队后的空 AVPacket 留在 free list 复用, 稳定播放时 push 不再分配内存.
+ */
+class CUVPacketQueue {
+public:
+	CUVPacketQueue();
+	~CUVPacketQueue();
+
+	void setLimits(size_t max_num, size_t max_bytes);
+	void setBudgetOwner(const void* owner) { account->setOwner(owner); }
+
+	// NOTE: takes the reference of pkt, pkt is blank after return; never waits
+	// return 0 ok, -1 aborted
+	int push(AVPacket* pkt);
+	// the queue holds what its limits or the memory budget allow, an empty queue never has enough
+	[[nodiscard]] bool enough() const;
+	// return 0 ok, -1 aborted
+	// recv_time: CUVClock::now() when the packet was pushed, for latency measurement
+	int pop(AVPacket* pkt, int* serial = nullptr, double* recv_time = nullptr);
+	// never waits, return 0 ok, -1 aborted, -2 empty
+	int tryPop(AVPacket* pkt, int* serial = nullptr, double* recv_time = nullptr);
+	// called without the lock after each push and on abort, wakes a consumer that does not block in pop
+	// NOTE: set before the producer starts
+	void setReadyCallback(std::function<void()> cb) { ready_cb = std::move(cb); }
+
+	void flush();
+	void abort();
+	void start();
+
+	[[nodiscard]] int serial() const;
+	[[nodiscard]] size_t num() const;
+	[[nodiscard]] size_t bytes() const;
+
+private:
+	void clear();
+	void takeFront(AVPacket* pkt, int* serial, double* recv_time);
+	// the packet must be blank
+	void recycle(AVPacket* pkt);
+
+	typedef struct packet_node_s {
+		AVPacket* pkt;
+		int serial;
+		double recv_time;
+	} PacketNode;
+
+	std::deque<PacketNode> packets;
+	// blank packets for the next push, at most max_num
+	std::vector<AVPacket*> free_pkts;
+	size_t max_num{ DEFAULT_PACKET_CACHE_NUM };
+	size_t max_bytes{ DEFAULT_PACKET_CACHE_BYTES };
+	size_t total_bytes{};
+	int cur_serial{};
+	bool aborted{};
+	std::shared_ptr<CUVMemoryAccount> account;
+	std::function<void()> ready_cb;
+
+	mutable std::mutex mutex;
+	std::condition_variable cond_pop;
+};
@@ -0,0 +1,88 @@
+﻿#include "uvplayerreaper.hpp"
+
+#include <chrono>
+#include <QDebug>
+
+#include "interface/uvvideoplayer.hpp"
+
+/**
+ * class CUVPlayerReaper
+ */
+CUVPlayerReaper& CUVPlayerReaper::instance() {
+	static CUVPlayerReaper reaper;
+	return reaper;
+}
+
+CUVPlayerReaper::~CUVPlayerReaper() {
+	shutdown();
+}
+
+void CUVPlayerReaper::reap(CUVVideoPlayer* player) {
+	if (!player) {
+		return;
+	}
+	// NOTE: nothing may reach the widget any more, it can be deleted right after this returns
+	player->set_event_callback(nullptr, nullptr);
+	player->disconnect();
+	player->interrupt();
+	// no thread affinity: no more event delivery, delete from the reaper thread is safe
+	player->moveToThread(nullptr);
+
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		if (!stopped) {
+			players.push_back(player);
+			++pending_cnt;
+			if (!thread.joinable()) {
+				thread = std::thread(&CUVPlayerReaper::run, this);
+			}
+			cond.notify_one();
+			return;
+		}
+	}
+	destroy(player);
+}
+
+void CUVPlayerReaper::shutdown() {
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		stopped = true;
+		cond.notify_one();
+	}
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+int CUVPlayerReaper::pending() const {
+	std::lock_guard<std::mutex> locker(mutex);
+	return pending_cnt;
+}
+
+void CUVPlayerReaper::destroy(CUVVideoPlayer* player) {
+	const auto start = std::chrono::steady_clock::now();
+	const std::string src = player->media.src;
+	player->stop();
+	delete player;
+	if (const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		ms >= PLAYER_REAP_SLOW_MS) {
+		qInfo() << "player teardown took" << ms << "ms, media.src =" << src.c_str();
+	}
+}
+
+void CUVPlayerReaper::run() {
+	std::unique_lock<std::mutex> locker(mutex);
+	while (true) {
+		// NOTE: shutdown still destroys everything queued before it
+		cond.wait(locker, [this] { return stopped || !players.empty(); });
+		if (players.empty()) {
+			break;
+		}
+		CUVVideoPlayer* player = players.front();
+		players.pop_front();
+		locker.unlock();
+		destroy(player);
+		locker.lock();
+		--pending_cnt;
+	}
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class CUVVideoPlayer;
+
+// a teardown slower than this is logged, ms
+#define PLAYER_REAP_SLOW_MS 1000
+
+/**
+ * @note: 播放器回收线程. stop 要 join 解复用/解码线程, 网络断开时 av_read_frame 可能阻塞到 block_timeout,
+ * 因此 GUI 线程只负责摘除播放器(清除事件回调, 断开信号, 解除线程归属)并设置中断标志, 立即返回;
+ * stop 与 delete 在回收线程中完成. 所有播放器先被中断, 阻塞的读取并行退出, 总耗时约为最慢的一个.
+ * shutdown 等待全部销毁并结束线程, 之后 reap 在调用线程同步执行.
+ */
+class CUVPlayerReaper {
+public:
+	static CUVPlayerReaper& instance();
+
+	CUVPlayerReaper(const CUVPlayerReaper&) = delete;
+	CUVPlayerReaper& operator=(const CUVPlayerReaper&) = delete;
+
+	// GUI thread, the player must not be touched afterwards
+	void reap(CUVVideoPlayer* player);
+	// wait until every reaped player is destroyed
+	void shutdown();
+	// players reaped but not destroyed yet
+	[[nodiscard]] int pending() const;
+
+private:
+	CUVPlayerReaper() = default;
+	~CUVPlayerReaper();
+
+	static void destroy(CUVVideoPlayer* player);
+	void run();
+
+	mutable std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<CUVVideoPlayer*> players;
+	std::thread thread;
+	int pending_cnt{};
+	bool stopped{};
+};
@@ -0,0 +1,116 @@
+﻿#include "uvprobecache.hpp"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "def/uvdef.hpp"
+
+/**
+ * class CUVProbeCache
+ */
+CUVProbeCache& CUVProbeCache::instance() {
+	static CUVProbeCache cache;
+	return cache;
+}
+
+void CUVProbeCache::setCapacity(const size_t num) {
+	std::lock_guard<std::mutex> locker(mutex);
+	capacity = num > 0 ? num : 1;
+	while (lru.size() > capacity) {
+		entries.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
+
+std::string CUVProbeCache::key(const std::string& src, const AVFormatContext* fmt_ctx) {
+	if (!fmt_ctx || !fmt_ctx->iformat || fmt_ctx->nb_streams == 0) {
+		return {};
+	}
+
+	std::string str = src;
+	str += '|';
+	str += fmt_ctx->iformat->name;
+	// NOTE: a replaced or rewritten file of the same name must not hit
+	if (const QFileInfo info(QString::fromStdString(src)); info.exists() && info.isFile()) {
+		str += '|' + std::to_string(info.size()) + ':' + std::to_string(info.lastModified().toMSecsSinceEpoch());
+	}
+	for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i) {
+		const AVCodecParameters* par = fmt_ctx->streams[i]->codecpar;
+		str += '|' + std::to_string(par->codec_type) + ':' + std::to_string(par->codec_id);
+	}
+	return str;
+}
+
+bool CUVProbeCache::apply(const std::string& key, AVFormatContext* fmt_ctx) {
+	if (key.empty()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex);
+	const auto iter = entries.find(key);
+	if (iter == entries.end()) {
+		return false;
+	}
+	lru.splice(lru.begin(), lru, iter->second);
+
+	const std::vector<ProbeStream>& streams = iter->second->second;
+	if (streams.size() != fmt_ctx->nb_streams) {
+		return false;
+	}
+	for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i) {
+		AVStream* st = fmt_ctx->streams[i];
+		if (avcodec_parameters_copy(st->codecpar, streams[i].par.get()) < 0) {
+			return false;
+		}
+		if (!st->r_frame_rate.num) {
+			st->r_frame_rate = streams[i].r_frame_rate;
+		}
+		if (!st->avg_frame_rate.num) {
+			st->avg_frame_rate = streams[i].avg_frame_rate;
+		}
+	}
+
+	// NOTE: all parameters are known, find_stream_info only has to settle start time and duration
+	fmt_ctx->probesize = MIN(fmt_ctx->probesize, PROBE_CACHE_PROBESIZE);
+	if (fmt_ctx->max_analyze_duration <= 0 || fmt_ctx->max_analyze_duration > PROBE_CACHE_ANALYZEDURATION) {
+		fmt_ctx->max_analyze_duration = PROBE_CACHE_ANALYZEDURATION;
+	}
+	return true;
+}
+
+void CUVProbeCache::store(const std::string& key, const AVFormatContext* fmt_ctx) {
+	if (key.empty()) {
+		return;
+	}
+
+	std::vector<ProbeStream> streams;
+	streams.reserve(fmt_ctx->nb_streams);
+	for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i) {
+		const AVStream* st = fmt_ctx->streams[i];
+		std::shared_ptr<AVCodecParameters> par(avcodec_parameters_alloc(), [](AVCodecParameters* p) { avcodec_parameters_free(&p); });
+		if (!par || avcodec_parameters_copy(par.get(), st->codecpar) < 0) {
+			return;
+		}
+		streams.push_back({ par, st->r_frame_rate, st->avg_frame_rate });
+	}
+
+	std::lock_guard<std::mutex> locker(mutex);
+	if (const auto iter = entries.find(key); iter != entries.end()) {
+		lru.erase(iter->second);
+		entries.erase(iter);
+	}
+	lru.emplace_front(key, std::move(streams));
+	entries[key] = lru.begin();
+	while (lru.size() > capacity) {
+		entries.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
+
+void CUVProbeCache::remove(const std::string& key) {
+	std::lock_guard<std::mutex> locker(mutex);
+	if (const auto iter = entries.find(key); iter != entries.end()) {
+		lru.erase(iter->second);
+		entries.erase(iter);
+	}
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/uvffmpeg_util.hpp"
+
+#define DEFAULT_PROBE_CACHE_NUM         32
+// find_stream_info limits on a cache hit, only timings are left to find
+#define PROBE_CACHE_PROBESIZE           32768
+#define PROBE_CACHE_ANALYZEDURATION     100000 // us
+
+/**
+ * @note: 流探测缓存, 以 URL + 流签名(格式名, 各流类型与 codec_id, 文件大小与修改时间)为键,
+ * 保存 avformat_find_stream_info 得到的编解码参数(含 extradata)与帧率.
+ * 命中时把参数写回各流并缩小 probesize/analyzeduration, find_stream_info 几乎不再读包;
+ * 首帧与缓存不一致时由调用方 remove 并重新完整探测. 进程内共享, LRU 淘汰.
+ */
+class CUVProbeCache {
+public:
+	static CUVProbeCache& instance();
+
+	void setCapacity(size_t num);
+
+	// key of the streams avformat_open_input created, empty if there is nothing to key on
+	static std::string key(const std::string& src, const AVFormatContext* fmt_ctx);
+	// copy the cached parameters into the streams and shorten the probe, false on miss
+	bool apply(const std::string& key, AVFormatContext* fmt_ctx);
+	// after a full avformat_find_stream_info
+	void store(const std::string& key, const AVFormatContext* fmt_ctx);
+	void remove(const std::string& key);
+
+private:
+	CUVProbeCache() = default;
+
+	typedef struct probe_stream_s {
+		std::shared_ptr<AVCodecParameters> par;
+		AVRational r_frame_rate;
+		AVRational avg_frame_rate;
+	} ProbeStream;
+	typedef std::pair<std::string, std::vector<ProbeStream>> ProbeEntry;
+
+	std::mutex mutex;
+	std::list<ProbeEntry> lru; // front: most recently used
+	std::unordered_map<std::string, std::list<ProbeEntry>::iterator> entries;
+	size_t capacity{ DEFAULT_PROBE_CACHE_NUM };
+};
@@ -0,0 +1,172 @@
+﻿#include "uvswsconverter.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+extern "C" {
+#include "libavutil/opt.h"
+}
+
+// the converter owns nothing behind the wrapped planes, the frame pool does
+static void sws_noop_free(void* /*opaque*/, uint8_t* /*data*/) {
+}
+
+/**
+ * class CUVSwsCache
+ */
+CUVSwsCache& CUVSwsCache::instance() {
+	static CUVSwsCache cache;
+	return cache;
+}
+
+CUVSwsCache::~CUVSwsCache() {
+	for (const auto& [key, ctx]: idle) {
+		sws_freeContext(ctx);
+	}
+	idle.clear();
+}
+
+SwsContext* CUVSwsCache::create(const SwsKey& key) {
+	SwsContext* ctx = sws_alloc_context();
+	if (!ctx) {
+		return nullptr;
+	}
+	av_opt_set_int(ctx, "srcw", key.sw, 0);
+	av_opt_set_int(ctx, "srch", key.sh, 0);
+	av_opt_set_int(ctx, "src_format", key.src_fmt, 0);
+	av_opt_set_int(ctx, "dstw", key.dw, 0);
+	av_opt_set_int(ctx, "dsth", key.dh, 0);
+	av_opt_set_int(ctx, "dst_format", key.dst_fmt, 0);
+	av_opt_set_int(ctx, "sws_flags", key.flags, 0);
+	av_opt_set_int(ctx, "threads", key.threads, 0);
+	if (sws_init_context(ctx, nullptr, nullptr) < 0) {
+		av_log(nullptr, AV_LOG_ERROR, "sws_init_context %s => %s failed\n", av_get_pix_fmt_name(key.src_fmt), av_get_pix_fmt_name(key.dst_fmt));
+		sws_freeContext(ctx);
+		return nullptr;
+	}
+	av_log(nullptr, AV_LOG_DEBUG, "sws %dx%d %s => %dx%d %s, %d threads\n", key.sw, key.sh, av_get_pix_fmt_name(key.src_fmt),
+	       key.dw, key.dh, av_get_pix_fmt_name(key.dst_fmt), key.threads);
+	return ctx;
+}
+
+SwsContext* CUVSwsCache::acquire(const SwsKey& key) {
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		for (auto it = idle.begin(); it != idle.end(); ++it) {
+			if (it->first == key) {
+				SwsContext* ctx = it->second;
+				idle.erase(it);
+				++hit_cnt;
+				return ctx;
+			}
+		}
+	}
+	// NOTE: outside the lock, a threaded context starts its worker threads
+	++miss_cnt;
+	return create(key);
+}
+
+void CUVSwsCache::release(const SwsKey& key, SwsContext* ctx) {
+	if (!ctx) {
+		return;
+	}
+	std::list<std::pair<SwsKey, SwsContext*>> evicted;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		idle.emplace_front(key, ctx);
+		while (static_cast<int>(idle.size()) > max_idle) {
+			evicted.splice(evicted.end(), idle, std::prev(idle.end()));
+		}
+	}
+	for (const auto& [evicted_key, evicted_ctx]: evicted) {
+		sws_freeContext(evicted_ctx);
+	}
+}
+
+void CUVSwsCache::setMaxIdle(const int num) {
+	std::list<std::pair<SwsKey, SwsContext*>> evicted;
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		max_idle = std::max(num, 0);
+		while (static_cast<int>(idle.size()) > max_idle) {
+			evicted.splice(evicted.end(), idle, std::prev(idle.end()));
+		}
+	}
+	for (const auto& [evicted_key, evicted_ctx]: evicted) {
+		sws_freeContext(evicted_ctx);
+	}
+}
+
+/**
+ * class CUVSwsConverter
+ */
+CUVSwsConverter::~CUVSwsConverter() {
+	reset();
+	av_frame_free(&dst_frame);
+}
+
+int CUVSwsConverter::autoThreads(const int height) {
+	const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	return std::clamp(height / SWS_ROWS_PER_THREAD, 1, std::min(cores, SWS_MAX_THREADS));
+}
+
+bool CUVSwsConverter::init(const int sw, const int sh, const AVPixelFormat src_fmt, const int dw, const int dh, const AVPixelFormat dst_fmt, const int flags, const int threads) {
+	const SwsKey want{ sw, sh, src_fmt, dw, dh, dst_fmt, flags, threads > 0 ? std::min(threads, SWS_MAX_THREADS) : autoThreads(dh) };
+	if (sws_ctx && want == key) {
+		return true;
+	}
+	reset();
+	if (!dst_frame && !(dst_frame = av_frame_alloc())) {
+		return false;
+	}
+	sws_ctx = CUVSwsCache::instance().acquire(want);
+	if (!sws_ctx) {
+		return false;
+	}
+	key = want;
+	sws_threads = want.threads;
+	return true;
+}
+
+void CUVSwsConverter::reset() {
+	if (sws_ctx) {
+		CUVSwsCache::instance().release(key, sws_ctx);
+		sws_ctx = nullptr;
+	}
+	sws_threads = 0;
+}
+
+int CUVSwsConverter::convert(const AVFrame* src, uint8_t* const data[4], const int linesize[4]) {
+	if (!sws_ctx) {
+		return AVERROR(EINVAL);
+	}
+	// NOTE: the source changed size or format mid-stream, keep the output, switch the context
+	if (!matches(src) && !init(src->width, src->height, static_cast<AVPixelFormat>(src->format), key.dw, key.dh, key.dst_fmt, key.flags, key.threads)) {
+		return AVERROR(EINVAL);
+	}
+	// NOTE: sws_scale_frame references dst, a frame without buf would be reallocated
+	dst_frame->width = key.dw;
+	dst_frame->height = key.dh;
+	dst_frame->format = key.dst_fmt;
+	for (int i = 0; i < 4; ++i) {
+		dst_frame->data[i] = data[i];
+		dst_frame->linesize[i] = linesize[i];
+	}
+	dst_frame->buf[0] = av_buffer_create(data[0], static_cast<size_t>(std::abs(linesize[0])) * key.dh, sws_noop_free, nullptr, 0);
+	if (!dst_frame->buf[0]) {
+		return AVERROR(ENOMEM);
+	}
+
+	const int64_t start = av_gettime_relative();
+	const int ret = sws_scale_frame(sws_ctx, dst_frame, src);
+	convert_us += av_gettime_relative() - start;
+	++convert_cnt;
+	av_frame_unref(dst_frame);
+	return ret < 0 ? ret : key.dh;
+}
+
+double CUVSwsConverter::avgMs() const {
+	const int64_t cnt = convert_cnt;
+	return cnt ? static_cast<double>(convert_us) / 1000.0 / static_cast<double>(cnt) : 0;
+}
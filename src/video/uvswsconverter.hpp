@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include "util/uvffmpeg_util.hpp"
+
+// swscale slice threads: one per this many output rows, 1080p stays single threaded
+#define SWS_ROWS_PER_THREAD     720
+#define SWS_MAX_THREADS         16
+// idle contexts kept by CUVSwsCache, the least recently released go first
+#define SWS_CACHE_MAX_IDLE      16
+
+typedef struct sws_key_s {
+	int sw;
+	int sh;
+	AVPixelFormat src_fmt;
+	int dw;
+	int dh;
+	AVPixelFormat dst_fmt;
+	int flags;
+	int threads;
+
+	[[nodiscard]] auto tie() const {
+		return std::tie(sw, sh, src_fmt, dw, dh, dst_fmt, flags, threads);
+	}
+
+	bool operator==(const sws_key_s& rhs) const {
+		return tie() == rhs.tie();
+	}
+
+	bool operator!=(const sws_key_s& rhs) const {
+		return tie() != rhs.tie();
+	}
+} SwsKey;
+
+/**
+ * @note: 进程内共享的 SwsContext 缓存, 按 (源格式, 源尺寸, 目标格式, 目标尺寸, flags, 线程数) 索引.
+ * SwsContext 不能并发使用, acquire 独占一个, release 后放回空闲表供其他播放器复用;
+ * 多画面播放同规格的流, 或分辨率来回切换时不必重建(带切片线程的上下文创建代价较高).
+ */
+class CUVSwsCache {
+public:
+	static CUVSwsCache& instance();
+
+	CUVSwsCache(const CUVSwsCache&) = delete;
+	CUVSwsCache& operator=(const CUVSwsCache&) = delete;
+
+	// an idle context with this key, or a new one; nullptr if swscale rejects the key
+	SwsContext* acquire(const SwsKey& key);
+	void release(const SwsKey& key, SwsContext* ctx);
+	void setMaxIdle(int num);
+
+	[[nodiscard]] int hitCount() const { return hit_cnt; }
+	[[nodiscard]] int missCount() const { return miss_cnt; }
+
+private:
+	CUVSwsCache() = default;
+	~CUVSwsCache();
+
+	static SwsContext* create(const SwsKey& key);
+
+	std::mutex mutex;
+	std::list<std::pair<SwsKey, SwsContext*>> idle; // most recently released first
+	int max_idle{ SWS_CACHE_MAX_IDLE };
+	std::atomic<int> hit_cnt{ 0 };
+	std::atomic<int> miss_cnt{ 0 };
+};
+
+/**
+ * @note: 像素格式转换, 基于 swscale 自带的切片线程(FFmpeg 5.0 的 threads 选项 + sws_scale_frame),
+ * 输出图像按水平条带分给多个线程并行转换, 1 个线程时与 sws_scale 相同.
+ * SwsContext 从 CUVSwsCache 租用, init 参数不变时什么也不做, 变化时换一个上下文, 用于流中途改变分辨率或格式.
+ * 目标内存由调用者提供(通常来自帧池), 只包装成 AVFrame 引用, 不拷贝也不接管所有权.
+ * NOTE: 不是线程安全的, 一个实例只在一个解码线程中使用.
+ */
+class CUVSwsConverter {
+public:
+	CUVSwsConverter() = default;
+	~CUVSwsConverter();
+
+	CUVSwsConverter(const CUVSwsConverter&) = delete;
+	CUVSwsConverter& operator=(const CUVSwsConverter&) = delete;
+
+	// threads <= 0: by output height, see SWS_ROWS_PER_THREAD
+	static int autoThreads(int height);
+
+	// cheap when nothing changed, safe to call for every frame
+	bool init(int sw, int sh, AVPixelFormat src_fmt, int dw, int dh, AVPixelFormat dst_fmt, int flags, int threads);
+	// hand the context back to the cache
+	void reset();
+	[[nodiscard]] bool valid() const { return sws_ctx != nullptr; }
+	// src has the size and format the context was made for
+	[[nodiscard]] bool matches(const AVFrame* src) const {
+		return sws_ctx && src->width == key.sw && src->height == key.sh && src->format == key.src_fmt;
+	}
+
+	// return the output height, < 0 on error; a source of another size or format is scaled to the same output
+	int convert(const AVFrame* src, uint8_t* const data[4], const int linesize[4]);
+
+	[[nodiscard]] int threads() const { return sws_threads; }
+	[[nodiscard]] double avgMs() const;
+
+private:
+	SwsContext* sws_ctx{ nullptr };
+	SwsKey key{};
+	AVFrame* dst_frame{ nullptr };
+	std::atomic<int> sws_threads{ 0 };
+
+	std::atomic<int64_t> convert_cnt{ 0 };
+	std::atomic<int64_t> convert_us{ 0 };
+};
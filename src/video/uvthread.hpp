@@ -49,10 +49,31 @@ static inline int uvthread_join(uvthread_t th) {
 #endif
 
 #ifdef __cplusplus
-#include <thread>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// SLEEP_UNTIL: missed periods run back to back up to this many, then the schedule restarts from now
+#define UVTHREAD_MAX_CATCH_UP   3
 
+typedef struct uvthread_stats_s {
+	uint64_t task_cnt;
+	double task_ms;     // total time spent in doTask
+	double task_max_ms;
+	// SLEEP_UNTIL: doTask ran past its deadline / periods given up after falling too far behind
+	uint64_t overrun_cnt;
+	uint64_t skipped_cnt;
+} UVThreadStats;
+
+/**
+ * @note: 任务线程, doPrepare 成功后循环 doTask 直到 stop, 最后 doFinish.
+ * 暂停, 恢复, 停止都通过条件变量唤醒, 暂停时不占用 CPU; SLEEP_FOR/SLEEP_UNTIL 的等待同样可被 stop 打断.
+ * SLEEP_UNTIL 以 steady_clock 计算截止时间, 不受系统时间调整影响; 任务超时后最多连续追赶
+ * UVTHREAD_MAX_CATCH_UP 个周期, 落后更多时放弃积压的周期, 从当前时间重新排期.
+ */
 class CUVThread {
 public:
 	enum Status {
@@ -68,35 +89,47 @@ public:
 		NO_SLEEP,
 	};
 
-	CUVThread() {
-		status = STOP;
-		status_changed = false;
-		dotask_cnt = 0;
-		sleep_policy = YIELD;
-		sleep_ms = 0;
-	}
+	CUVThread() = default;
 
 	virtual ~CUVThread() = default;
 
 	void setStatus(const Status& stat) {
-		status_changed = true;
-		status = stat;
+		{
+			std::lock_guard<std::mutex> locker(thread_mutex);
+			status_changed = true;
+			status = stat;
+		}
+		thread_cond.notify_all();
 	}
 
 	void setSleepPolicy(const SleepPolicy& policy, const uint32_t ms = 0) {
-		sleep_policy = policy;
-		sleep_ms = ms;
-		setStatus(status);
+		{
+			std::lock_guard<std::mutex> locker(thread_mutex);
+			sleep_policy = policy;
+			sleep_ms = ms;
+			status_changed = true;
+		}
+		thread_cond.notify_all();
+	}
+
+	void setMaxCatchUp(const uint32_t periods) {
+		max_catch_up = periods;
 	}
 
 	virtual int start() {
 		if (status == STOP) {
+			if (thread.joinable()) {
+				thread.join(); // the last run ended by itself
+			}
+			stop_requested = false;
 			thread = std::thread([this] {
 				if (!doPrepare()) {
 					return;
 				}
-				setStatus(RUNNING);
-				run();
+				if (!stop_requested) {
+					setStatus(RUNNING);
+					run();
+				}
 				setStatus(STOP);
 				if (!doFinish()) {
 					return;
@@ -107,8 +140,15 @@ public:
 	}
 
 	virtual int stop() {
+		// NOTE: also before doPrepare returns, run is skipped then
+		{
+			std::lock_guard<std::mutex> locker(thread_mutex);
+			stop_requested = true;
+		}
 		if (status != STOP) {
 			setStatus(STOP);
+		} else {
+			thread_cond.notify_all();
 		}
 		if (thread.joinable()) {
 			thread.join(); // wait thread exit
@@ -131,13 +171,18 @@ public:
 	}
 
 	virtual void run() {
-		while (status != STOP) {
-			while (status == PAUSE) {
-				std::this_thread::yield();
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> locker(thread_mutex);
+				thread_cond.wait(locker, [this] { return stop_requested || status != PAUSE; });
+				if (stop_requested || status == STOP) {
+					break;
+				}
 			}
 
+			const auto begin = std::chrono::steady_clock::now();
 			doTask();
-			++dotask_cnt;
+			addTaskTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
 
 			sleep();
 		}
@@ -150,27 +195,66 @@ public:
 
 	virtual bool doFinish() { return true; }
 
+	[[nodiscard]] UVThreadStats threadStats() const {
+		UVThreadStats stats{};
+		stats.task_cnt = dotask_cnt;
+		stats.task_ms = static_cast<double>(task_us) / 1000;
+		stats.task_max_ms = task_max_ms;
+		stats.overrun_cnt = overrun_cnt;
+		stats.skipped_cnt = skipped_cnt;
+		return stats;
+	}
 
 	std::thread thread;
-	std::atomic<Status> status;
-	uint32_t dotask_cnt;
+	std::atomic<Status> status{ STOP };
+	std::atomic<uint64_t> dotask_cnt{ 0 };
 
 protected:
+	// a run() that does its tasks elsewhere (executor) reports their time here for threadStats
+	void addTaskTime(const double ms) {
+		++dotask_cnt;
+		task_us += static_cast<uint64_t>(ms * 1000);
+		if (ms > task_max_ms) {
+			task_max_ms = ms;
+		}
+	}
+
+	// for a run() whose work is done elsewhere: block until stop()
+	void waitStop() {
+		std::unique_lock<std::mutex> locker(thread_mutex);
+		thread_cond.wait(locker, [this] { return stop_requested.load(); });
+	}
+
 	void sleep() {
+		std::unique_lock<std::mutex> locker(thread_mutex);
 		switch (sleep_policy) {
 			case YIELD:
+				locker.unlock();
 				std::this_thread::yield();
 				break;
 			case SLEEP_FOR:
-				std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+				thread_cond.wait_for(locker, std::chrono::milliseconds(sleep_ms), [this] { return stop_requested || status == PAUSE; });
 				break;
 			case SLEEP_UNTIL: {
+				const auto now = std::chrono::steady_clock::now();
+				const auto period = std::chrono::milliseconds(sleep_ms);
 				if (status_changed) {
+					// NOTE: resumed or rescheduled, the time spent paused is not made up for
 					status_changed = false;
-					base_tp = std::chrono::system_clock::now();
+					base_tp = now;
+				}
+				base_tp += period;
+				if (base_tp < now) {
+					++overrun_cnt;
+					const auto behind = now - base_tp;
+					if (behind > period * max_catch_up.load()) {
+						// NOTE: too far behind, drop the backlog instead of running a burst of tasks
+						skipped_cnt += period.count() > 0 ? static_cast<uint64_t>(behind / period) : 0;
+						base_tp = now;
+					}
+					break;
 				}
-				base_tp += std::chrono::milliseconds(sleep_ms);
-				std::this_thread::sleep_until(base_tp);
+				thread_cond.wait_until(locker, base_tp, [this] { return stop_requested || status_changed; });
 			}
 			break;
 			default: // donothing, go all out.
@@ -178,10 +262,21 @@ protected:
 		}
 	}
 
-	SleepPolicy sleep_policy;
-	uint32_t sleep_ms;
-	// for SLEEP_UNTIL
-	std::atomic<bool> status_changed;
-	std::chrono::system_clock::time_point base_tp;
+	SleepPolicy sleep_policy{ YIELD };
+	uint32_t sleep_ms{};
+	std::atomic<uint32_t> max_catch_up{ UVTHREAD_MAX_CATCH_UP };
+
+private:
+	std::mutex thread_mutex;
+	std::condition_variable thread_cond;
+	std::atomic<bool> stop_requested{ false };
+	// for SLEEP_UNTIL, guarded by thread_mutex
+	bool status_changed{};
+	std::chrono::steady_clock::time_point base_tp;
+
+	std::atomic<uint64_t> task_us{ 0 };
+	std::atomic<double> task_max_ms{ 0 };
+	std::atomic<uint64_t> overrun_cnt{ 0 };
+	std::atomic<uint64_t> skipped_cnt{ 0 };
 };
 #endif
@@ -0,0 +1,251 @@
+﻿#include "uvthumbnailer.hpp"
+
+#include "conf/uvconf.hpp"
+#include "def/uvdef.hpp"
+#include "global/uvscope.hpp"
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+static int thumbnail_interrupt_callback(void* opaque) {
+	return opaque && static_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+}
+
+/**
+ * class CUVThumbnailer
+ */
+CUVThumbnailer::CUVThumbnailer(QObject* parent) : QObject(parent) {
+	thumb_width = g_confile->get<int>("thumbnail_width", "video", DEFAULT_THUMBNAIL_WIDTH);
+	cache_num = g_confile->get<int>("thumbnail_cache", "video", DEFAULT_THUMBNAIL_CACHE);
+	if (thumb_width <= 0) thumb_width = DEFAULT_THUMBNAIL_WIDTH;
+	if (cache_num == 0) cache_num = DEFAULT_THUMBNAIL_CACHE;
+}
+
+CUVThumbnailer::~CUVThumbnailer() {
+	stop();
+}
+
+int CUVThumbnailer::start(const std::string& src, const int64_t start_time, const int64_t duration) {
+	stop();
+	this->src = src;
+	this->start_time = start_time;
+	this->duration = duration;
+	// one bucket per cached thumbnail over the whole duration, at least 1s
+	interval = duration > 0 ? MAX(duration / static_cast<int64_t>(cache_num), 1000) : 1000;
+	sweep_next = 0;
+	hover_request = -1;
+	quit = false;
+	thread = std::thread(&CUVThumbnailer::run, this);
+	return 0;
+}
+
+void CUVThumbnailer::stop() {
+	{
+		std::lock_guard<std::mutex> locker(mutex);
+		quit = true;
+		cond.notify_all();
+	}
+	if (thread.joinable()) {
+		thread.join();
+	}
+	std::lock_guard<std::mutex> locker(lru_mutex);
+	lru.clear();
+	lru_map.clear();
+}
+
+int64_t CUVThumbnailer::bucketOf(const int64_t ms) const {
+	return MAX(ms, 0) / interval * interval;
+}
+
+bool CUVThumbnailer::thumbnail(const int64_t ms, QImage* image) {
+	const int64_t bucket = bucketOf(ms);
+	if (lookup(bucket, image)) {
+		return true;
+	}
+	// NOTE: only the latest hover position matters, older requests are replaced
+	std::lock_guard<std::mutex> locker(mutex);
+	hover_request = bucket;
+	cond.notify_one();
+	return false;
+}
+
+bool CUVThumbnailer::lookup(const int64_t bucket, QImage* image) {
+	std::lock_guard<std::mutex> locker(lru_mutex);
+	const auto it = lru_map.find(bucket);
+	if (it == lru_map.end()) {
+		return false;
+	}
+	lru.splice(lru.begin(), lru, it->second);
+	if (image) {
+		*image = it->second->second;
+	}
+	return true;
+}
+
+void CUVThumbnailer::insert(const int64_t bucket, const QImage& image) {
+	std::lock_guard<std::mutex> locker(lru_mutex);
+	if (const auto it = lru_map.find(bucket); it != lru_map.end()) {
+		it->second->second = image;
+		lru.splice(lru.begin(), lru, it->second);
+		return;
+	}
+	lru.emplace_front(bucket, image);
+	lru_map[bucket] = lru.begin();
+	while (lru.size() > cache_num) {
+		lru_map.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
+
+void CUVThumbnailer::run() {
+#ifdef Q_OS_WIN
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#endif
+	if (open() != 0) {
+		close();
+		return;
+	}
+	const int64_t sweep_count = duration > 0 ? MIN(duration / interval + 1, static_cast<int64_t>(cache_num)) : 0;
+
+	while (!quit) {
+		int64_t bucket = -1;
+		{
+			std::unique_lock<std::mutex> locker(mutex);
+			cond.wait(locker, [&] { return quit || hover_request >= 0 || sweep_next < sweep_count; });
+			if (quit) break;
+			if (hover_request >= 0) {
+				bucket = hover_request;
+				hover_request = -1;
+			} else {
+				bucket = sweep_next++ * interval;
+			}
+		}
+		if (lookup(bucket, nullptr)) {
+			continue;
+		}
+		if (QImage image; decodeAt(bucket, &image) == 0) {
+			insert(bucket, image);
+			emit thumbnailReady(bucket);
+		}
+	}
+	close();
+}
+
+int CUVThumbnailer::open() {
+	fmt_ctx = avformat_alloc_context();
+	if (!fmt_ctx) {
+		return -10;
+	}
+	fmt_ctx->interrupt_callback.callback = thumbnail_interrupt_callback;
+	fmt_ctx->interrupt_callback.opaque = &quit;
+	int ret = avformat_open_input(&fmt_ctx, src.c_str(), nullptr, nullptr);
+	if (ret != 0) {
+		return ret;
+	}
+	ret = avformat_find_stream_info(fmt_ctx, nullptr);
+	if (ret < 0) {
+		return ret;
+	}
+	stream_index = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (stream_index < 0) {
+		return stream_index;
+	}
+	for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i) {
+		fmt_ctx->streams[i]->discard = static_cast<int>(i) == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+	}
+	AVStream* stream = fmt_ctx->streams[stream_index];
+	time_base = stream->time_base;
+
+	const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+	if (!codec) {
+		return -30;
+	}
+	codec_ctx = avcodec_alloc_context3(codec);
+	if (!codec_ctx) {
+		return -40;
+	}
+	ret = avcodec_parameters_to_context(codec_ctx, stream->codecpar);
+	if (ret < 0) {
+		return ret;
+	}
+	// NOTE: keyframes only, one thread, stay out of the way of the playback decoder
+	codec_ctx->skip_frame = AVDISCARD_NONKEY;
+	codec_ctx->thread_count = 1;
+	ret = avcodec_open2(codec_ctx, codec, nullptr);
+	if (ret < 0) {
+		return ret;
+	}
+	packet = av_packet_alloc();
+	frame = av_frame_alloc();
+	return packet && frame ? 0 : -50;
+}
+
+void CUVThumbnailer::close() {
+	if (sws_ctx) {
+		sws_freeContext(sws_ctx);
+		sws_ctx = nullptr;
+	}
+	if (frame) {
+		av_frame_free(&frame);
+	}
+	if (packet) {
+		av_packet_free(&packet);
+	}
+	if (codec_ctx) {
+		avcodec_free_context(&codec_ctx);
+	}
+	if (fmt_ctx) {
+		avformat_close_input(&fmt_ctx);
+	}
+}
+
+int CUVThumbnailer::decodeAt(const int64_t bucket, QImage* image) {
+	const int64_t ts = av_rescale_q(start_time + bucket, AVRational{ 1, 1000 }, time_base);
+	int ret = av_seek_frame(fmt_ctx, stream_index, ts, AVSEEK_FLAG_BACKWARD);
+	if (ret < 0) {
+		return ret;
+	}
+	avcodec_flush_buffers(codec_ctx);
+
+	bool got = false;
+	for (int i = 0; i < THUMBNAIL_MAX_READ_PACKETS && !got && !quit; ++i) {
+		ret = av_read_frame(fmt_ctx, packet);
+		if (ret < 0) {
+			// flush the decoder for the last keyframe of the file
+			avcodec_send_packet(codec_ctx, nullptr);
+		} else {
+			defer(
+				av_packet_unref(packet);
+			)
+			if (packet->stream_index != stream_index) {
+				continue;
+			}
+			avcodec_send_packet(codec_ctx, packet);
+		}
+		got = avcodec_receive_frame(codec_ctx, frame) == 0;
+		if (ret < 0) {
+			break;
+		}
+	}
+	if (!got) {
+		return -1;
+	}
+	defer(
+		av_frame_unref(frame);
+	)
+
+	const int tw = thumb_width;
+	const int th = MAX(frame->height * tw / MAX(frame->width, 1) & ~1, 2);
+	sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+	                               tw, th, AV_PIX_FMT_BGRA, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+	if (!sws_ctx) {
+		return -2;
+	}
+	QImage img(tw, th, QImage::Format_RGB32);
+	uint8_t* dst[4] = { img.bits() };
+	const int dst_linesize[4] = { static_cast<int>(img.bytesPerLine()) };
+	sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+	*image = std::move(img);
+	return 0;
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <QImage>
+#include <QObject>
+
+#include "util/uvffmpeg_util.hpp"
+
+#define DEFAULT_THUMBNAIL_WIDTH     160
+#define DEFAULT_THUMBNAIL_CACHE     120
+// max packets read after a seek looking for the keyframe
+#define THUMBNAIL_MAX_READ_PACKETS  600
+
+/**
+ * @note: 进度条预览缩略图生成器.
+ * 使用独立的 AVFormatContext 和解码器(skip_frame = AVDISCARD_NONKEY, 单线程, 低优先级),
+ * 只解码关键帧并缩放为小图, 按时间桶缓存在有界 LRU 中, 与播放管线互不干扰.
+ * 悬停请求优先处理, 空闲时按时间顺序预生成整条预览.
+ */
+class CUVThumbnailer final : public QObject {
+	Q_OBJECT
+
+public:
+	explicit CUVThumbnailer(QObject* parent = nullptr);
+	~CUVThumbnailer() override;
+
+	// duration in ms, 0 if unknown
+	int start(const std::string& src, int64_t start_time, int64_t duration);
+	void stop();
+
+	// cached thumbnail of the bucket ms falls in, otherwise queue a request and return false
+	bool thumbnail(int64_t ms, QImage* image);
+
+signals:
+	// emitted from the worker thread, connect queued
+	void thumbnailReady(qint64 ms);
+
+private:
+	void run();
+	int open();
+	void close();
+	int decodeAt(int64_t bucket, QImage* image);
+	[[nodiscard]] int64_t bucketOf(int64_t ms) const;
+	bool lookup(int64_t bucket, QImage* image);
+	void insert(int64_t bucket, const QImage& image);
+
+	std::string src;
+	int64_t start_time{}; // ms
+	int64_t duration{};   // ms
+	int64_t interval{ 1000 }; // bucket width, ms
+	int thumb_width{ DEFAULT_THUMBNAIL_WIDTH };
+	size_t cache_num{ DEFAULT_THUMBNAIL_CACHE };
+
+	// worker thread only
+	AVFormatContext* fmt_ctx{ nullptr };
+	AVCodecContext* codec_ctx{ nullptr };
+	AVPacket* packet{ nullptr };
+	AVFrame* frame{ nullptr };
+	SwsContext* sws_ctx{ nullptr };
+	int stream_index{ -1 };
+	AVRational time_base{};
+	int64_t sweep_next{};
+
+	std::thread thread;
+	std::atomic<bool> quit{ false };
+	std::mutex mutex;
+	std::condition_variable cond;
+	int64_t hover_request{ -1 }; // bucket, guarded by mutex
+
+	// LRU: front is the most recently used
+	std::list<std::pair<int64_t, QImage>> lru;
+	std::unordered_map<int64_t, std::list<std::pair<int64_t, QImage>>::iterator> lru_map;
+	std::mutex lru_mutex;
+};